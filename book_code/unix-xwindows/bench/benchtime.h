@@ -0,0 +1,32 @@
+/*
+ * File: benchtime.h
+ * -----------------
+ * This file provides the timing function shared by the benchmark
+ * programs in this directory.  It is included directly by each
+ * program rather than being compiled into the library.
+ */
+
+#ifndef _benchtime_h
+#define _benchtime_h
+
+#include <time.h>
+#include <sys/time.h>
+
+/*
+ * Function: ElapsedTime
+ * Usage: t = ElapsedTime();
+ * -------------------------
+ * This function returns the value of a monotonic clock in
+ * seconds.  Only the difference between two calls is
+ * meaningful.
+ */
+
+static double ElapsedTime(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec + ts.tv_nsec / 1e9);
+}
+
+#endif
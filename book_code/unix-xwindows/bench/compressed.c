@@ -0,0 +1,131 @@
+/*
+ * File: compressed.c
+ * ------------------
+ * This program measures how well a reader overlaps the
+ * decompression of gzip input with parsing.  It writes a file of
+ * real numbers in both plain and gzip form and then times three
+ * operations: reading the lines of the compressed file, which
+ * measures decompression alone; summing the numbers in the plain
+ * file, which measures parsing alone; and summing the numbers in
+ * the compressed file, which requires both.  If decompression
+ * overlaps parsing, the last time is close to the larger of the
+ * first two rather than to their sum.  The optional argument
+ * gives the number of values, which defaults to twenty million.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include "genlib.h"
+#include "simpio.h"
+#include "benchtime.h"
+
+/*
+ * Constants
+ * ---------
+ * DefaultCount -- Number of values if no argument is given
+ */
+
+#define DefaultCount 20000000
+
+/* Private function prototypes */
+
+static void WriteNumbers(string filename, string gzfilename, long count);
+static void TimeLines(string filename);
+static void TimeSum(string label, string filename);
+
+/* Main program */
+
+int main(int argc, char *argv[])
+{
+    char filename[] = "/tmp/plainXXXXXX";
+    char gzfilename[] = "/tmp/gzipXXXXXX";
+    long count;
+
+    count = (argc > 1) ? atol(argv[1]) : DefaultCount;
+    if (mkstemp(filename) < 0 || mkstemp(gzfilename) < 0) {
+        Error("Can't create temporary files");
+    }
+    WriteNumbers(filename, gzfilename, count);
+    SetParseThreads(1);
+    TimeLines(gzfilename);
+    TimeSum("sum plain file", filename);
+    TimeSum("sum gzip file", gzfilename);
+    remove(filename);
+    remove(gzfilename);
+    return (0);
+}
+
+/*
+ * Function: WriteNumbers
+ * Usage: WriteNumbers(filename, gzfilename, count);
+ * -------------------------------------------------
+ * This function writes count pseudo-random real numbers, one per
+ * line, to both files, compressing the second with zlib.
+ */
+
+static void WriteNumbers(string filename, string gzfilename, long count)
+{
+    char line[40];
+    FILE *outfile;
+    gzFile gzfile;
+    long i;
+    int n;
+
+    outfile = fopen(filename, "w");
+    gzfile = gzopen(gzfilename, "wb6");
+    if (outfile == NULL || gzfile == NULL) Error("Can't write files");
+    srand(17);
+    for (i = 0; i < count; i++) {
+        n = sprintf(line, "%.6f\n", rand() / 1000.0 - 1e6);
+        fwrite(line, 1, n, outfile);
+        gzwrite(gzfile, line, n);
+    }
+    fclose(outfile);
+    gzclose(gzfile);
+}
+
+/*
+ * Function: TimeLines
+ * Usage: TimeLines(filename);
+ * ---------------------------
+ * This function reads the lines of the file without parsing
+ * them and reports the elapsed time.
+ */
+
+static void TimeLines(string filename)
+{
+    readerADT reader;
+    lineViewT view;
+    double start, nbytes;
+
+    reader = OpenReader(filename);
+    if (reader == NULL) Error("Can't open %s", filename);
+    nbytes = 0;
+    start = ElapsedTime();
+    while (ReadLineView(reader, &view)) nbytes += view.length + 1;
+    printf("%-16s %8.3f s  (%.0f bytes)\n", "decompress only",
+           ElapsedTime() - start, nbytes);
+    CloseReader(reader);
+}
+
+/*
+ * Function: TimeSum
+ * Usage: TimeSum(label, filename);
+ * --------------------------------
+ * This function sums the numbers in the file with
+ * SummarizeRealFile and reports the elapsed time.
+ */
+
+static void TimeSum(string label, string filename)
+{
+    numberSummaryT summary;
+    double start;
+
+    start = ElapsedTime();
+    summary = SummarizeRealFile(filename);
+    printf("%-16s %8.3f s  sum = %.6e\n", label, ElapsedTime() - start,
+           summary.sum);
+}
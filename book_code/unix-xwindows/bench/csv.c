@@ -0,0 +1,231 @@
+/*
+ * File: csv.c
+ * -----------
+ * This program measures the throughput of the CSV reader.  It
+ * writes a file of records with five fields: an integer id, a
+ * name, a price, a quantity, and a comment that is sometimes
+ * quoted because it contains a comma.  It then computes the
+ * total value of the records (the sum of price times quantity)
+ * in three ways: by reading each line with ReadLine and splitting
+ * it by hand, which is how programs handled CSV files before the
+ * CSV reader existed; by calling ReadRecord and converting the
+ * fields of each record; and by using ReadColumns to fill arrays
+ * of the selected columns.  The optional argument gives the
+ * number of records, which defaults to twenty million, or about
+ * one gigabyte; to measure a multi-gigabyte file, supply a
+ * larger count.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "genlib.h"
+#include "simpio.h"
+#include "csv.h"
+#include "benchtime.h"
+
+/*
+ * Constants
+ * ---------
+ * DefaultCount -- Number of records if no argument is given
+ * BatchSize    -- Number of records read by each ReadColumns
+ */
+
+#define DefaultCount 20000000
+#define BatchSize 4096
+
+/* Private function prototypes */
+
+static double WriteRecords(string filename, long count);
+static void TimeReadLine(string filename, double nbytes);
+static void TimeReadRecord(string filename, double nbytes);
+static void TimeReadColumns(string filename, double nbytes);
+static void Report(string label, double start, double nbytes,
+                   double total);
+
+/* Main program */
+
+int main(int argc, char *argv[])
+{
+    char filename[] = "/tmp/recordsXXXXXX";
+    double nbytes;
+    long count;
+
+    count = (argc > 1) ? atol(argv[1]) : DefaultCount;
+    if (mkstemp(filename) < 0) Error("Can't create temporary file");
+    nbytes = WriteRecords(filename, count);
+    TimeReadLine(filename, nbytes);
+    TimeReadRecord(filename, nbytes);
+    TimeReadColumns(filename, nbytes);
+    remove(filename);
+    return (0);
+}
+
+/*
+ * Function: WriteRecords
+ * Usage: nbytes = WriteRecords(filename, count);
+ * ----------------------------------------------
+ * This function writes a header line and count records to the
+ * file and returns the size of the file in bytes.
+ */
+
+static double WriteRecords(string filename, long count)
+{
+    writerADT writer;
+    double nbytes;
+    long i;
+    FILE *outfile;
+
+    writer = OpenWriter(filename);
+    if (writer == NULL) Error("Can't write %s", filename);
+    WriteString(writer, "id,name,price,quantity,comment\n");
+    srand(17);
+    for (i = 0; i < count; i++) {
+        WriteInteger(writer, i, 0);
+        WriteString(writer, ",item");
+        WriteInteger(writer, rand() % 100000, 0);
+        WriteChar(writer, ',');
+        WriteReal(writer, rand() % 1000000 / 100.0, 0, 2);
+        WriteChar(writer, ',');
+        WriteInteger(writer, rand() % 100, 0);
+        if (i % 4 == 0) {
+            WriteString(writer, ",\"fragile, handle with care\"\n");
+        } else {
+            WriteString(writer, ",standard shipping\n");
+        }
+    }
+    CloseWriter(writer);
+    outfile = fopen(filename, "r");
+    fseek(outfile, 0, SEEK_END);
+    nbytes = ftell(outfile);
+    fclose(outfile);
+    return (nbytes);
+}
+
+/*
+ * Function: TimeReadLine
+ * Usage: TimeReadLine(filename, nbytes);
+ * --------------------------------------
+ * This function computes the total by reading each line with
+ * ReadLine, locating the commas with strchr, and converting the
+ * fields with atof and atol.  The approach works only because
+ * the fields it needs come before any quoted field.
+ */
+
+static void TimeReadLine(string filename, double nbytes)
+{
+    FILE *infile;
+    string line;
+    char *price, *quantity;
+    double start, total;
+
+    infile = fopen(filename, "r");
+    if (infile == NULL) Error("Can't open %s", filename);
+    start = ElapsedTime();
+    FreeBlock(ReadLine(infile));
+    total = 0;
+    while ((line = ReadLine(infile)) != NULL) {
+        price = strchr(strchr(line, ',') + 1, ',') + 1;
+        quantity = strchr(price, ',') + 1;
+        total += atof(price) * atol(quantity);
+        FreeBlock(line);
+    }
+    fclose(infile);
+    Report("ReadLine", start, nbytes, total);
+}
+
+/*
+ * Function: TimeReadRecord
+ * Usage: TimeReadRecord(filename, nbytes);
+ * ----------------------------------------
+ * This function computes the total by reading each record with
+ * ReadRecord and converting the fields with ViewToReal and
+ * ViewToLong.
+ */
+
+static void TimeReadRecord(string filename, double nbytes)
+{
+    csvADT csv;
+    int priceIndex, quantityIndex;
+    double start, total, price;
+    long quantity;
+
+    csv = OpenCSV(filename);
+    if (csv == NULL) Error("Can't open %s", filename);
+    start = ElapsedTime();
+    ReadRecord(csv);
+    priceIndex = FindField(csv, "price");
+    quantityIndex = FindField(csv, "quantity");
+    total = 0;
+    while (ReadRecord(csv)) {
+        if (!ViewToReal(GetField(csv, priceIndex), &price)
+              || !ViewToLong(GetField(csv, quantityIndex), &quantity)) {
+            Error("Bad record on line %ld", CSVLineNumber(csv));
+        }
+        total += price * quantity;
+    }
+    CloseCSV(csv);
+    Report("ReadRecord", start, nbytes, total);
+}
+
+/*
+ * Function: TimeReadColumns
+ * Usage: TimeReadColumns(filename, nbytes);
+ * -----------------------------------------
+ * This function computes the total by reading the price and
+ * quantity columns in batches with ReadColumns.  It also
+ * selects the name column as a view column, so that the time
+ * includes copying a string field.
+ */
+
+static void TimeReadColumns(string filename, double nbytes)
+{
+    csvADT csv;
+    columnT columns[3];
+    double prices[BatchSize];
+    long quantities[BatchSize];
+    lineViewT names[BatchSize];
+    double start, total;
+    long i, n;
+
+    csv = OpenCSV(filename);
+    if (csv == NULL) Error("Can't open %s", filename);
+    start = ElapsedTime();
+    ReadRecord(csv);
+    columns[0].index = FindField(csv, "price");
+    columns[0].type = RealColumn;
+    columns[0].values = prices;
+    columns[1].index = FindField(csv, "quantity");
+    columns[1].type = LongColumn;
+    columns[1].values = quantities;
+    columns[2].index = FindField(csv, "name");
+    columns[2].type = ViewColumn;
+    columns[2].values = names;
+    total = 0;
+    while ((n = ReadColumns(csv, columns, 3, BatchSize)) > 0) {
+        for (i = 0; i < n; i++) total += prices[i] * quantities[i];
+    }
+    CloseCSV(csv);
+    Report("ReadColumns", start, nbytes, total);
+}
+
+/*
+ * Function: Report
+ * Usage: Report(label, start, nbytes, total);
+ * -------------------------------------------
+ * This function prints the elapsed time since start and the
+ * throughput, together with the total so that the results of
+ * the different methods can be compared.
+ */
+
+static void Report(string label, double start, double nbytes,
+                   double total)
+{
+    double elapsed;
+
+    elapsed = ElapsedTime() - start;
+    printf("%-12s %8.3f s %9.1f MB/s  total = %.2f\n", label, elapsed,
+           nbytes / elapsed / 1e6, total);
+}
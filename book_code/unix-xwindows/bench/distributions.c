@@ -0,0 +1,190 @@
+/*
+ * File: distributions.c
+ * ---------------------
+ * This program measures the speed of the non-uniform
+ * distributions in random.h.  For the normal distribution, it
+ * compares the Box-Muller method built on RandomReal, which is
+ * how programs produced normal values before RandomNormal
+ * existed, with RandomNormal and FillRandomNormals.  For the
+ * exponential distribution, it makes the same comparison using
+ * the inversion method, which takes the logarithm of a value
+ * from RandomReal.  It also times RandomPoisson and
+ * RandomBinomial for small and large means.  The optional
+ * argument gives the number of samples in each test, which
+ * defaults to fifty million.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "genlib.h"
+#include "random.h"
+#include "benchtime.h"
+
+/*
+ * Constants
+ * ---------
+ * DefaultCount -- Number of samples if no argument is given
+ * ArraySize    -- Size of the array filled by each test
+ * Pi           -- Mathematical constant pi
+ */
+
+#define DefaultCount 50000000
+#define ArraySize 100000
+#define Pi 3.14159265358979323846
+
+/*
+ * Type: testT
+ * -----------
+ * A test fills an array with samples.  The arg field holds a
+ * parameter of the distribution for the tests that need one.
+ */
+
+typedef struct {
+    string label;
+    void (*fill)(double array[], long n, double arg);
+    double arg;
+} testT;
+
+/* Private function prototypes */
+
+static void BoxMuller(double array[], long n, double arg);
+static void NormalLoop(double array[], long n, double arg);
+static void NormalFill(double array[], long n, double arg);
+static void Inversion(double array[], long n, double arg);
+static void ExponentialLoop(double array[], long n, double arg);
+static void ExponentialFill(double array[], long n, double arg);
+static void PoissonLoop(double array[], long n, double arg);
+static void BinomialLoop(double array[], long n, double arg);
+static void RunTest(testT *test, double array[], long count);
+
+/* Private variables */
+
+static testT tests[] = {
+    { "Box-Muller", BoxMuller, 0 },
+    { "RandomNormal", NormalLoop, 0 },
+    { "FillRandomNormals", NormalFill, 0 },
+    { "-log(RandomReal)", Inversion, 0 },
+    { "RandomExponential", ExponentialLoop, 0 },
+    { "FillRandomExponentials", ExponentialFill, 0 },
+    { "Poisson(4)", PoissonLoop, 4 },
+    { "Poisson(1000)", PoissonLoop, 1000 },
+    { "Binomial(20,.3)", BinomialLoop, 20 },
+    { "Binomial(1e4,.3)", BinomialLoop, 10000 }
+};
+
+/* Main program */
+
+int main(int argc, char *argv[])
+{
+    double *array;
+    long count;
+    int i;
+
+    count = (argc > 1) ? atol(argv[1]) : DefaultCount;
+    array = NewArray(ArraySize, double);
+    for (i = 0; i < sizeof tests / sizeof tests[0]; i++) {
+        RunTest(&tests[i], array, count);
+    }
+    FreeBlock(array);
+    return (0);
+}
+
+/*
+ * Function: RunTest
+ * Usage: RunTest(test, array, count);
+ * -----------------------------------
+ * This function calls the fill function of the test until it
+ * has produced count samples and reports the rate, together
+ * with the mean of the samples as a check.
+ */
+
+static void RunTest(testT *test, double array[], long count)
+{
+    double start, elapsed, sum;
+    long done, i;
+
+    start = ElapsedTime();
+    sum = 0;
+    for (done = 0; done < count; done += ArraySize) {
+        test->fill(array, ArraySize, test->arg);
+        for (i = 0; i < ArraySize; i++) sum += array[i];
+    }
+    elapsed = ElapsedTime() - start;
+    printf("%-22s %8.3f s %8.1f M/s  mean = %.4f\n", test->label,
+           elapsed, done / elapsed / 1e6, sum / done);
+}
+
+/*
+ * Fill functions
+ * --------------
+ * Each of the following functions fills an array with n samples
+ * from one distribution using one method.
+ */
+
+static void BoxMuller(double array[], long n, double arg)
+{
+    double r, theta;
+    long i;
+
+    for (i = 0; i + 1 < n; i += 2) {
+        r = sqrt(-2 * log(1 - RandomReal(0, 1)));
+        theta = RandomReal(0, 2 * Pi);
+        array[i] = r * cos(theta);
+        array[i + 1] = r * sin(theta);
+    }
+}
+
+static void NormalLoop(double array[], long n, double arg)
+{
+    randomADT rng;
+    long i;
+
+    rng = DefaultRandom();
+    for (i = 0; i < n; i++) array[i] = RandomNormal(rng, 0, 1);
+}
+
+static void NormalFill(double array[], long n, double arg)
+{
+    FillRandomNormals(DefaultRandom(), array, n, 0, 1);
+}
+
+static void Inversion(double array[], long n, double arg)
+{
+    long i;
+
+    for (i = 0; i < n; i++) array[i] = -log(1 - RandomReal(0, 1));
+}
+
+static void ExponentialLoop(double array[], long n, double arg)
+{
+    randomADT rng;
+    long i;
+
+    rng = DefaultRandom();
+    for (i = 0; i < n; i++) array[i] = RandomExponential(rng, 1);
+}
+
+static void ExponentialFill(double array[], long n, double arg)
+{
+    FillRandomExponentials(DefaultRandom(), array, n, 1);
+}
+
+static void PoissonLoop(double array[], long n, double arg)
+{
+    randomADT rng;
+    long i;
+
+    rng = DefaultRandom();
+    for (i = 0; i < n; i++) array[i] = RandomPoisson(rng, arg);
+}
+
+static void BinomialLoop(double array[], long n, double arg)
+{
+    randomADT rng;
+    long i;
+
+    rng = DefaultRandom();
+    for (i = 0; i < n; i++) array[i] = RandomBinomial(rng, (long) arg, 0.3);
+}
@@ -0,0 +1,449 @@
+/*
+ * File: drawing.c
+ * ---------------
+ * This program measures how quickly the graphics library can
+ * deliver drawing commands to the X manager.  The first test
+ * draws a Koch snowflake, a recursive fractal in which every
+ * primitive is a short call to DrawLine.  The second draws many
+ * small circles with DrawArc, and the third draws large filled
+ * circles, which the X manager must convert into polygons with
+ * many sides.  The fourth fills many small squares, triangles,
+ * and circles, for which the cost of each region as a whole
+ * matters more than the number of sides.  The fifth animates a
+ * rotating
+ * star, calling UpdateDisplay after each frame, and reports the
+ * average time per frame; the sixth does the same for a small
+ * ball that moves across the window, for which a redraw needs to
+ * copy only a small part of the window.  The next two call TextStringWidth
+ * and GetMouseX repeatedly, each of which requires a round trip
+ * to the X manager for every call.  The last measures the time
+ * the X manager takes to wake up: it lets the X manager sleep for
+ * a few milliseconds before each call to GetMouseX and times only
+ * the calls.  Each of the drawing tests ends with a call to
+ * GetMouseX, which cannot return until the X manager has
+ * processed every earlier command, so the times include the work
+ * done on both sides of the connection.  Each test also reports
+ * the number of write system calls made by the program, which
+ * it reads from /proc/self/io on systems that provide it.  The
+ * optional arguments give the order of the snowflake, which
+ * defaults to 9 (786,432 lines), and the number of circles, small
+ * regions, and round trips, which defaults to one hundred
+ * thousand.  To
+ * compare the transports between the client and the X manager,
+ * run the program with GRAPHICS_TRANSPORT set to pipe, shm, or
+ * thread.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <unistd.h>
+
+#include "genlib.h"
+#include "graphics.h"
+#include "extgraph.h"
+#include "benchtime.h"
+
+/*
+ * Constants
+ * ---------
+ * DefaultOrder -- Order of the snowflake if no argument is given
+ * DefaultCount -- Number of circles and round trips by default
+ * NFrames      -- Number of frames in the animation
+ * NFilled      -- Number of filled circles
+ * FilledRadius -- Radius of the filled circles in inches
+ * ShapeSize    -- Width of the small filled shapes in inches
+ * StarPoints   -- Number of points in the animated star
+ * BallRadius   -- Radius of the moving ball in inches
+ * NWakeups     -- Number of trials in the wake-up test
+ * IdleTime     -- Seconds the X manager sleeps before each trial
+ * Pi           -- Mathematical constant pi
+ */
+
+#define DefaultOrder 9
+#define DefaultCount 100000
+#define NFrames 1000
+#define NFilled 1000
+#define FilledRadius 1.5
+#define ShapeSize 0.1
+#define StarPoints 100
+#define BallRadius 0.1
+#define NWakeups 200
+#define IdleTime 0.005
+#define Pi 3.1415926535
+
+/* Private function prototypes */
+
+static void TimeSnowflake(int order);
+static void DrawFractalLine(double len, double theta, int order);
+static void DrawPolarLine(double r, double theta);
+static void TimeCircles(long count);
+static void TimeFilledCircles(void);
+static void TimeRegions(long count);
+static void TimeFrames(void);
+static void TimeBall(void);
+static void TimeRoundTrips(long count);
+static void TimeWakeups(void);
+static long WriteCalls(void);
+static void Report(string label, double elapsed, double count,
+                   long writes);
+
+/* Main program */
+
+int main(int argc, char *argv[])
+{
+    int order;
+    long count;
+
+    order = (argc > 1) ? atoi(argv[1]) : DefaultOrder;
+    count = (argc > 2) ? atol(argv[2]) : DefaultCount;
+    InitGraphics();
+    TimeSnowflake(order);
+    TimeCircles(count);
+    TimeFilledCircles();
+    TimeRegions(count);
+    TimeFrames();
+    TimeBall();
+    TimeRoundTrips(count);
+    TimeWakeups();
+    ExitGraphics();
+    return (0);
+}
+
+/*
+ * Function: TimeSnowflake
+ * Usage: TimeSnowflake(order);
+ * ----------------------------
+ * This function draws a Koch snowflake of the given order, which
+ * consists of 3 * 4^order lines.
+ */
+
+static void TimeSnowflake(int order)
+{
+    double start, size;
+    long writes;
+
+    size = GetWindowHeight() * 0.6;
+    writes = WriteCalls();
+    start = ElapsedTime();
+    MovePen(GetWindowWidth() / 2 - size / 2,
+            GetWindowHeight() / 2 - size * sqrt(3.0) / 6);
+    DrawFractalLine(size, 0, order);
+    DrawFractalLine(size, 120, order);
+    DrawFractalLine(size, 240, order);
+    (void) GetMouseX();
+    Report("DrawLine", ElapsedTime() - start, 3 * pow(4.0, order),
+           writes);
+}
+
+/*
+ * Function: DrawFractalLine
+ * Usage: DrawFractalLine(len, theta, order);
+ * ------------------------------------------
+ * This function draws a fractal line of the given order that
+ * extends len inches in the direction theta, measured in
+ * degrees, from the current point.
+ */
+
+static void DrawFractalLine(double len, double theta, int order)
+{
+    if (order == 0) {
+        DrawPolarLine(len, theta);
+    } else {
+        DrawFractalLine(len / 3, theta, order - 1);
+        DrawFractalLine(len / 3, theta - 60, order - 1);
+        DrawFractalLine(len / 3, theta + 60, order - 1);
+        DrawFractalLine(len / 3, theta, order - 1);
+    }
+}
+
+/*
+ * Function: DrawPolarLine
+ * Usage: DrawPolarLine(r, theta);
+ * -------------------------------
+ * This function draws a line of length r in the direction
+ * specified by the angle theta, measured in degrees.
+ */
+
+static void DrawPolarLine(double r, double theta)
+{
+    double radians;
+
+    radians = theta / 180 * Pi;
+    DrawLine(r * cos(radians), r * sin(radians));
+}
+
+/*
+ * Function: TimeCircles
+ * Usage: TimeCircles(count);
+ * --------------------------
+ * This function draws count small circles spread across the
+ * window.
+ */
+
+static void TimeCircles(long count)
+{
+    double start, width, height;
+    long i, writes;
+
+    width = GetWindowWidth();
+    height = GetWindowHeight();
+    writes = WriteCalls();
+    start = ElapsedTime();
+    for (i = 0; i < count; i++) {
+        MovePen((i % 97) * width / 97, (i % 89) * height / 89);
+        DrawArc(0.05, 0, 360);
+    }
+    (void) GetMouseX();
+    Report("DrawArc", ElapsedTime() - start, count, writes);
+}
+
+/*
+ * Function: TimeFilledCircles
+ * Usage: TimeFilledCircles();
+ * ---------------------------
+ * This function draws NFilled filled circles of radius
+ * FilledRadius, alternating between black and white so that each
+ * circle remains visible.
+ */
+
+static void TimeFilledCircles(void)
+{
+    double start, width, height;
+    long writes;
+    int i;
+
+    width = GetWindowWidth();
+    height = GetWindowHeight();
+    writes = WriteCalls();
+    start = ElapsedTime();
+    for (i = 0; i < NFilled; i++) {
+        SetEraseMode(i % 2 == 1);
+        MovePen((i % 7) * width / 7 + FilledRadius,
+                (i % 5) * height / 5);
+        StartFilledRegion(1.0);
+        DrawArc(FilledRadius, 0, 360);
+        EndFilledRegion();
+    }
+    SetEraseMode(FALSE);
+    (void) GetMouseX();
+    Report("filled DrawArc", ElapsedTime() - start, NFilled, writes);
+}
+
+/*
+ * Function: TimeRegions
+ * Usage: TimeRegions(count);
+ * --------------------------
+ * This function fills count small shapes spread across the
+ * window, taking squares, triangles, and circles in turn.
+ */
+
+static void TimeRegions(long count)
+{
+    double start, width, height;
+    long i, writes;
+
+    width = GetWindowWidth();
+    height = GetWindowHeight();
+    writes = WriteCalls();
+    start = ElapsedTime();
+    for (i = 0; i < count; i++) {
+        MovePen((i % 97) * width / 97, (i % 89) * height / 89);
+        StartFilledRegion(0.5);
+        switch (i % 3) {
+          case 0:
+            DrawLine(ShapeSize, 0);
+            DrawLine(0, ShapeSize);
+            DrawLine(-ShapeSize, 0);
+            DrawLine(0, -ShapeSize);
+            break;
+          case 1:
+            DrawLine(ShapeSize, 0);
+            DrawLine(-ShapeSize / 2, ShapeSize);
+            DrawLine(-ShapeSize / 2, -ShapeSize);
+            break;
+          case 2:
+            DrawArc(ShapeSize / 2, 0, 360);
+            break;
+        }
+        EndFilledRegion();
+    }
+    (void) GetMouseX();
+    Report("filled regions", ElapsedTime() - start, count, writes);
+}
+
+/*
+ * Function: TimeFrames
+ * Usage: TimeFrames();
+ * --------------------
+ * This function draws NFrames frames of an animation.  Each
+ * frame erases the star drawn in the previous frame, draws the
+ * star rotated by one degree, and calls UpdateDisplay.
+ */
+
+static void TimeFrames(void)
+{
+    double start, xc, yc, r, theta, x, y;
+    long writes;
+    int frame, pass, i;
+
+    xc = GetWindowWidth() / 2;
+    yc = GetWindowHeight() / 2;
+    r = GetWindowHeight() * 0.4;
+    writes = WriteCalls();
+    start = ElapsedTime();
+    for (frame = 0; frame < NFrames; frame++) {
+        for (pass = 0; pass < 2; pass++) {
+            SetEraseMode(pass == 0);
+            theta = (frame + pass - 1) / 180.0 * Pi;
+            MovePen(xc + r * cos(theta), yc + r * sin(theta));
+            for (i = 1; i <= StarPoints; i++) {
+                theta += 2 * Pi * (StarPoints / 2 - 1) / StarPoints;
+                x = xc + r * cos(theta);
+                y = yc + r * sin(theta);
+                DrawLine(x - GetCurrentX(), y - GetCurrentY());
+            }
+        }
+        UpdateDisplay();
+    }
+    (void) GetMouseX();
+    Report("frames", ElapsedTime() - start, NFrames, writes);
+}
+
+/*
+ * Function: TimeBall
+ * Usage: TimeBall();
+ * ------------------
+ * This function draws NFrames frames of an animation in which a
+ * small ball moves diagonally across the window.  Each frame
+ * erases the ball, moves it, draws it again, and calls
+ * UpdateDisplay.
+ */
+
+static void TimeBall(void)
+{
+    double start, x, y, dx, dy;
+    long writes;
+    int frame;
+
+    x = GetWindowWidth() / 4;
+    y = GetWindowHeight() / 4;
+    dx = GetWindowWidth() / 2 / NFrames;
+    dy = GetWindowHeight() / 2 / NFrames;
+    writes = WriteCalls();
+    start = ElapsedTime();
+    for (frame = 0; frame < NFrames; frame++) {
+        SetEraseMode(TRUE);
+        MovePen(x + BallRadius, y);
+        DrawArc(BallRadius, 0, 360);
+        x += dx;
+        y += dy;
+        SetEraseMode(FALSE);
+        MovePen(x + BallRadius, y);
+        DrawArc(BallRadius, 0, 360);
+        UpdateDisplay();
+    }
+    (void) GetMouseX();
+    Report("ball frames", ElapsedTime() - start, NFrames, writes);
+}
+
+/*
+ * Function: TimeRoundTrips
+ * Usage: TimeRoundTrips(count);
+ * -----------------------------
+ * This function calls TextStringWidth and then GetMouseX count
+ * times each.
+ */
+
+static void TimeRoundTrips(long count)
+{
+    double start;
+    long i, writes;
+
+    writes = WriteCalls();
+    start = ElapsedTime();
+    for (i = 0; i < count; i++) {
+        (void) TextStringWidth("Koch snowflake");
+    }
+    Report("TextStringWidth", ElapsedTime() - start, count, writes);
+    writes = WriteCalls();
+    start = ElapsedTime();
+    for (i = 0; i < count; i++) {
+        (void) GetMouseX();
+    }
+    Report("GetMouseX", ElapsedTime() - start, count, writes);
+}
+
+/*
+ * Function: TimeWakeups
+ * Usage: TimeWakeups();
+ * ---------------------
+ * This function times NWakeups calls to GetMouseX, each made after
+ * the program has been idle for IdleTime seconds, so that the X
+ * manager has gone to sleep.  The X manager also has a redraw to
+ * perform, since each trial first draws a short line.
+ */
+
+static void TimeWakeups(void)
+{
+    double start, elapsed;
+    long writes;
+    int i;
+
+    writes = WriteCalls();
+    elapsed = 0;
+    for (i = 0; i < NWakeups; i++) {
+        DrawLine(0.01, 0);
+        usleep((unsigned) (IdleTime * 1000000));
+        start = ElapsedTime();
+        (void) GetMouseX();
+        elapsed += ElapsedTime() - start;
+    }
+    Report("idle GetMouseX", elapsed, NWakeups, writes);
+}
+
+/*
+ * Function: WriteCalls
+ * Usage: n = WriteCalls();
+ * ------------------------
+ * This function returns the number of write system calls made so
+ * far by the program, or -1 if the number is not available.
+ */
+
+static long WriteCalls(void)
+{
+    FILE *infile;
+    char line[100];
+    long n;
+
+    infile = fopen("/proc/self/io", "r");
+    if (infile == NULL) return (-1);
+    n = -1;
+    while (fgets(line, sizeof line, infile) != NULL) {
+        if (sscanf(line, "syscw: %ld", &n) == 1) break;
+    }
+    fclose(infile);
+    return (n);
+}
+
+/*
+ * Function: Report
+ * Usage: Report(label, elapsed, count, writes);
+ * ---------------------------------------------
+ * This function prints the elapsed time, the number of
+ * operations per second, the average time per operation in
+ * microseconds, and the number of write system calls made since
+ * the count given by writes was taken.
+ */
+
+static void Report(string label, double elapsed, double count,
+                   long writes)
+{
+    long now;
+
+    now = WriteCalls();
+    printf("%-16s %8.0f ops %8.3f s %10.0f ops/s %9.3f us/op", label,
+           count, elapsed, count / elapsed, elapsed / count * 1e6);
+    if (now >= 0 && writes >= 0) printf(" %8ld writes", now - writes);
+    printf("\n");
+}
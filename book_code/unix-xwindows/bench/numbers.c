@@ -0,0 +1,159 @@
+/*
+ * File: numbers.c
+ * ---------------
+ * This program compares the speed of reading numbers with the
+ * line-oriented functions GetInteger and GetReal against the
+ * speed of reading them with ReadInteger and ReadReal.  The
+ * program writes a temporary file containing the requested
+ * number of values, one per line, and then reads the file back
+ * with each pair of functions.  The optional argument gives the
+ * number of values, which defaults to ten million.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "genlib.h"
+#include "simpio.h"
+#include "benchtime.h"
+
+/*
+ * Constants
+ * ---------
+ * DefaultCount -- Number of values if no argument is given
+ */
+
+#define DefaultCount 10000000
+
+/* Private function prototypes */
+
+static void WriteNumbers(string filename, long count, bool reals);
+static void TimeGetFunctions(string filename, long count, bool reals);
+static void TimeReadFunctions(string filename, long count, bool reals);
+static void Report(string label, long count, double elapsed, double sum);
+
+/* Main program */
+
+int main(int argc, char *argv[])
+{
+    char filename[] = "/tmp/numbersXXXXXX";
+    long count;
+    int fd;
+
+    count = (argc > 1) ? atol(argv[1]) : DefaultCount;
+    fd = mkstemp(filename);
+    if (fd < 0) Error("Can't create temporary file");
+    close(fd);
+    WriteNumbers(filename, count, FALSE);
+    TimeGetFunctions(filename, count, FALSE);
+    TimeReadFunctions(filename, count, FALSE);
+    WriteNumbers(filename, count, TRUE);
+    TimeGetFunctions(filename, count, TRUE);
+    TimeReadFunctions(filename, count, TRUE);
+    remove(filename);
+    return (0);
+}
+
+/*
+ * Function: WriteNumbers
+ * Usage: WriteNumbers(filename, count, reals);
+ * --------------------------------------------
+ * This function writes count pseudo-random values to the file,
+ * one per line.  If reals is TRUE, the values have a fractional
+ * part; otherwise, they are integers.
+ */
+
+static void WriteNumbers(string filename, long count, bool reals)
+{
+    FILE *outfile;
+    long i;
+
+    outfile = fopen(filename, "w");
+    if (outfile == NULL) Error("Can't write %s", filename);
+    srand(17);
+    for (i = 0; i < count; i++) {
+        if (reals) {
+            fprintf(outfile, "%.6f\n", rand() / 1000.0 - 1e6);
+        } else {
+            fprintf(outfile, "%d\n", rand() - RAND_MAX / 2);
+        }
+    }
+    fclose(outfile);
+}
+
+/*
+ * Function: TimeGetFunctions
+ * Usage: TimeGetFunctions(filename, count, reals);
+ * ------------------------------------------------
+ * This function reads the file through stdin using GetInteger
+ * or GetReal, which read a line at a time.
+ */
+
+static void TimeGetFunctions(string filename, long count, bool reals)
+{
+    double start, sum;
+    long i;
+
+    if (freopen(filename, "r", stdin) == NULL) {
+        Error("Can't open %s", filename);
+    }
+    sum = 0;
+    start = ElapsedTime();
+    for (i = 0; i < count; i++) {
+        sum += (reals) ? GetReal() : GetInteger();
+    }
+    Report((reals) ? "GetReal" : "GetInteger", count,
+           ElapsedTime() - start, sum);
+}
+
+/*
+ * Function: TimeReadFunctions
+ * Usage: TimeReadFunctions(filename, count, reals);
+ * -------------------------------------------------
+ * This function reads the file through a reader using
+ * ReadInteger or ReadReal.
+ */
+
+static void TimeReadFunctions(string filename, long count, bool reals)
+{
+    readerADT reader;
+    double start, sum, d;
+    long n;
+    int i;
+
+    reader = OpenReader(filename);
+    if (reader == NULL) Error("Can't open %s", filename);
+    sum = 0;
+    n = 0;
+    start = ElapsedTime();
+    if (reals) {
+        while (ReadReal(reader, &d)) {
+            sum += d;
+            n++;
+        }
+    } else {
+        while (ReadInteger(reader, &i)) {
+            sum += i;
+            n++;
+        }
+    }
+    Report((reals) ? "ReadReal" : "ReadInteger", n,
+           ElapsedTime() - start, sum);
+    CloseReader(reader);
+    if (n != count) Error("Expected %ld values but read %ld", count, n);
+}
+
+/*
+ * Function: Report
+ * Usage: Report(label, count, elapsed, sum);
+ * ------------------------------------------
+ * This function prints one line of results.  The sum is printed
+ * so that the two methods can be checked against each other.
+ */
+
+static void Report(string label, long count, double elapsed, double sum)
+{
+    printf("%-12s %10ld values %8.3f s %8.2f M/s  sum = %.6e\n", label,
+           count, elapsed, count / elapsed / 1e6, sum);
+}
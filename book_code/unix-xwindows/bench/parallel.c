@@ -0,0 +1,138 @@
+/*
+ * File: parallel.c
+ * ----------------
+ * This program measures how the parallel file readers scale with
+ * the number of threads.  It writes a temporary file of real
+ * numbers and then calls SummarizeRealFile and ReadRealFile with
+ * one thread, two threads, and so on, doubling the count until it
+ * reaches twice the number of processors.  For comparison, it
+ * first reads the file sequentially with ReadReal.  The optional
+ * argument gives the number of values, which defaults to fifty
+ * million (about 900MB).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "genlib.h"
+#include "simpio.h"
+#include "benchtime.h"
+
+/*
+ * Constants
+ * ---------
+ * DefaultCount -- Number of values if no argument is given
+ */
+
+#define DefaultCount 50000000
+
+/* Private function prototypes */
+
+static void WriteNumbers(string filename, long count);
+static void TimeSequential(string filename);
+static double TimeParallel(string filename, int nThreads, double base);
+
+/* Main program */
+
+int main(int argc, char *argv[])
+{
+    char filename[] = "/tmp/parallelXXXXXX";
+    long count;
+    int fd, nThreads, nProcessors;
+    double base, elapsed;
+
+    count = (argc > 1) ? atol(argv[1]) : DefaultCount;
+    fd = mkstemp(filename);
+    if (fd < 0) Error("Can't create temporary file");
+    close(fd);
+    WriteNumbers(filename, count);
+    nProcessors = (int) sysconf(_SC_NPROCESSORS_ONLN);
+    printf("%d processors online\n", nProcessors);
+    TimeSequential(filename);
+    base = 0;
+    for (nThreads = 1; nThreads <= 2 * nProcessors; nThreads *= 2) {
+        SetParseThreads(nThreads);
+        elapsed = TimeParallel(filename, nThreads, base);
+        if (nThreads == 1) base = elapsed;
+    }
+    remove(filename);
+    return (0);
+}
+
+/*
+ * Function: WriteNumbers
+ * Usage: WriteNumbers(filename, count);
+ * -------------------------------------
+ * This function writes count pseudo-random real numbers to the
+ * file, four to a line.
+ */
+
+static void WriteNumbers(string filename, long count)
+{
+    FILE *outfile;
+    long i;
+
+    outfile = fopen(filename, "w");
+    if (outfile == NULL) Error("Can't write %s", filename);
+    srand(17);
+    for (i = 0; i < count; i++) {
+        fprintf(outfile, "%.6f%c", rand() / 1000.0 - 1e6,
+                (i % 4 == 3) ? '\n' : ' ');
+    }
+    fprintf(outfile, "\n");
+    fclose(outfile);
+}
+
+/*
+ * Function: TimeSequential
+ * Usage: TimeSequential(filename);
+ * --------------------------------
+ * This function sums the file with ReadReal on a single reader.
+ */
+
+static void TimeSequential(string filename)
+{
+    readerADT reader;
+    double start, sum, d;
+
+    reader = OpenReader(filename);
+    if (reader == NULL) Error("Can't open %s", filename);
+    sum = 0;
+    start = ElapsedTime();
+    while (ReadReal(reader, &d)) sum += d;
+    printf("ReadReal loop          %8.3f s  sum = %.6e\n",
+           ElapsedTime() - start, sum);
+    CloseReader(reader);
+}
+
+/*
+ * Function: TimeParallel
+ * Usage: TimeParallel(filename, nThreads, base);
+ * ----------------------------------------------
+ * This function times SummarizeRealFile and ReadRealFile with
+ * the given number of threads and returns the time taken by the
+ * summary.  The speedup is computed relative to base, the time
+ * taken by one thread; if base is 0, the speedup is taken to be 1.
+ */
+
+static double TimeParallel(string filename, int nThreads, double base)
+{
+    numberSummaryT summary;
+    double start, elapsed, *array;
+    long n;
+
+    start = ElapsedTime();
+    summary = SummarizeRealFile(filename);
+    elapsed = ElapsedTime() - start;
+    if (base == 0) base = elapsed;
+    printf("%2d threads: summary %8.3f s (%4.2fx)", nThreads, elapsed,
+           base / elapsed);
+    start = ElapsedTime();
+    array = ReadRealFile(filename, &n);
+    printf("  array %8.3f s  sum = %.6e\n", ElapsedTime() - start,
+           summary.sum);
+    if (n != summary.count) Error("Count mismatch");
+    FreeBlock(array);
+    return (elapsed);
+}
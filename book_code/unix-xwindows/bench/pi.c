@@ -0,0 +1,569 @@
+/*
+ * File: pi.c
+ * ----------
+ * This program compares three ways of estimating pi when the
+ * work is shared among a pool of threads.  The first sums the
+ * Leibniz series 4 (1 - 1/3 + 1/5 - 1/7 + . . .), as in exercise
+ * 10 of chapter 1; the second adds up the areas of rectangles
+ * under the quarter circle of radius 2, as in exercise 11; and
+ * the third chooses random points in the unit square and counts
+ * the fraction that fall inside the quarter circle.  For the
+ * first two methods, the program begins by timing the simple
+ * loops of the exercises on one thread, which shows how much
+ * accuracy is lost by adding many terms of different sizes to a
+ * single running sum.
+ *
+ * In the parallel versions, the work is divided into a fixed
+ * number of blocks.  Each block is summed with compensated
+ * (Kahan) summation in two independent lanes, which the SSE2
+ * instructions process together, and the block sums are then
+ * combined by pairwise summation.  The random points of block k
+ * come from stream k of a single seed.  Since neither the blocks
+ * nor the order in which their sums are combined depends on the
+ * number of threads, every run of a method gives the same
+ * result.  The program runs each method with 1, 2, 4, and 8
+ * threads and reports the time, the speedup over one thread, and
+ * the error of the estimate.  The optional argument gives the
+ * number of terms, rectangles, and points, which defaults to two
+ * hundred million.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <pthread.h>
+#include <unistd.h>
+#ifdef __SSE2__
+#  include <emmintrin.h>
+#endif
+
+#include "genlib.h"
+#include "random.h"
+#include "benchtime.h"
+
+/*
+ * Constants
+ * ---------
+ * DefaultCount -- Number of terms, rectangles, or points
+ * NBlocks      -- Number of blocks into which the work is divided
+ * NPools       -- Number of pools, with 1, 2, 4, . . . threads
+ * MaxThreads   -- Largest number of threads in a pool
+ * Seed         -- Seed from which the random streams are derived
+ * BufferSize   -- Number of coordinates generated at one time
+ * Radius       -- Radius of the circle used by the quadrature
+ */
+
+#define DefaultCount 200000000
+#define NBlocks 256
+#define NPools 4
+#define MaxThreads 8
+#define Seed 42
+#define BufferSize 4096
+#define Radius 2.0
+
+/*
+ * Type: blockFnT
+ * --------------
+ * A block function computes the sum of the terms from lo up to
+ * but not including hi, where count is the total number of terms
+ * and block is the index of the block.
+ */
+
+typedef double (*blockFnT)(long lo, long hi, long count, int block);
+
+/*
+ * Type: poolT
+ * -----------
+ * This type holds the state of a thread pool.  The threads are
+ * created once and then wait for work.  To start a job, the main
+ * thread stores the block function and the number of terms,
+ * increments the generation number, and wakes the workers, which
+ * take blocks in order from nextBlock and store their sums in
+ * the partials array.  The last worker to finish a job signals
+ * the main thread.
+ */
+
+typedef struct {
+    int nThreads;
+    pthread_t threads[MaxThreads];
+    pthread_mutex_t lock;
+    pthread_cond_t workReady;
+    pthread_cond_t workDone;
+    long generation;
+    int busy;
+    bool stop;
+    blockFnT fn;
+    long count;
+    int nextBlock;
+    double partials[NBlocks];
+} poolT;
+
+/*
+ * Type: methodT
+ * -------------
+ * This type describes one method of estimating pi.  The block
+ * function handles termsPerUnit terms at each step, so the job
+ * for count terms has count / termsPerUnit units.  The estimate
+ * is the sum of the blocks times scale, divided by the number
+ * of units if average is TRUE.
+ */
+
+typedef struct {
+    string name;
+    blockFnT fn;
+    int termsPerUnit;
+    double scale;
+    bool average;
+} methodT;
+
+/* Private function prototypes */
+
+static void TimeNaiveSeries(long count);
+static void TimeNaiveQuadrature(long count);
+static void TimeMethod(methodT *method, poolT pools[], long count);
+static void StartPool(poolT *pool, int nThreads);
+static double RunPool(poolT *pool, blockFnT fn, long count);
+static void StopPool(poolT *pool);
+static void *Worker(void *arg);
+static double PairwiseSum(double array[], int n);
+static double SeriesBlock(long lo, long hi, long count, int block);
+static double QuadratureBlock(long lo, long hi, long count, int block);
+static double MonteCarloBlock(long lo, long hi, long count, int block);
+static void Report(string label, int nThreads, double elapsed,
+                   double base, double estimate);
+
+/* Private variables */
+
+static methodT methods[] = {
+    { "Series", SeriesBlock, 2, 4.0, FALSE },
+    { "Quadrature", QuadratureBlock, 1, 1.0, FALSE },
+    { "MonteCarlo", MonteCarloBlock, 1, 4.0, TRUE },
+};
+
+#define NMethods (sizeof methods / sizeof methods[0])
+
+/* Main program */
+
+int main(int argc, char *argv[])
+{
+    static poolT pools[NPools];
+    long count;
+    int i;
+
+    count = (argc > 1) ? atol(argv[1]) : DefaultCount;
+    printf("%ld terms, %ld processors online\n", count,
+           sysconf(_SC_NPROCESSORS_ONLN));
+    TimeNaiveSeries(count);
+    TimeNaiveQuadrature(count);
+    for (i = 0; i < NPools; i++) StartPool(&pools[i], 1 << i);
+    for (i = 0; i < NMethods; i++) TimeMethod(&methods[i], pools, count);
+    for (i = 0; i < NPools; i++) StopPool(&pools[i]);
+    return (0);
+}
+
+/*
+ * Function: TimeNaiveSeries
+ * Usage: TimeNaiveSeries(count);
+ * ------------------------------
+ * This function times the loop from exercise 10, which adds
+ * count terms of the Leibniz series to a single sum.
+ */
+
+static void TimeNaiveSeries(long count)
+{
+    double start, sum;
+    long i;
+
+    start = ElapsedTime();
+    sum = 0;
+    for (i = 0; i < count; i++) {
+        if (i % 2 == 0) {
+            sum += 1.0 / (2 * i + 1);
+        } else {
+            sum -= 1.0 / (2 * i + 1);
+        }
+    }
+    Report("Series loop", 1, ElapsedTime() - start, 0, 4 * sum);
+}
+
+/*
+ * Function: TimeNaiveQuadrature
+ * Usage: TimeNaiveQuadrature(count);
+ * ----------------------------------
+ * This function times the loop from exercise 11, which adds the
+ * areas of count rectangles to a single sum and finds the next
+ * midpoint by adding the width to the previous one.
+ */
+
+static void TimeNaiveQuadrature(long count)
+{
+    double start, width, x, area;
+    long i;
+
+    start = ElapsedTime();
+    width = Radius / count;
+    x = width / 2;
+    area = 0;
+    for (i = 0; i < count; i++) {
+        area += sqrt(Radius * Radius - x * x) * width;
+        x += width;
+    }
+    Report("Quadrature loop", 1, ElapsedTime() - start, 0, area);
+}
+
+/*
+ * Function: TimeMethod
+ * Usage: TimeMethod(method, pools, count);
+ * ----------------------------------------
+ * This function runs the method on each of the pools, which have
+ * 1, 2, 4, and 8 threads, and reports each run.  Since the blocks
+ * do not depend on the number of threads, every run must give the
+ * same estimate.
+ */
+
+static void TimeMethod(methodT *method, poolT pools[], long count)
+{
+    double start, elapsed, base, sum, estimate, first;
+    long units;
+    int i;
+
+    units = count / method->termsPerUnit;
+    base = first = 0;
+    for (i = 0; i < NPools; i++) {
+        start = ElapsedTime();
+        sum = RunPool(&pools[i], method->fn, units);
+        elapsed = ElapsedTime() - start;
+        estimate = method->scale * sum;
+        if (method->average) estimate /= units;
+        if (i == 0) {
+            base = elapsed;
+            first = estimate;
+        } else if (estimate != first) {
+            Error("%s results differ between runs", method->name);
+        }
+        Report(method->name, pools[i].nThreads, elapsed, base, estimate);
+    }
+}
+
+/*
+ * Function: StartPool
+ * Usage: StartPool(&pool, nThreads);
+ * ----------------------------------
+ * This function initializes the pool and creates its threads.
+ */
+
+static void StartPool(poolT *pool, int nThreads)
+{
+    int i;
+
+    pool->nThreads = nThreads;
+    pool->generation = 0;
+    pool->busy = 0;
+    pool->stop = FALSE;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->workReady, NULL);
+    pthread_cond_init(&pool->workDone, NULL);
+    for (i = 0; i < nThreads; i++) {
+        if (pthread_create(&pool->threads[i], NULL, Worker, pool) != 0) {
+            Error("Can't create thread");
+        }
+    }
+}
+
+/*
+ * Function: RunPool
+ * Usage: sum = RunPool(&pool, fn, count);
+ * ---------------------------------------
+ * This function divides count terms into blocks, has the threads
+ * of the pool apply fn to each block, and returns the pairwise
+ * sum of the results.
+ */
+
+static double RunPool(poolT *pool, blockFnT fn, long count)
+{
+    pthread_mutex_lock(&pool->lock);
+    pool->fn = fn;
+    pool->count = count;
+    pool->nextBlock = 0;
+    pool->busy = pool->nThreads;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->workReady);
+    while (pool->busy > 0) pthread_cond_wait(&pool->workDone, &pool->lock);
+    pthread_mutex_unlock(&pool->lock);
+    return (PairwiseSum(pool->partials, NBlocks));
+}
+
+/*
+ * Function: StopPool
+ * Usage: StopPool(&pool);
+ * -----------------------
+ * This function tells the threads of the pool to exit, waits for
+ * them to do so, and releases the synchronization objects.
+ */
+
+static void StopPool(poolT *pool)
+{
+    int i;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = TRUE;
+    pthread_cond_broadcast(&pool->workReady);
+    pthread_mutex_unlock(&pool->lock);
+    for (i = 0; i < pool->nThreads; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+    pthread_cond_destroy(&pool->workDone);
+    pthread_cond_destroy(&pool->workReady);
+    pthread_mutex_destroy(&pool->lock);
+}
+
+/*
+ * Function: Worker
+ * Usage: pthread_create(&thread, NULL, Worker, &pool);
+ * ----------------------------------------------------
+ * This function is the body of each thread in the pool.  It
+ * waits for a new generation of work, takes blocks until none
+ * remain, and then reports that it is done.
+ */
+
+static void *Worker(void *arg)
+{
+    poolT *pool;
+    long seen, lo, hi;
+    int block;
+
+    pool = (poolT *) arg;
+    seen = 0;
+    pthread_mutex_lock(&pool->lock);
+    while (TRUE) {
+        while (!pool->stop && pool->generation == seen) {
+            pthread_cond_wait(&pool->workReady, &pool->lock);
+        }
+        if (pool->stop) break;
+        seen = pool->generation;
+        while ((block = pool->nextBlock) < NBlocks) {
+            pool->nextBlock++;
+            pthread_mutex_unlock(&pool->lock);
+            lo = pool->count / NBlocks * block;
+            hi = (block == NBlocks - 1) ? pool->count
+                                        : lo + pool->count / NBlocks;
+            pool->partials[block] = pool->fn(lo, hi, pool->count, block);
+            pthread_mutex_lock(&pool->lock);
+        }
+        if (--pool->busy == 0) pthread_cond_signal(&pool->workDone);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return (NULL);
+}
+
+/*
+ * Function: PairwiseSum
+ * Usage: sum = PairwiseSum(array, n);
+ * -----------------------------------
+ * This function returns the sum of the first n elements of the
+ * array, which it computes by adding the sums of the two halves.
+ * The rounding error grows with the logarithm of n rather than
+ * with n itself.
+ */
+
+static double PairwiseSum(double array[], int n)
+{
+    if (n == 1) return (array[0]);
+    return (PairwiseSum(array, n / 2)
+            + PairwiseSum(array + n / 2, n - n / 2));
+}
+
+/*
+ * Function: SeriesBlock
+ * ---------------------
+ * This function sums the pairs of terms 1/(4j+1) - 1/(4j+3) for
+ * j from lo up to hi.  Adjacent pairs are summed in two lanes,
+ * each with its own Kahan compensation, and the lanes are added
+ * at the end.  The pairs are combined before they are added so
+ * that the terms of each sum have the same sign.
+ */
+
+#ifdef __SSE2__
+
+static double SeriesBlock(long lo, long hi, long count, int block)
+{
+    __m128d d, step, one, two, sum, c, y, t;
+    double lanes[2], total;
+    long j;
+
+    d = _mm_set_pd(4.0 * (lo + 1) + 1, 4.0 * lo + 1);
+    step = _mm_set1_pd(8.0);
+    one = _mm_set1_pd(1.0);
+    two = _mm_set1_pd(2.0);
+    sum = c = _mm_setzero_pd();
+    for (j = lo; j + 1 < hi; j += 2) {
+        y = _mm_sub_pd(_mm_sub_pd(_mm_div_pd(one, d),
+                                  _mm_div_pd(one, _mm_add_pd(d, two))), c);
+        t = _mm_add_pd(sum, y);
+        c = _mm_sub_pd(_mm_sub_pd(t, sum), y);
+        sum = t;
+        d = _mm_add_pd(d, step);
+    }
+    _mm_storeu_pd(lanes, sum);
+    total = lanes[0] + lanes[1];
+    if (j < hi) total += 1.0 / (4.0 * j + 1) - 1.0 / (4.0 * j + 3);
+    return (total);
+}
+
+#else
+
+static double SeriesBlock(long lo, long hi, long count, int block)
+{
+    double sum[2], c[2], y, t;
+    long j;
+    int k;
+
+    for (k = 0; k < 2; k++) sum[k] = c[k] = 0;
+    for (j = lo; j < hi; j++) {
+        k = j % 2;
+        y = (1.0 / (4.0 * j + 1) - 1.0 / (4.0 * j + 3)) - c[k];
+        t = sum[k] + y;
+        c[k] = (t - sum[k]) - y;
+        sum[k] = t;
+    }
+    return (sum[0] + sum[1]);
+}
+
+#endif
+
+/*
+ * Function: QuadratureBlock
+ * -------------------------
+ * This function sums the areas of rectangles lo up to hi under
+ * the quarter circle, using two compensated lanes as in
+ * SeriesBlock.  Unlike the loop in exercise 11, it computes each
+ * midpoint from its index, so that errors do not accumulate in
+ * the x coordinate.
+ */
+
+#ifdef __SSE2__
+
+static double QuadratureBlock(long lo, long hi, long count, int block)
+{
+    __m128d i, step, half, width, rsq, x, sum, c, y, t;
+    double lanes[2], total, w, xj;
+    long j;
+
+    w = Radius / count;
+    i = _mm_set_pd((double) (lo + 1), (double) lo);
+    step = _mm_set1_pd(2.0);
+    half = _mm_set1_pd(0.5);
+    width = _mm_set1_pd(w);
+    rsq = _mm_set1_pd(Radius * Radius);
+    sum = c = _mm_setzero_pd();
+    for (j = lo; j + 1 < hi; j += 2) {
+        x = _mm_mul_pd(_mm_add_pd(i, half), width);
+        y = _mm_mul_pd(_mm_sqrt_pd(_mm_sub_pd(rsq, _mm_mul_pd(x, x))), width);
+        y = _mm_sub_pd(y, c);
+        t = _mm_add_pd(sum, y);
+        c = _mm_sub_pd(_mm_sub_pd(t, sum), y);
+        sum = t;
+        i = _mm_add_pd(i, step);
+    }
+    _mm_storeu_pd(lanes, sum);
+    total = lanes[0] + lanes[1];
+    if (j < hi) {
+        xj = (j + 0.5) * w;
+        total += sqrt(Radius * Radius - xj * xj) * w;
+    }
+    return (total);
+}
+
+#else
+
+static double QuadratureBlock(long lo, long hi, long count, int block)
+{
+    double sum[2], c[2], w, x, y, t;
+    long j;
+    int k;
+
+    w = Radius / count;
+    for (k = 0; k < 2; k++) sum[k] = c[k] = 0;
+    for (j = lo; j < hi; j++) {
+        k = j % 2;
+        x = (j + 0.5) * w;
+        y = sqrt(Radius * Radius - x * x) * w - c[k];
+        t = sum[k] + y;
+        c[k] = (t - sum[k]) - y;
+        sum[k] = t;
+    }
+    return (sum[0] + sum[1]);
+}
+
+#endif
+
+/*
+ * Function: MonteCarloBlock
+ * -------------------------
+ * This function chooses hi - lo random points from the stream
+ * for the block and returns the number that lie inside the unit
+ * circle.  The coordinates are generated in bulk by
+ * FillRandomReals, and the points are tested two at a time
+ * after separating their x and y coordinates.
+ */
+
+static double MonteCarloBlock(long lo, long hi, long count, int block)
+{
+    randomADT rng;
+    double buffer[BufferSize];
+    long hits, n, i;
+#ifdef __SSE2__
+    __m128d a, b, x, y, one, inside;
+    int mask;
+#endif
+
+    rng = NewRandomStream(Xoshiro256, Seed, block);
+    hits = 0;
+    while (lo < hi) {
+        n = (hi - lo < BufferSize / 2) ? hi - lo : BufferSize / 2;
+        FillRandomReals(rng, buffer, 2 * n, 0, 1);
+        i = 0;
+#ifdef __SSE2__
+        one = _mm_set1_pd(1.0);
+        for (; i + 1 < n; i += 2) {
+            a = _mm_loadu_pd(&buffer[2 * i]);
+            b = _mm_loadu_pd(&buffer[2 * i + 2]);
+            x = _mm_unpacklo_pd(a, b);
+            y = _mm_unpackhi_pd(a, b);
+            inside = _mm_cmplt_pd(_mm_add_pd(_mm_mul_pd(x, x),
+                                             _mm_mul_pd(y, y)), one);
+            mask = _mm_movemask_pd(inside);
+            hits += (mask & 1) + (mask >> 1);
+        }
+#endif
+        for (; i < n; i++) {
+            if (buffer[2 * i] * buffer[2 * i] + buffer[2 * i + 1]
+                  * buffer[2 * i + 1] < 1) hits++;
+        }
+        lo += n;
+    }
+    FreeRandom(rng);
+    return ((double) hits);
+}
+
+/*
+ * Function: Report
+ * Usage: Report(label, nThreads, elapsed, base, estimate);
+ * --------------------------------------------------------
+ * This function prints the time of a run, its speedup over the
+ * one-thread time in base (if base is nonzero), the estimate of
+ * pi, and the error of the estimate.
+ */
+
+static void Report(string label, int nThreads, double elapsed,
+                   double base, double estimate)
+{
+    printf("%-15s %d thread%s %8.3f s", label, nThreads,
+           (nThreads == 1) ? " " : "s", elapsed);
+    if (base > 0) {
+        printf("  speedup %5.2f", base / elapsed);
+    } else {
+        printf("                ");
+    }
+    printf("  pi = %.15f  error %.1e\n", estimate, fabs(estimate - M_PI));
+}
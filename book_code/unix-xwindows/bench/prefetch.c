@@ -0,0 +1,208 @@
+/*
+ * File: prefetch.c
+ * ----------------
+ * This program measures the effect of EnablePrefetch on readers
+ * that take their input from a pipe.  The first test sends a
+ * file of real numbers through a pipe from a child process and
+ * times how long the parent takes to sum them, which shows how
+ * well reading overlaps parsing.  The second test has the child
+ * write one time-stamped line every millisecond and reports the
+ * average delay between the time each line is written and the
+ * time the parent sees it, which shows how quickly a slowly
+ * arriving line reaches the client.  The optional arguments give
+ * the number of values in the first test, which defaults to ten
+ * million, and the number of lines in the second, which defaults
+ * to one thousand.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "genlib.h"
+#include "simpio.h"
+#include "benchtime.h"
+
+/*
+ * Constants
+ * ---------
+ * DefaultCount     -- Number of values if no argument is given
+ * DefaultLines     -- Number of time-stamped lines by default
+ * LineInterval     -- Microseconds between time-stamped lines
+ */
+
+#define DefaultCount 10000000
+#define DefaultLines 1000
+#define LineInterval 1000
+
+/* Private function prototypes */
+
+static void WriteNumbers(string filename, long count);
+static void TimeSum(string label, string filename, bool prefetch);
+static void TimeLatency(string label, long nlines, bool prefetch);
+static readerADT OpenPipe(pid_t *pidp, FILE **pipep);
+static void ClosePipe(readerADT reader, FILE *pipe, pid_t pid);
+
+/* Main program */
+
+int main(int argc, char *argv[])
+{
+    char filename[] = "/tmp/numbersXXXXXX";
+    long count, nlines;
+
+    count = (argc > 1) ? atol(argv[1]) : DefaultCount;
+    nlines = (argc > 2) ? atol(argv[2]) : DefaultLines;
+    if (mkstemp(filename) < 0) Error("Can't create temporary file");
+    WriteNumbers(filename, count);
+    TimeSum("sum, streaming", filename, FALSE);
+    TimeSum("sum, prefetch", filename, TRUE);
+    remove(filename);
+    TimeLatency("delay, streaming", nlines, FALSE);
+    TimeLatency("delay, prefetch", nlines, TRUE);
+    return (0);
+}
+
+/*
+ * Function: WriteNumbers
+ * Usage: WriteNumbers(filename, count);
+ * -------------------------------------
+ * This function writes count pseudo-random real numbers to the
+ * file, one per line.
+ */
+
+static void WriteNumbers(string filename, long count)
+{
+    FILE *outfile;
+    long i;
+
+    outfile = fopen(filename, "w");
+    if (outfile == NULL) Error("Can't write %s", filename);
+    srand(17);
+    for (i = 0; i < count; i++) {
+        fprintf(outfile, "%.6f\n", rand() / 1000.0 - 1e6);
+    }
+    fclose(outfile);
+}
+
+/*
+ * Function: TimeSum
+ * Usage: TimeSum(label, filename, prefetch);
+ * ------------------------------------------
+ * This function starts a child process that copies the file into
+ * a pipe, sums the numbers that arrive on the pipe, and reports
+ * the elapsed time.
+ */
+
+static void TimeSum(string label, string filename, bool prefetch)
+{
+    readerADT reader;
+    FILE *pipe, *infile;
+    pid_t pid;
+    char buffer[BUFSIZ];
+    double start, value, sum;
+    size_t n;
+
+    start = ElapsedTime();
+    reader = OpenPipe(&pid, &pipe);
+    if (pid == 0) {
+        infile = fopen(filename, "r");
+        if (infile == NULL) _exit(1);
+        while ((n = fread(buffer, 1, BUFSIZ, infile)) > 0) {
+            fwrite(buffer, 1, n, pipe);
+        }
+        fclose(pipe);
+        _exit(0);
+    }
+    if (prefetch) EnablePrefetch(reader);
+    sum = 0;
+    while (ReadReal(reader, &value)) sum += value;
+    printf("%-18s %8.3f s  sum = %.6e\n", label, ElapsedTime() - start, sum);
+    ClosePipe(reader, pipe, pid);
+}
+
+/*
+ * Function: TimeLatency
+ * Usage: TimeLatency(label, nlines, prefetch);
+ * --------------------------------------------
+ * This function starts a child process that writes nlines lines
+ * to a pipe at regular intervals, each containing the time at
+ * which it was written, and reports the average delay before
+ * the lines are seen by the parent.
+ */
+
+static void TimeLatency(string label, long nlines, bool prefetch)
+{
+    readerADT reader;
+    FILE *pipe;
+    pid_t pid;
+    double stamp, total;
+    long i, n;
+
+    reader = OpenPipe(&pid, &pipe);
+    if (pid == 0) {
+        for (i = 0; i < nlines; i++) {
+            fprintf(pipe, "%.9f\n", ElapsedTime());
+            fflush(pipe);
+            usleep(LineInterval);
+        }
+        fclose(pipe);
+        _exit(0);
+    }
+    if (prefetch) EnablePrefetch(reader);
+    total = 0;
+    n = 0;
+    while (ReadReal(reader, &stamp)) {
+        total += ElapsedTime() - stamp;
+        n++;
+    }
+    printf("%-18s %8.3f ms (%ld lines)\n", label,
+           (n == 0) ? 0.0 : 1000 * total / n, n);
+    ClosePipe(reader, pipe, pid);
+}
+
+/*
+ * Function: OpenPipe
+ * Usage: reader = OpenPipe(&pid, &pipe);
+ * --------------------------------------
+ * This function creates a pipe and forks a child process.  In
+ * the child, it returns NULL after setting pid to 0 and pipe to
+ * a stream that writes to the pipe.  In the parent, it returns a
+ * line-separated reader for the other end of the pipe and sets
+ * pid to the process id of the child.
+ */
+
+static readerADT OpenPipe(pid_t *pidp, FILE **pipep)
+{
+    readerADT reader;
+    int fds[2];
+
+    if (pipe(fds) < 0) Error("Can't create pipe");
+    *pidp = fork();
+    if (*pidp < 0) Error("Can't create process");
+    if (*pidp == 0) {
+        close(fds[0]);
+        *pipep = fdopen(fds[1], "w");
+        return (NULL);
+    }
+    close(fds[1]);
+    *pipep = fdopen(fds[0], "r");
+    reader = NewReader(*pipep);
+    SetNumberLayout(reader, LineSeparated);
+    return (reader);
+}
+
+/*
+ * Function: ClosePipe
+ * Usage: ClosePipe(reader, pipe, pid);
+ * ------------------------------------
+ * This function closes the reader and the pipe and waits for the
+ * child process to exit.
+ */
+
+static void ClosePipe(readerADT reader, FILE *pipe, pid_t pid)
+{
+    CloseReader(reader);
+    fclose(pipe);
+    waitpid(pid, NULL, 0);
+}
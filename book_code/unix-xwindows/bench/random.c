@@ -0,0 +1,280 @@
+/*
+ * File: random.c
+ * --------------
+ * This program measures the throughput of the random number
+ * generators in random.h and compares them with the rand
+ * function from the C library.  It times the raw output of
+ * rand and of each generator type, and then times RandomInteger
+ * against OldRandomInteger, which reproduces the original
+ * implementation based on rand.  Finally, it compares filling an
+ * array with RandomIntegerFrom and RandomRealFrom in a loop to
+ * filling it with FillRandomIntegers and FillRandomReals, and
+ * compares three ways of performing trials with a fixed
+ * probability: RandomChanceFrom, TestChance, and RandomChanceMask.
+ * The optional argument gives the number of values generated by
+ * each test, which defaults to two hundred million.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "genlib.h"
+#include "random.h"
+#include "benchtime.h"
+
+/*
+ * Constants
+ * ---------
+ * DefaultCount -- Number of values if no argument is given
+ * ArraySize    -- Size of the array filled by the fill tests
+ * Probability  -- Probability of success in the chance tests
+ */
+
+#define DefaultCount 200000000
+#define ArraySize 1000000
+#define Probability 0.3
+
+/* Private function prototypes */
+
+static void TimeRand(long count);
+static void TimeGenerator(string label, generatorT type, long count);
+static void TimeRandomInteger(string label, int (*fn)(int low, int high),
+                              long count);
+static void TimeIntegerFills(long count);
+static void TimeRealFills(long count);
+static void TimeChances(long count);
+static int OldRandomInteger(int low, int high);
+static void Report(string label, double start, long count,
+                   double checksum);
+
+/* Main program */
+
+int main(int argc, char *argv[])
+{
+    long count;
+
+    count = (argc > 1) ? atol(argv[1]) : DefaultCount;
+    TimeRand(count);
+    TimeGenerator("Xoshiro256", Xoshiro256, count);
+    TimeGenerator("PCG32", PCG32, count);
+    TimeRandomInteger("OldRandomInteger", OldRandomInteger, count);
+    TimeRandomInteger("RandomInteger", RandomInteger, count);
+    TimeIntegerFills(count);
+    TimeRealFills(count);
+    TimeChances(count);
+    return (0);
+}
+
+/*
+ * Function: TimeRand
+ * Usage: TimeRand(count);
+ * -----------------------
+ * This function times count calls to rand.
+ */
+
+static void TimeRand(long count)
+{
+    double start, checksum;
+    long i;
+
+    start = ElapsedTime();
+    checksum = 0;
+    for (i = 0; i < count; i++) checksum += rand();
+    Report("rand", start, count, checksum);
+}
+
+/*
+ * Function: TimeGenerator
+ * Usage: TimeGenerator(label, type, count);
+ * -----------------------------------------
+ * This function times count calls to NextRandom on a generator
+ * of the given type.
+ */
+
+static void TimeGenerator(string label, generatorT type, long count)
+{
+    randomADT rng;
+    double start;
+    uint64_t bits;
+    long i;
+
+    rng = NewRandom(type, 17);
+    start = ElapsedTime();
+    bits = 0;
+    for (i = 0; i < count; i++) bits ^= NextRandom(rng);
+    Report(label, start, count, (double) (bits >> 11));
+    FreeRandom(rng);
+}
+
+/*
+ * Function: TimeRandomInteger
+ * Usage: TimeRandomInteger(label, fn, count);
+ * -------------------------------------------
+ * This function times count calls to a function with the same
+ * prototype as RandomInteger, rolling a six-sided die.
+ */
+
+static void TimeRandomInteger(string label, int (*fn)(int low, int high),
+                              long count)
+{
+    double start, checksum;
+    long i;
+
+    start = ElapsedTime();
+    checksum = 0;
+    for (i = 0; i < count; i++) checksum += fn(1, 6);
+    Report(label, start, count, checksum);
+}
+
+/*
+ * Function: TimeIntegerFills
+ * Usage: TimeIntegerFills(count);
+ * -------------------------------
+ * This function fills an array with count integers in the range
+ * 0 to 999, first by calling RandomIntegerFrom for each element
+ * and then by calling FillRandomIntegers.
+ */
+
+static void TimeIntegerFills(long count)
+{
+    randomADT rng;
+    int *array;
+    double start, checksum;
+    long i, done;
+
+    rng = NewRandom(Xoshiro256, 17);
+    array = NewArray(ArraySize, int);
+    start = ElapsedTime();
+    checksum = 0;
+    for (done = 0; done < count; done += ArraySize) {
+        for (i = 0; i < ArraySize; i++) {
+            array[i] = RandomIntegerFrom(rng, 0, 999);
+        }
+        checksum += array[0];
+    }
+    Report("RandomIntegerFrom", start, done, checksum);
+    start = ElapsedTime();
+    checksum = 0;
+    for (done = 0; done < count; done += ArraySize) {
+        FillRandomIntegers(rng, array, ArraySize, 0, 999);
+        checksum += array[0];
+    }
+    Report("FillRandomIntegers", start, done, checksum);
+    FreeBlock(array);
+    FreeRandom(rng);
+}
+
+/*
+ * Function: TimeRealFills
+ * Usage: TimeRealFills(count);
+ * ----------------------------
+ * This function fills an array with count reals in the interval
+ * [0,1), first by calling RandomRealFrom for each element and
+ * then by calling FillRandomReals.
+ */
+
+static void TimeRealFills(long count)
+{
+    randomADT rng;
+    double *array;
+    double start, checksum;
+    long i, done;
+
+    rng = NewRandom(Xoshiro256, 17);
+    array = NewArray(ArraySize, double);
+    start = ElapsedTime();
+    checksum = 0;
+    for (done = 0; done < count; done += ArraySize) {
+        for (i = 0; i < ArraySize; i++) {
+            array[i] = RandomRealFrom(rng, 0, 1);
+        }
+        checksum += array[0];
+    }
+    Report("RandomRealFrom", start, done, checksum);
+    start = ElapsedTime();
+    checksum = 0;
+    for (done = 0; done < count; done += ArraySize) {
+        FillRandomReals(rng, array, ArraySize, 0, 1);
+        checksum += array[0];
+    }
+    Report("FillRandomReals", start, done, checksum);
+    FreeBlock(array);
+    FreeRandom(rng);
+}
+
+/*
+ * Function: TimeChances
+ * Usage: TimeChances(count);
+ * --------------------------
+ * This function counts the successes in count trials with the
+ * same probability, first by calling RandomChanceFrom, then by
+ * calling TestChance, and finally by counting the bits in the
+ * words returned by RandomChanceMask.  The checksum is the
+ * number of successes per thousand trials.
+ */
+
+static void TimeChances(long count)
+{
+    randomADT rng;
+    chanceT chance;
+    double start;
+    long i, successes;
+
+    rng = NewRandom(Xoshiro256, 17);
+    start = ElapsedTime();
+    successes = 0;
+    for (i = 0; i < count; i++) {
+        if (RandomChanceFrom(rng, Probability)) successes++;
+    }
+    Report("RandomChanceFrom", start, count, 1000.0 * successes / count);
+    chance = MakeChance(Probability);
+    start = ElapsedTime();
+    successes = 0;
+    for (i = 0; i < count; i++) {
+        if (TestChance(rng, chance)) successes++;
+    }
+    Report("TestChance", start, count, 1000.0 * successes / count);
+    start = ElapsedTime();
+    successes = 0;
+    for (i = 0; i < count; i += 64) {
+        successes += __builtin_popcountll(RandomChanceMask(rng, chance));
+    }
+    Report("RandomChanceMask", start, i, 1000.0 * successes / i);
+    FreeRandom(rng);
+}
+
+/*
+ * Function: OldRandomInteger
+ * Usage: n = OldRandomInteger(low, high);
+ * ---------------------------------------
+ * This function is the original implementation of RandomInteger.
+ */
+
+static int OldRandomInteger(int low, int high)
+{
+    int k;
+    double d;
+
+    d = (double) rand() / ((double) RAND_MAX + 1);
+    k = (int) (d * (high - low + 1));
+    return (low + k);
+}
+
+/*
+ * Function: Report
+ * Usage: Report(label, start, count, checksum);
+ * ---------------------------------------------
+ * This function prints the elapsed time since start and the
+ * number of values generated per second.  The checksum is
+ * printed only to keep the compiler from discarding the loop.
+ */
+
+static void Report(string label, double start, long count,
+                   double checksum)
+{
+    double elapsed;
+
+    elapsed = ElapsedTime() - start;
+    printf("%-18s %8.3f s %8.1f M/s  (checksum %.0f)\n", label, elapsed,
+           count / elapsed / 1e6, checksum);
+}
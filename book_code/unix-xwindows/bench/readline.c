@@ -0,0 +1,135 @@
+/*
+ * File: readline.c
+ * ----------------
+ * This program measures the throughput of ReadLine by reading a
+ * file line by line.  For comparison, it also reads the file with
+ * the original character-at-a-time implementation of ReadLine,
+ * which is reproduced here as OldReadLine, and with the line
+ * views provided by a reader.  To obtain meaningful
+ * numbers, the file should be several gigabytes long, which can
+ * be arranged with a command such as
+ *
+ *     yes "the quick brown fox jumps over the lazy dog" |
+ *         head -c 4G > lines.txt
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "genlib.h"
+#include "simpio.h"
+#include "benchtime.h"
+
+/* Private function prototypes */
+
+static void TimeReader(string label, string filename,
+                       string (*reader)(FILE *infile));
+static void TimeLineViews(string filename);
+static string OldReadLine(FILE *infile);
+
+/* Main program */
+
+int main(int argc, char *argv[])
+{
+    if (argc != 2) Error("Usage: readline file");
+    TimeReader("ReadLine", argv[1], ReadLine);
+    TimeReader("OldReadLine", argv[1], OldReadLine);
+    TimeLineViews(argv[1]);
+    return (0);
+}
+
+/*
+ * Function: TimeReader
+ * Usage: TimeReader(label, filename, reader);
+ * -------------------------------------------
+ * This function reads every line of the file using the reader
+ * function and reports the elapsed time and throughput.
+ */
+
+static void TimeReader(string label, string filename,
+                       string (*reader)(FILE *infile))
+{
+    FILE *infile;
+    string line;
+    double start, elapsed, nbytes, nlines;
+
+    infile = fopen(filename, "r");
+    if (infile == NULL) Error("Can't open %s", filename);
+    nbytes = nlines = 0;
+    start = ElapsedTime();
+    while ((line = reader(infile)) != NULL) {
+        nbytes += strlen(line) + 1;
+        nlines++;
+        FreeBlock(line);
+    }
+    elapsed = ElapsedTime() - start;
+    fclose(infile);
+    printf("%-12s %12.0f lines %8.3f s %9.1f MB/s\n", label, nlines,
+           elapsed, nbytes / elapsed / 1e6);
+}
+
+/*
+ * Function: TimeLineViews
+ * Usage: TimeLineViews(filename);
+ * -------------------------------
+ * This function reads every line of the file using a reader
+ * and reports the elapsed time and throughput.
+ */
+
+static void TimeLineViews(string filename)
+{
+    readerADT reader;
+    lineViewT view;
+    double start, elapsed, nbytes, nlines;
+
+    reader = OpenReader(filename);
+    if (reader == NULL) Error("Can't open %s", filename);
+    nbytes = nlines = 0;
+    start = ElapsedTime();
+    while (ReadLineView(reader, &view)) {
+        nbytes += view.length + 1;
+        nlines++;
+    }
+    elapsed = ElapsedTime() - start;
+    CloseReader(reader);
+    printf("%-12s %12.0f lines %8.3f s %9.1f MB/s\n", "LineViews",
+           nlines, elapsed, nbytes / elapsed / 1e6);
+}
+
+/*
+ * Function: OldReadLine
+ * Usage: s = OldReadLine(infile);
+ * -------------------------------
+ * This function is the original implementation of ReadLine,
+ * which reads one character at a time and copies the line into
+ * a block of the exact size before returning it.
+ */
+
+static string OldReadLine(FILE *infile)
+{
+    string line, nline;
+    int n, ch, size;
+
+    n = 0;
+    size = 120;
+    line = GetBlock(size + 1);
+    while ((ch = getc(infile)) != '\n' && ch != EOF) {
+        if (n == size) {
+            size *= 2;
+            nline = (string) GetBlock(size + 1);
+            strncpy(nline, line, n);
+            FreeBlock(line);
+            line = nline;
+        }
+        line[n++] = ch;
+    }
+    if (n == 0 && ch == EOF) {
+        FreeBlock(line);
+        return (NULL);
+    }
+    line[n] = '\0';
+    nline = (string) GetBlock(n + 1);
+    strcpy(nline, line);
+    FreeBlock(line);
+    return (nline);
+}
@@ -0,0 +1,180 @@
+/*
+ * File: sampling.c
+ * ----------------
+ * This program measures the speed of the shuffling and sampling
+ * functions in random.h on large arrays.  It compares
+ * ShuffleArray with a shuffle that calls RandomInteger for each
+ * element, which is how programs shuffled arrays before
+ * ShuffleArray existed, and then times SampleIndices, a
+ * reservoir reading a stream of the same length, and an alias
+ * table built from that many weights.  The optional argument
+ * gives the number of elements, which defaults to one hundred
+ * million.  The alias table test needs about 32 bytes for each
+ * element.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "genlib.h"
+#include "random.h"
+#include "benchtime.h"
+
+/*
+ * Constants
+ * ---------
+ * DefaultCount   -- Number of elements if no argument is given
+ * SampleFraction -- Ratio of the array size to the sample size
+ * ReservoirSize  -- Size of the sample taken by the reservoir
+ */
+
+#define DefaultCount 100000000
+#define SampleFraction 100
+#define ReservoirSize 1000
+
+/* Private function prototypes */
+
+static void TimeShuffles(randomADT rng, long n);
+static void TimeSample(randomADT rng, long n);
+static void TimeReservoir(randomADT rng, long n);
+static void TimeAlias(randomADT rng, long n);
+static void Report(string label, double start, long n, long check);
+
+/* Main program */
+
+int main(int argc, char *argv[])
+{
+    randomADT rng;
+    long n;
+
+    n = (argc > 1) ? atol(argv[1]) : DefaultCount;
+    rng = NewRandom(Xoshiro256, 17);
+    TimeShuffles(rng, n);
+    TimeSample(rng, n);
+    TimeReservoir(rng, n);
+    TimeAlias(rng, n);
+    FreeRandom(rng);
+    return (0);
+}
+
+/*
+ * Function: TimeShuffles
+ * Usage: TimeShuffles(rng, n);
+ * ----------------------------
+ * This function shuffles an array of n integers, first with a
+ * loop that calls RandomInteger and then with ShuffleArray.
+ */
+
+static void TimeShuffles(randomADT rng, long n)
+{
+    int *array;
+    long i, j;
+    int t;
+    double start;
+
+    array = NewArray(n, int);
+    for (i = 0; i < n; i++) array[i] = (int) i;
+    start = ElapsedTime();
+    for (i = n - 1; i > 0; i--) {
+        j = RandomInteger(0, (int) i);
+        t = array[i];
+        array[i] = array[j];
+        array[j] = t;
+    }
+    Report("RandomInteger loop", start, n, array[0]);
+    start = ElapsedTime();
+    ShuffleArray(rng, array, n, sizeof array[0]);
+    Report("ShuffleArray", start, n, array[0]);
+    FreeBlock(array);
+}
+
+/*
+ * Function: TimeSample
+ * Usage: TimeSample(rng, n);
+ * --------------------------
+ * This function chooses n / SampleFraction distinct indices
+ * from the range 0 to n - 1 with SampleIndices.
+ */
+
+static void TimeSample(randomADT rng, long n)
+{
+    long *sample, k;
+    double start;
+
+    k = n / SampleFraction;
+    sample = NewArray(k, long);
+    start = ElapsedTime();
+    SampleIndices(rng, sample, k, n);
+    Report("SampleIndices", start, k, sample[0]);
+    FreeBlock(sample);
+}
+
+/*
+ * Function: TimeReservoir
+ * Usage: TimeReservoir(rng, n);
+ * -----------------------------
+ * This function passes a stream of n integers through a
+ * reservoir that keeps a sample of ReservoirSize of them.
+ */
+
+static void TimeReservoir(randomADT rng, long n)
+{
+    reservoirADT reservoir;
+    long sample[ReservoirSize], i, slot;
+    double start;
+
+    start = ElapsedTime();
+    reservoir = NewReservoir(rng, ReservoirSize);
+    for (i = 0; i < n; i++) {
+        slot = NextReservoirSlot(reservoir);
+        if (slot >= 0) sample[slot] = i;
+    }
+    FreeReservoir(reservoir);
+    Report("Reservoir", start, n, sample[0]);
+}
+
+/*
+ * Function: TimeAlias
+ * Usage: TimeAlias(rng, n);
+ * -------------------------
+ * This function builds an alias table from n random weights and
+ * then chooses n integers from it, timing the two steps
+ * separately.
+ */
+
+static void TimeAlias(randomADT rng, long n)
+{
+    aliasADT table;
+    double *weights, start;
+    long i, sum;
+
+    weights = NewArray(n, double);
+    FillRandomReals(rng, weights, n, 0, 1);
+    start = ElapsedTime();
+    table = NewAliasTable(weights, n);
+    Report("NewAliasTable", start, n, 0);
+    FreeBlock(weights);
+    start = ElapsedTime();
+    sum = 0;
+    for (i = 0; i < n; i++) sum += RandomAlias(rng, table);
+    Report("RandomAlias", start, n, sum / n);
+    FreeAliasTable(table);
+}
+
+/*
+ * Function: Report
+ * Usage: Report(label, start, n, check);
+ * --------------------------------------
+ * This function prints the elapsed time since start and the
+ * number of elements processed per second.  The check value is
+ * printed only to keep the compiler from discarding the work.
+ */
+
+static void Report(string label, double start, long n, long check)
+{
+    double elapsed;
+
+    elapsed = ElapsedTime() - start;
+    printf("%-18s %8.3f s %8.1f M/s  (check %ld)\n", label, elapsed,
+           n / elapsed / 1e6, check);
+}
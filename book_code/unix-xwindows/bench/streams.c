@@ -0,0 +1,162 @@
+/*
+ * File: streams.c
+ * ---------------
+ * This program shows that a Monte Carlo computation that uses
+ * one random stream for each piece of its work gives the same
+ * result no matter how many threads share the work.  It
+ * estimates pi by choosing random points in the unit square and
+ * counting the fraction that fall inside the quarter circle.
+ * The points are divided into a fixed number of blocks, and the
+ * points of block k are drawn from stream k of a single seed.
+ * The program repeats the computation with 1, 2, 4, and 8
+ * threads, reports the elapsed time of each run, and checks that
+ * every run counts exactly the same points.  The optional
+ * argument gives the number of points, which defaults to two
+ * hundred million.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "genlib.h"
+#include "random.h"
+#include "benchtime.h"
+
+/*
+ * Constants
+ * ---------
+ * DefaultCount -- Number of points if no argument is given
+ * NBlocks      -- Number of blocks, each with its own stream
+ * MaxThreads   -- Largest number of threads used
+ * Seed         -- Seed from which the streams are derived
+ */
+
+#define DefaultCount 200000000
+#define NBlocks 64
+#define MaxThreads 8
+#define Seed 42
+
+/*
+ * Type: jobT
+ * ----------
+ * This type holds the state shared by the threads of one run.
+ * The threads take blocks in order from nextBlock and store the
+ * number of hits for each block in the hits array.
+ */
+
+typedef struct {
+    long pointsPerBlock;
+    int nextBlock;
+    long hits[NBlocks];
+    pthread_mutex_t lock;
+} jobT;
+
+/* Private function prototypes */
+
+static long RunJob(long pointsPerBlock, int nThreads);
+static void *Worker(void *arg);
+static long CountHits(randomADT rng, long n);
+
+/* Main program */
+
+int main(int argc, char *argv[])
+{
+    long count, pointsPerBlock, hits, firstHits;
+    int nThreads;
+    double start;
+
+    count = (argc > 1) ? atol(argv[1]) : DefaultCount;
+    pointsPerBlock = count / NBlocks;
+    firstHits = -1;
+    for (nThreads = 1; nThreads <= MaxThreads; nThreads *= 2) {
+        start = ElapsedTime();
+        hits = RunJob(pointsPerBlock, nThreads);
+        printf("%d thread%s %8.3f s  pi = %.9f\n", nThreads,
+               (nThreads == 1) ? " " : "s", ElapsedTime() - start,
+               4.0 * hits / (pointsPerBlock * NBlocks));
+        if (firstHits == -1) firstHits = hits;
+        if (hits != firstHits) Error("Results differ between runs");
+    }
+    printf("All runs counted %ld hits\n", firstHits);
+    return (0);
+}
+
+/*
+ * Function: RunJob
+ * Usage: hits = RunJob(pointsPerBlock, nThreads);
+ * -----------------------------------------------
+ * This function divides the blocks among nThreads threads and
+ * returns the total number of hits.
+ */
+
+static long RunJob(long pointsPerBlock, int nThreads)
+{
+    jobT job;
+    pthread_t threads[MaxThreads];
+    long total;
+    int i;
+
+    job.pointsPerBlock = pointsPerBlock;
+    job.nextBlock = 0;
+    pthread_mutex_init(&job.lock, NULL);
+    for (i = 0; i < nThreads; i++) {
+        if (pthread_create(&threads[i], NULL, Worker, &job) != 0) {
+            Error("Can't create thread");
+        }
+    }
+    for (i = 0; i < nThreads; i++) pthread_join(threads[i], NULL);
+    pthread_mutex_destroy(&job.lock);
+    total = 0;
+    for (i = 0; i < NBlocks; i++) total += job.hits[i];
+    return (total);
+}
+
+/*
+ * Function: Worker
+ * Usage: pthread_create(&thread, NULL, Worker, &job);
+ * ---------------------------------------------------
+ * This function is the body of each thread.  It repeatedly takes
+ * the next block and counts its hits using the block's stream.
+ */
+
+static void *Worker(void *arg)
+{
+    jobT *job;
+    randomADT rng;
+    int block;
+
+    job = (jobT *) arg;
+    while (TRUE) {
+        pthread_mutex_lock(&job->lock);
+        block = job->nextBlock++;
+        pthread_mutex_unlock(&job->lock);
+        if (block >= NBlocks) break;
+        rng = NewRandomStream(Xoshiro256, Seed, block);
+        job->hits[block] = CountHits(rng, job->pointsPerBlock);
+        FreeRandom(rng);
+    }
+    return (NULL);
+}
+
+/*
+ * Function: CountHits
+ * Usage: hits = CountHits(rng, n);
+ * --------------------------------
+ * This function chooses n random points in the unit square and
+ * returns the number that lie inside the unit circle.
+ */
+
+static long CountHits(randomADT rng, long n)
+{
+    double x, y;
+    long i, hits;
+
+    hits = 0;
+    for (i = 0; i < n; i++) {
+        x = RandomRealFrom(rng, 0, 1);
+        y = RandomRealFrom(rng, 0, 1);
+        if (x * x + y * y < 1) hits++;
+    }
+    return (hits);
+}
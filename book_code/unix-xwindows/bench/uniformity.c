@@ -0,0 +1,250 @@
+/*
+ * File: uniformity.c
+ * ------------------
+ * This program checks that RandomIntegerFrom, RandomRealFrom,
+ * FillRandomIntegers, and FillRandomReals choose their values
+ * uniformly.  Each test draws values from its own stream, counts
+ * how many fall into each of a set of equal bins that cover the
+ * range, and computes the chi-square statistic of the counts.
+ * The ranges are chosen to expose the usual mistakes: a small
+ * range such as [-3,3]; a range 3 * 2^30 wide, in which reducing
+ * a 32-bit value modulo the size makes the first third of the
+ * range twice as likely as the rest; the range of every int,
+ * whose size does not fit in 32 bits; and reals in [2,5).  The
+ * program reports each statistic together with the bounds
+ * within which it must lie and calls Error if any statistic is
+ * out of bounds.  The optional argument gives the number of
+ * values in each test, which defaults to thirty million.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <limits.h>
+#include <math.h>
+
+#include "genlib.h"
+#include "random.h"
+#include "benchtime.h"
+
+/*
+ * Constants
+ * ---------
+ * DefaultCount -- Number of values in each test if no argument is given
+ * ArraySize    -- Size of the array filled at each step
+ * MaxBins      -- Largest number of bins used by a test
+ * ZLimit       -- Standard deviations allowed on either side
+ * Seed         -- Seed from which the streams are derived
+ */
+
+#define DefaultCount 30000000
+#define ArraySize 100000
+#define MaxBins 256
+#define ZLimit 5.0
+#define Seed 35
+
+/*
+ * Type: testT
+ * -----------
+ * A test draws values in the range from low to high, either by
+ * calling RandomIntegerFrom or RandomRealFrom for each value or
+ * by filling an array, and counts them in nBins bins.  For an
+ * integer test, nBins must divide the number of integers in the
+ * range, so that every bin holds the same number of them.
+ */
+
+typedef struct {
+    string label;
+    bool real, fill;
+    double low, high;
+    int nBins;
+} testT;
+
+/* Private function prototypes */
+
+static bool RunTest(testT *test, long count, int stream);
+static void CountIntegers(testT *test, randomADT rng, long count,
+                          long counts[]);
+static void CountReals(testT *test, randomADT rng, long count,
+                       long counts[]);
+static double ChiSquareBound(int df, double z);
+
+/* Private variables */
+
+static testT tests[] = {
+    { "RandomIntegerFrom [-3,3]", FALSE, FALSE, -3, 3, 7 },
+    { "FillRandomIntegers [-3,3]", FALSE, TRUE, -3, 3, 7 },
+    { "RandomIntegerFrom 3*2^30", FALSE, FALSE,
+      INT_MIN, INT_MIN + 3221225471.0, 192 },
+    { "FillRandomIntegers 3*2^30", FALSE, TRUE,
+      INT_MIN, INT_MIN + 3221225471.0, 192 },
+    { "RandomIntegerFrom all ints", FALSE, FALSE, INT_MIN, INT_MAX, 256 },
+    { "FillRandomIntegers all ints", FALSE, TRUE, INT_MIN, INT_MAX, 256 },
+    { "RandomRealFrom [2,5)", TRUE, FALSE, 2, 5, 100 },
+    { "FillRandomReals [2,5)", TRUE, TRUE, 2, 5, 100 }
+};
+
+/* Main program */
+
+int main(int argc, char *argv[])
+{
+    long count;
+    int i, failures;
+
+    count = (argc > 1) ? atol(argv[1]) : DefaultCount;
+    failures = 0;
+    for (i = 0; i < sizeof tests / sizeof tests[0]; i++) {
+        if (!RunTest(&tests[i], count, i)) failures++;
+    }
+    if (failures > 0) {
+        Error("%d statistic%s out of bounds", failures,
+              (failures == 1) ? "" : "s");
+    }
+    printf("All statistics within bounds\n");
+    return (0);
+}
+
+/*
+ * Function: RunTest
+ * Usage: ok = RunTest(test, count, stream);
+ * -----------------------------------------
+ * This function draws count values for the test from the given
+ * stream, reports the chi-square statistic of the bin counts,
+ * and returns TRUE if the statistic lies within the bounds.
+ */
+
+static bool RunTest(testT *test, long count, int stream)
+{
+    randomADT rng;
+    long counts[MaxBins];
+    double expected, chi2, lower, upper, start;
+    int i, df;
+    bool ok;
+
+    start = ElapsedTime();
+    rng = NewRandomStream(Xoshiro256, Seed, stream);
+    for (i = 0; i < test->nBins; i++) counts[i] = 0;
+    if (test->real) {
+        CountReals(test, rng, count, counts);
+    } else {
+        CountIntegers(test, rng, count, counts);
+    }
+    FreeRandom(rng);
+    expected = (double) count / test->nBins;
+    chi2 = 0;
+    for (i = 0; i < test->nBins; i++) {
+        chi2 += (counts[i] - expected) * (counts[i] - expected) / expected;
+    }
+    df = test->nBins - 1;
+    lower = ChiSquareBound(df, -ZLimit);
+    upper = ChiSquareBound(df, ZLimit);
+    ok = (chi2 >= lower && chi2 <= upper);
+    printf("%-28s %8.3f s  chi2(%3d) = %8.2f  in [%6.2f, %6.2f]  %s\n",
+           test->label, ElapsedTime() - start, df, chi2, lower, upper,
+           (ok) ? "ok" : "FAILED");
+    return (ok);
+}
+
+/*
+ * Function: CountIntegers
+ * Usage: CountIntegers(test, rng, count, counts);
+ * -----------------------------------------------
+ * This function draws count integers for the test and adds each
+ * one to its bin.  The offset of a value from the bottom of the
+ * range is computed in unsigned arithmetic, since the range may
+ * be wider than any int.  A value outside the range is an error.
+ */
+
+static void CountIntegers(testT *test, randomADT rng, long count,
+                          long counts[])
+{
+    int *array;
+    int low, high;
+    uint64_t binWidth;
+    uint32_t offset;
+    long done, n, i;
+
+    low = (int) test->low;
+    high = (int) test->high;
+    binWidth = ((uint64_t) (uint32_t) (high - (unsigned) low) + 1)
+               / test->nBins;
+    array = NewArray(ArraySize, int);
+    for (done = 0; done < count; done += n) {
+        n = (count - done < ArraySize) ? count - done : ArraySize;
+        if (test->fill) {
+            FillRandomIntegers(rng, array, n, low, high);
+        } else {
+            for (i = 0; i < n; i++) {
+                array[i] = RandomIntegerFrom(rng, low, high);
+            }
+        }
+        for (i = 0; i < n; i++) {
+            if (array[i] < low || array[i] > high) {
+                Error("%s: %d is out of range", test->label, array[i]);
+            }
+            offset = (uint32_t) array[i] - (uint32_t) low;
+            counts[offset / binWidth]++;
+        }
+    }
+    FreeBlock(array);
+}
+
+/*
+ * Function: CountReals
+ * Usage: CountReals(test, rng, count, counts);
+ * --------------------------------------------
+ * This function draws count reals for the test and adds each one
+ * to its bin.  A value outside the half-open range is an error.
+ */
+
+static void CountReals(testT *test, randomADT rng, long count,
+                       long counts[])
+{
+    double *array;
+    double scale;
+    long done, n, i;
+    int bin;
+
+    scale = test->nBins / (test->high - test->low);
+    array = NewArray(ArraySize, double);
+    for (done = 0; done < count; done += n) {
+        n = (count - done < ArraySize) ? count - done : ArraySize;
+        if (test->fill) {
+            FillRandomReals(rng, array, n, test->low, test->high);
+        } else {
+            for (i = 0; i < n; i++) {
+                array[i] = RandomRealFrom(rng, test->low, test->high);
+            }
+        }
+        for (i = 0; i < n; i++) {
+            if (array[i] < test->low || array[i] >= test->high) {
+                Error("%s: %g is out of range", test->label, array[i]);
+            }
+            bin = (int) ((array[i] - test->low) * scale);
+            if (bin >= test->nBins) bin = test->nBins - 1;
+            counts[bin]++;
+        }
+    }
+    FreeBlock(array);
+}
+
+/*
+ * Function: ChiSquareBound
+ * Usage: bound = ChiSquareBound(df, z);
+ * -------------------------------------
+ * This function returns the value of the chi-square distribution
+ * with df degrees of freedom that lies z standard deviations from
+ * the center, using the approximation of Wilson and Hilferty, in
+ * which the cube root of chi2 / df is nearly normal.  With z equal
+ * to ZLimit, a correct generator falls outside the bounds less
+ * than once in a million tests.
+ */
+
+static double ChiSquareBound(int df, double z)
+{
+    double v, t;
+
+    v = 2.0 / (9.0 * df);
+    t = 1 - v + z * sqrt(v);
+    return ((t <= 0) ? 0 : df * t * t * t);
+}
@@ -0,0 +1,113 @@
+/*
+ * File: writer.c
+ * --------------
+ * This program compares the speed of writing a formatted table
+ * with printf against the speed of writing the same table with a
+ * writer.  Each line contains two integers and a real number, in
+ * the style of the powertab program.  The first argument gives
+ * the number of lines, which defaults to one hundred million,
+ * and the second gives the output file, which defaults to
+ * /dev/null so that the timing measures only formatting and
+ * buffering.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "genlib.h"
+#include "simpio.h"
+#include "benchtime.h"
+
+/*
+ * Constants
+ * ---------
+ * DefaultCount -- Number of lines if no argument is given
+ */
+
+#define DefaultCount 100000000
+
+/* Private function prototypes */
+
+static void TimePrintf(string filename, long count);
+static void TimeWriter(string filename, long count);
+static void Report(string label, long count, double elapsed);
+
+/* Main program */
+
+int main(int argc, char *argv[])
+{
+    long count;
+    string filename;
+
+    count = (argc > 1) ? atol(argv[1]) : DefaultCount;
+    filename = (argc > 2) ? argv[2] : "/dev/null";
+    TimePrintf(filename, count);
+    TimeWriter(filename, count);
+    return (0);
+}
+
+/*
+ * Function: TimePrintf
+ * Usage: TimePrintf(filename, count);
+ * -----------------------------------
+ * This function writes the table using fprintf.
+ */
+
+static void TimePrintf(string filename, long count)
+{
+    FILE *outfile;
+    double start;
+    long i;
+
+    outfile = fopen(filename, "w");
+    if (outfile == NULL) Error("Can't write %s", filename);
+    start = ElapsedTime();
+    for (i = 0; i < count; i++) {
+        fprintf(outfile, " %2ld | %10ld | %9.3f\n", i % 100, i * i % 9973,
+                i / 7.0);
+    }
+    fclose(outfile);
+    Report("printf", count, ElapsedTime() - start);
+}
+
+/*
+ * Function: TimeWriter
+ * Usage: TimeWriter(filename, count);
+ * -----------------------------------
+ * This function writes the same table using a writer.
+ */
+
+static void TimeWriter(string filename, long count)
+{
+    writerADT writer;
+    double start;
+    long i;
+
+    writer = OpenWriter(filename);
+    if (writer == NULL) Error("Can't write %s", filename);
+    start = ElapsedTime();
+    for (i = 0; i < count; i++) {
+        WriteChar(writer, ' ');
+        WriteInteger(writer, i % 100, 2);
+        WriteString(writer, " | ");
+        WriteInteger(writer, i * i % 9973, 10);
+        WriteString(writer, " | ");
+        WriteReal(writer, i / 7.0, 9, 3);
+        WriteChar(writer, '\n');
+    }
+    CloseWriter(writer);
+    Report("writer", count, ElapsedTime() - start);
+}
+
+/*
+ * Function: Report
+ * Usage: Report(label, count, elapsed);
+ * -------------------------------------
+ * This function prints one line of results.
+ */
+
+static void Report(string label, long count, double elapsed)
+{
+    printf("%-8s %10ld lines %8.3f s %8.2f M lines/s\n", label, count,
+           elapsed, count / elapsed / 1e6);
+}
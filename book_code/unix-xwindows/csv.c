@@ -0,0 +1,482 @@
+/*
+ * File: csv.c
+ * Version: 1.0
+ * -----------------------------------------------------
+ * This file implements the csv.h interface.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#ifdef __SSE2__
+#  include <emmintrin.h>
+#endif
+
+#include "genlib.h"
+#include "simpio.h"
+#include "csv.h"
+
+/*
+ * Constants:
+ * ----------
+ * InitialFieldCount -- Initial size of the array of fields
+ * InitialRecordSize -- Initial size of the buffer for quoted records
+ * ArenaBlockSize    -- Size of the blocks that hold view columns
+ */
+
+#define InitialFieldCount 16
+#define InitialRecordSize 1024
+#define ArenaBlockSize 65536
+
+/*
+ * Type: blockT
+ * ------------
+ * The characters of view columns are stored in a linked list of
+ * blocks.  The blocks are not freed between calls to ReadColumns
+ * but are simply marked as empty, so that once the list has
+ * grown to the size of a typical batch no further allocation is
+ * needed.
+ */
+
+typedef struct blockT {
+    char *chars;
+    size_t size, used;
+    struct blockT *next;
+} blockT;
+
+/*
+ * Type: csvCDT
+ * ------------
+ * This type is the concrete representation of a CSV reader.
+ * The fields of the current record are stored as an array of
+ * views.  Most records contain no quotation marks, and their
+ * fields point directly into the line returned by the reader.
+ * A record that contains quotation marks is copied into the
+ * record buffer with the quoting removed, and its fields point
+ * into that buffer instead.
+ */
+
+struct csvCDT {
+    readerADT reader;
+    bool ownsReader;
+    char delimiter;
+    lineViewT *fields;
+    int nFields, fieldCapacity;
+    char *record;
+    size_t recordSize;
+    blockT *blocks, *current;
+    long lineNumber;
+};
+
+/* Private function prototypes */
+
+static bool SplitFields(csvADT csv, char *cp, char *end);
+static void SplitQuotedRecord(csvADT csv, lineViewT line);
+static void ExpandRecord(csvADT csv, size_t minSize);
+static void AddField(csvADT csv, char *start, size_t length);
+static void StoreColumn(csvADT csv, columnT *column, long row);
+static char *AllocateChars(csvADT csv, size_t n);
+static void ResetBlocks(csvADT csv);
+
+/* Exported entries */
+
+csvADT OpenCSV(string filename)
+{
+    readerADT reader;
+    csvADT csv;
+
+    reader = OpenReader(filename);
+    if (reader == NULL) return (NULL);
+    csv = NewCSV(reader);
+    csv->ownsReader = TRUE;
+    return (csv);
+}
+
+csvADT NewCSV(readerADT reader)
+{
+    csvADT csv;
+
+    csv = New(csvADT);
+    csv->reader = reader;
+    csv->ownsReader = FALSE;
+    csv->delimiter = ',';
+    csv->fieldCapacity = InitialFieldCount;
+    csv->fields = NewArray(InitialFieldCount, lineViewT);
+    csv->nFields = 0;
+    csv->recordSize = InitialRecordSize;
+    csv->record = GetBlock(InitialRecordSize);
+    csv->blocks = csv->current = NULL;
+    csv->lineNumber = 0;
+    return (csv);
+}
+
+void SetCSVDelimiter(csvADT csv, char delimiter)
+{
+    if (delimiter == '"' || delimiter == '\n') {
+        Error("SetCSVDelimiter: illegal delimiter");
+    }
+    csv->delimiter = delimiter;
+}
+
+/*
+ * Function: ReadRecord
+ * --------------------
+ * The record is first split on the assumption that it contains
+ * no quotation marks.  If SplitFields finds one, the record is
+ * split again by SplitQuotedRecord, which handles the general
+ * case.  A carriage return at the end of the line is removed so
+ * that files with DOS line endings are read correctly.
+ */
+
+bool ReadRecord(csvADT csv)
+{
+    lineViewT line;
+    char *end;
+
+    csv->lineNumber = ReaderLineNumber(csv->reader);
+    if (!ReadLineView(csv->reader, &line)) return (FALSE);
+    csv->nFields = 0;
+    end = line.start + line.length;
+    if (line.length > 0 && end[-1] == '\r') end--;
+    if (!SplitFields(csv, line.start, end)) {
+        csv->nFields = 0;
+        SplitQuotedRecord(csv, line);
+    }
+    return (TRUE);
+}
+
+int FieldCount(csvADT csv)
+{
+    return (csv->nFields);
+}
+
+lineViewT GetField(csvADT csv, int index)
+{
+    if (index < 0 || index >= csv->nFields) {
+        Error("GetField: line %ld: no field %d", csv->lineNumber, index);
+    }
+    return (csv->fields[index]);
+}
+
+int FindField(csvADT csv, string name)
+{
+    size_t len;
+    int i;
+
+    len = strlen(name);
+    for (i = 0; i < csv->nFields; i++) {
+        if (csv->fields[i].length == len
+              && memcmp(csv->fields[i].start, name, len) == 0) {
+            return (i);
+        }
+    }
+    return (-1);
+}
+
+long CSVLineNumber(csvADT csv)
+{
+    return (csv->lineNumber);
+}
+
+long ReadColumns(csvADT csv, columnT columns[], int ncolumns,
+                 long maxRecords)
+{
+    long row;
+    int i;
+
+    ResetBlocks(csv);
+    for (row = 0; row < maxRecords && ReadRecord(csv); row++) {
+        for (i = 0; i < ncolumns; i++) {
+            StoreColumn(csv, &columns[i], row);
+        }
+    }
+    return (row);
+}
+
+void CloseCSV(csvADT csv)
+{
+    blockT *block, *next;
+
+    for (block = csv->blocks; block != NULL; block = next) {
+        next = block->next;
+        FreeBlock(block->chars);
+        FreeBlock(block);
+    }
+    if (csv->ownsReader) CloseReader(csv->reader);
+    FreeBlock(csv->fields);
+    FreeBlock(csv->record);
+    FreeBlock(csv);
+}
+
+/* Private functions */
+
+/*
+ * Function: SplitFields
+ * Usage: if (SplitFields(csv, cp, end)) . . .
+ * -------------------------------------------
+ * This function splits the characters between cp and end at
+ * each delimiter, adding the fields to the current record, and
+ * returns TRUE.  If it finds a quotation mark, it stops and
+ * returns FALSE.  When SSE2 is available, the function examines
+ * sixteen characters at a time: one comparison finds every
+ * delimiter in the block and produces a bit mask, from which
+ * the positions of the delimiters are extracted one bit at a
+ * time.  The remaining characters are examined individually.
+ */
+
+static bool SplitFields(csvADT csv, char *cp, char *end)
+{
+    char *start;
+#ifdef __SSE2__
+    __m128i delimiters, quotes, chars;
+    unsigned mask;
+    char *pos;
+
+    delimiters = _mm_set1_epi8(csv->delimiter);
+    quotes = _mm_set1_epi8('"');
+    start = cp;
+    while (end - cp >= 16) {
+        chars = _mm_loadu_si128((__m128i *) cp);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(chars, quotes)) != 0) {
+            return (FALSE);
+        }
+        mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chars, delimiters));
+        while (mask != 0) {
+            pos = cp + __builtin_ctz(mask);
+            AddField(csv, start, pos - start);
+            start = pos + 1;
+            mask &= mask - 1;
+        }
+        cp += 16;
+    }
+#else
+    start = cp;
+#endif
+    for (; cp < end; cp++) {
+        if (*cp == '"') return (FALSE);
+        if (*cp == csv->delimiter) {
+            AddField(csv, start, cp - start);
+            start = cp + 1;
+        }
+    }
+    AddField(csv, start, end - start);
+    return (TRUE);
+}
+
+/*
+ * Function: SplitQuotedRecord
+ * Usage: SplitQuotedRecord(csv, line);
+ * ------------------------------------
+ * This function splits a record that contains quotation marks,
+ * starting with the given line.  The characters of the fields
+ * are copied into the record buffer with the quoting removed.
+ * A quotation mark begins a quoted field only if it is the first
+ * character of the field; elsewhere, it is an ordinary character.
+ * If a line ends inside a quoted field, the newline is part of
+ * the field and the record continues on the next line.  Because
+ * the record buffer may move when it is expanded, the positions
+ * in it are kept as offsets while the record is being copied.
+ */
+
+static void SplitQuotedRecord(csvADT csv, lineViewT line)
+{
+    char *cp, *end, *dst;
+    size_t len, fieldStart;
+    bool inQuotes;
+    char ch;
+
+    len = fieldStart = 0;
+    inQuotes = FALSE;
+    while (TRUE) {
+        ExpandRecord(csv, len + line.length + 1);
+        cp = line.start;
+        end = cp + line.length;
+        dst = csv->record + len;
+        while (cp < end) {
+            ch = *cp++;
+            if (inQuotes) {
+                if (ch != '"') {
+                    *dst++ = ch;
+                } else if (cp < end && *cp == '"') {
+                    *dst++ = *cp++;
+                } else {
+                    inQuotes = FALSE;
+                }
+            } else if (ch == csv->delimiter) {
+                AddField(csv, csv->record + fieldStart,
+                         dst - csv->record - fieldStart);
+                fieldStart = dst - csv->record;
+            } else if (ch == '"' && dst == csv->record + fieldStart) {
+                inQuotes = TRUE;
+            } else {
+                *dst++ = ch;
+            }
+        }
+        if (!inQuotes) break;
+        *dst++ = '\n';
+        len = dst - csv->record;
+        if (!ReadLineView(csv->reader, &line)) {
+            Error("ReadRecord: line %ld: unterminated quoted field",
+                  csv->lineNumber);
+        }
+    }
+    if (line.length > 0 && end[-1] == '\r') dst--;
+    AddField(csv, csv->record + fieldStart,
+             dst - csv->record - fieldStart);
+}
+
+/*
+ * Function: ExpandRecord
+ * Usage: ExpandRecord(csv, minSize);
+ * ----------------------------------
+ * This function makes sure that the record buffer holds at least
+ * minSize characters, doubling its size as often as necessary.
+ * Any fields that already point into the buffer are moved along
+ * with it.
+ */
+
+static void ExpandRecord(csvADT csv, size_t minSize)
+{
+    char *nbuffer;
+    size_t nsize;
+    int i;
+
+    if (minSize <= csv->recordSize) return;
+    nsize = csv->recordSize;
+    while (nsize < minSize) nsize *= 2;
+    nbuffer = GetBlock(nsize);
+    memcpy(nbuffer, csv->record, csv->recordSize);
+    for (i = 0; i < csv->nFields; i++) {
+        csv->fields[i].start = nbuffer + (csv->fields[i].start - csv->record);
+    }
+    FreeBlock(csv->record);
+    csv->record = nbuffer;
+    csv->recordSize = nsize;
+}
+
+/*
+ * Function: AddField
+ * Usage: AddField(csv, start, length);
+ * ------------------------------------
+ * This function adds a field to the current record, doubling the
+ * size of the array of fields if it is full.
+ */
+
+static void AddField(csvADT csv, char *start, size_t length)
+{
+    lineViewT *nfields;
+
+    if (csv->nFields == csv->fieldCapacity) {
+        nfields = NewArray(csv->fieldCapacity * 2, lineViewT);
+        memcpy(nfields, csv->fields, csv->nFields * sizeof (lineViewT));
+        FreeBlock(csv->fields);
+        csv->fields = nfields;
+        csv->fieldCapacity *= 2;
+    }
+    csv->fields[csv->nFields].start = start;
+    csv->fields[csv->nFields].length = length;
+    csv->nFields++;
+}
+
+/*
+ * Function: StoreColumn
+ * Usage: StoreColumn(csv, column, row);
+ * -------------------------------------
+ * This function stores the field selected by the column into
+ * element row of the column's array.
+ */
+
+static void StoreColumn(csvADT csv, columnT *column, long row)
+{
+    lineViewT field, *vp;
+    long value;
+
+    if (column->index < 0 || column->index >= csv->nFields) {
+        Error("ReadColumns: line %ld: no field %d", csv->lineNumber,
+              column->index);
+    }
+    field = csv->fields[column->index];
+    switch (column->type) {
+      case IntColumn:
+        if (!ViewToLong(field, &value)) {
+            Error("ReadColumns: line %ld: field %d is not an integer",
+                  csv->lineNumber, column->index);
+        }
+        if (value < INT_MIN || value > INT_MAX) {
+            Error("ReadColumns: line %ld: field %d is out of range",
+                  csv->lineNumber, column->index);
+        }
+        ((int *) column->values)[row] = (int) value;
+        break;
+      case LongColumn:
+        if (!ViewToLong(field, (long *) column->values + row)) {
+            Error("ReadColumns: line %ld: field %d is not an integer",
+                  csv->lineNumber, column->index);
+        }
+        break;
+      case RealColumn:
+        if (!ViewToReal(field, (double *) column->values + row)) {
+            Error("ReadColumns: line %ld: field %d is not a real number",
+                  csv->lineNumber, column->index);
+        }
+        break;
+      case ViewColumn:
+        vp = (lineViewT *) column->values + row;
+        vp->start = AllocateChars(csv, field.length);
+        memcpy(vp->start, field.start, field.length);
+        vp->length = field.length;
+        break;
+      default:
+        Error("ReadColumns: illegal column type");
+    }
+}
+
+/*
+ * Function: AllocateChars
+ * Usage: cp = AllocateChars(csv, n);
+ * ----------------------------------
+ * This function returns space for n characters in the blocks
+ * that hold view columns, moving to the next block, or adding a
+ * new one, if the current block is full.
+ */
+
+static char *AllocateChars(csvADT csv, size_t n)
+{
+    blockT *block, **linkp;
+    char *cp;
+
+    block = csv->current;
+    while (block != NULL && block->used + n > block->size) {
+        block = block->next;
+        if (block != NULL) block->used = 0;
+    }
+    if (block == NULL) {
+        block = New(blockT *);
+        block->size = (n > ArenaBlockSize) ? n : ArenaBlockSize;
+        block->chars = GetBlock(block->size);
+        block->used = 0;
+        block->next = NULL;
+        linkp = &csv->blocks;
+        while (*linkp != NULL) linkp = &(*linkp)->next;
+        *linkp = block;
+    }
+    csv->current = block;
+    cp = block->chars + block->used;
+    block->used += n;
+    return (cp);
+}
+
+/*
+ * Function: ResetBlocks
+ * Usage: ResetBlocks(csv);
+ * ------------------------
+ * This function marks the storage for view columns as empty.
+ * The blocks after the first are emptied as AllocateChars
+ * reaches them.
+ */
+
+static void ResetBlocks(csvADT csv)
+{
+    csv->current = csv->blocks;
+    if (csv->current != NULL) csv->current->used = 0;
+}
@@ -0,0 +1,177 @@
+/*
+ * File: csv.h
+ * Version: 1.0
+ * -----------------------------------------------------
+ * This interface provides a reader for files of comma-separated
+ * values, in which each line is a record and the fields of the
+ * record are separated by commas.  A field that contains the
+ * delimiter, a quotation mark, or a newline is enclosed in
+ * quotation marks, and any quotation mark inside it is doubled.
+ * The package is built on the readers in simpio.h and, like
+ * them, identifies the characters of each field by a view
+ * rather than allocating a new string for each one.
+ */
+
+#ifndef _csv_h
+#define _csv_h
+
+#include "genlib.h"
+#include "simpio.h"
+
+/*
+ * Type: csvADT
+ * ------------
+ * This abstract type represents a CSV file that is being read
+ * one record at a time.
+ */
+
+typedef struct csvCDT *csvADT;
+
+/*
+ * Function: OpenCSV
+ * Usage: csv = OpenCSV(filename);
+ * -------------------------------
+ * OpenCSV opens the named file and returns a CSV reader for it.
+ * If the file cannot be opened, OpenCSV returns NULL.
+ */
+
+csvADT OpenCSV(string filename);
+
+/*
+ * Function: NewCSV
+ * Usage: csv = NewCSV(reader);
+ * ----------------------------
+ * NewCSV returns a CSV reader that takes its input from an
+ * existing reader, which allows CSV data to be read from a pipe
+ * or from standard input.  The reader is not closed when the
+ * CSV reader is closed, and its other settings, such as the
+ * number layout, are left unchanged.
+ */
+
+csvADT NewCSV(readerADT reader);
+
+/*
+ * Function: SetCSVDelimiter
+ * Usage: SetCSVDelimiter(csv, '\t');
+ * ----------------------------------
+ * This function changes the character that separates fields,
+ * which is initially a comma.
+ */
+
+void SetCSVDelimiter(csvADT csv, char delimiter);
+
+/*
+ * Function: ReadRecord
+ * Usage: while (ReadRecord(csv)) . . .
+ * ------------------------------------
+ * ReadRecord reads the next record from the file and returns
+ * TRUE, or returns FALSE at the end of the file.  The fields of
+ * the record are then available through FieldCount and GetField.
+ * A quoted field may extend over several lines, in which case
+ * the record includes all of them.  If the file ends inside a
+ * quoted field, ReadRecord calls Error.
+ */
+
+bool ReadRecord(csvADT csv);
+
+/*
+ * Function: FieldCount
+ * Usage: n = FieldCount(csv);
+ * ---------------------------
+ * This function returns the number of fields in the record most
+ * recently read by ReadRecord.  An empty line is a record with
+ * one empty field.
+ */
+
+int FieldCount(csvADT csv);
+
+/*
+ * Function: GetField
+ * Usage: view = GetField(csv, index);
+ * -----------------------------------
+ * This function returns a view of the field at the given index
+ * in the current record, where the first field has index 0.
+ * The enclosing quotation marks of a quoted field are removed,
+ * as are the extra quotation marks in any doubled pair.  The
+ * view remains valid only until the next record is read.
+ */
+
+lineViewT GetField(csvADT csv, int index);
+
+/*
+ * Function: FindField
+ * Usage: index = FindField(csv, name);
+ * ------------------------------------
+ * This function returns the index of the first field in the
+ * current record that is equal to name, or -1 if there is no
+ * such field.  It is typically used on the header record to
+ * locate the columns that a program needs.
+ */
+
+int FindField(csvADT csv, string name);
+
+/*
+ * Function: CSVLineNumber
+ * Usage: n = CSVLineNumber(csv);
+ * ------------------------------
+ * This function returns the line number on which the current
+ * record begins, which clients can use to report errors.
+ */
+
+long CSVLineNumber(csvADT csv);
+
+/*
+ * Type: columnT
+ * -------------
+ * A column describes where ReadColumns stores one field of each
+ * record.  The index field gives the position of the field in
+ * the record, and the type field determines how it is stored.
+ * The values field points to an array with one element for each
+ * record that ReadColumns may read: an array of int for an
+ * IntColumn, of long for a LongColumn, of double for a
+ * RealColumn, and of lineViewT for a ViewColumn.
+ */
+
+typedef enum {
+    IntColumn, LongColumn, RealColumn, ViewColumn
+} columnTypeT;
+
+typedef struct {
+    int index;
+    columnTypeT type;
+    void *values;
+} columnT;
+
+/*
+ * Function: ReadColumns
+ * Usage: n = ReadColumns(csv, columns, ncolumns, maxRecords);
+ * -----------------------------------------------------------
+ * ReadColumns reads up to maxRecords records and stores the
+ * selected fields of each one in the arrays described by the
+ * columns array, whose effective size is ncolumns.  The
+ * function returns the number of records read, which is less
+ * than maxRecords only at the end of the file.  Numeric fields
+ * are parsed directly from the input without allocating
+ * storage.  The characters of view columns are kept in storage
+ * owned by the CSV reader, so the views remain valid until the
+ * next call that reads from it.  If a record is missing a
+ * selected field, if a numeric field does not contain a legal
+ * number, or if the value of an int column does not fit in an
+ * int, ReadColumns calls Error with a message that includes the
+ * line number.
+ */
+
+long ReadColumns(csvADT csv, columnT columns[], int ncolumns,
+                 long maxRecords);
+
+/*
+ * Function: CloseCSV
+ * Usage: CloseCSV(csv);
+ * ---------------------
+ * CloseCSV frees the storage associated with the CSV reader.
+ * If the CSV reader was created by OpenCSV, the file is closed.
+ */
+
+void CloseCSV(csvADT csv);
+
+#endif
@@ -35,10 +35,10 @@ exception ErrorException = { "ErrorException" };
  * context blocks that act as the exception stack.  The chain
  * pointer is referenced by the macros in exception.h and must
  * therefore be exported, but clients should not reference it
- * directly.
+ * directly.  Each thread has its own copy of the variable.
  */
 
-context_block *exceptionStack = NULL;
+_Thread_local context_block *exceptionStack = NULL;
 
 /* Private function prototypes */
 
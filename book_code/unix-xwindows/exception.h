@@ -191,9 +191,13 @@ typedef struct ctx_block {
 extern exception ErrorException;
 extern exception ANY;
 
-/* Declare a global pointer to the context stack */
+/*
+ * Declare a global pointer to the context stack.  Each thread has
+ * its own stack, so that an exception raised in one thread is
+ * never caught by a handler established in another.
+ */
 
-extern context_block *exceptionStack;
+extern _Thread_local context_block *exceptionStack;
 
 /*
  * Function: RaiseException
@@ -0,0 +1,1237 @@
+/*
+ * File: fbdisplay.c
+ * -----------------
+ * This file implements the xdisplay.h interface without an X
+ * server.  Instead of drawing into X windows, it renders every
+ * operation into a framebuffer in memory, which makes it possible
+ * to run programs that use the graphics library on machines that
+ * have no display, at whatever speed the processor allows.  When
+ * the display is closed, the contents of the framebuffer can be
+ * saved as an image file, so that the output of a program can be
+ * compared with the output of an earlier run.  Programs use this
+ * implementation by linking with the headless version of the
+ * library in place of the standard one.
+ */
+
+/*
+ * General implementation notes
+ * ----------------------------
+ * The framebuffer is an array of pixels, each of which holds a
+ * color packed into an unsigned integer as 0xRRGGBB.  Lines are
+ * drawn with the Bresenham algorithm, arcs as a series of short
+ * lines, and text using a small built-in bitmap font that is
+ * scaled by an integral factor to approximate the requested point
+ * size.  Filled regions are assembled into a polygon in the same
+ * way as in xdisplay.c and then filled one scan line at a time
+ * using the even-odd rule, with the gray scales represented by
+ * the same stipple patterns used by the X implementation.
+ *
+ * If the environment variable GRAPHICS_SNAPSHOT is set, the
+ * framebuffer is written to the file it names when the display is
+ * closed.  The image is written in PNG format if the name ends
+ * with .png and as a binary PPM file otherwise.
+ *
+ * Because there is no window, there are no events to process and
+ * no redraws to perform.  The mouse stays in the corner of the
+ * window with its button up, and XDWaitForMouse returns at once,
+ * as if the user had pressed or released the button, so that
+ * programs that wait for the mouse run to completion.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <zlib.h>
+
+#include "genlib.h"
+#include "strlib.h"
+#include "glibrary.h"
+#include "extgraph.h"
+#include "xmanager.h"
+#include "xdisplay.h"
+
+/*
+ * Parameters
+ * ----------
+ * RequiredMargin -- Minimum margin on each side of screen (inches)
+ * PStartSize     -- Starting size for polygon (must be greater than 1)
+ * ScreenDPI      -- Resolution of the simulated screen
+ * ScreenPixelsX  -- Width of the simulated screen in pixels
+ * ScreenPixelsY  -- Height of the simulated screen in pixels
+ * ColorBits      -- Number of bits in each pixel
+ * SnapshotVar    -- Environment variable naming the snapshot file
+ * MaxArcError    -- Distance in pixels by which a region may miss an arc
+ */
+
+#define RequiredMargin   0.5
+#define PStartSize      50
+#define ScreenDPI       96
+#define ScreenPixelsX 1920
+#define ScreenPixelsY 1080
+#define ColorBits       24
+#define SnapshotVar     "GRAPHICS_SNAPSHOT"
+#define MaxArcError      0.25
+
+/*
+ * Other constants
+ * ---------------
+ * Epsilon     -- Small offset used to avoid banding/aliasing
+ * EraseColor  -- Color used for erasing (white)
+ * GlyphWidth  -- Number of columns in each character bitmap
+ * GlyphHeight -- Number of rows in each character bitmap
+ * CellWidth   -- Horizontal spacing of characters before scaling
+ * CellHeight  -- Vertical spacing of lines before scaling
+ * FirstGlyph  -- First character in the font table
+ * LastGlyph   -- Last character in the font table
+ */
+
+#define Epsilon 0.000000001
+#define EraseColor 0xFFFFFF
+#define GlyphWidth   5
+#define GlyphHeight  7
+#define CellWidth    6
+#define CellHeight   9
+#define FirstGlyph ' '
+#define LastGlyph  '~'
+
+/*
+ * Static table: grayList
+ * ----------------------
+ * This table contains the bitmaps for the various gray-scale
+ * values, which are the same as the stipples used by xdisplay.c.
+ * As in an X bitmap, the low-order bit of each byte corresponds
+ * to the leftmost pixel of the row.
+ */
+
+static char grayList[][8] = {
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },
+    { 0x88, 0x22, 0x88, 0x22, 0x88, 0x22, 0x88, 0x22 },
+    { 0x55, 0xAA, 0x55, 0xAA, 0x55, 0xAA, 0x55, 0xAA },
+    { 0x77, 0xDD, 0x77, 0xDD, 0x77, 0xDD, 0x77, 0xDD },
+    { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF },
+};
+
+#define NGrays (sizeof grayList / sizeof grayList[0])
+
+/*
+ * Static table: fontTable
+ * -----------------------
+ * This table contains the bitmaps for the printable ASCII
+ * characters.  Each character is represented by GlyphWidth bytes,
+ * one for each column from left to right, in which the low-order
+ * bit corresponds to the top row and bit 6 to the row that rests
+ * on the baseline.
+ */
+
+static unsigned char fontTable[][GlyphWidth] = {
+    { 0x00, 0x00, 0x00, 0x00, 0x00 },   /* space */
+    { 0x00, 0x00, 0x5F, 0x00, 0x00 },   /* ! */
+    { 0x00, 0x07, 0x00, 0x07, 0x00 },   /* " */
+    { 0x14, 0x7F, 0x14, 0x7F, 0x14 },   /* # */
+    { 0x24, 0x2A, 0x7F, 0x2A, 0x12 },   /* $ */
+    { 0x23, 0x13, 0x08, 0x64, 0x62 },   /* % */
+    { 0x36, 0x49, 0x55, 0x22, 0x50 },   /* & */
+    { 0x00, 0x05, 0x03, 0x00, 0x00 },   /* ' */
+    { 0x00, 0x1C, 0x22, 0x41, 0x00 },   /* ( */
+    { 0x00, 0x41, 0x22, 0x1C, 0x00 },   /* ) */
+    { 0x14, 0x08, 0x3E, 0x08, 0x14 },   /* * */
+    { 0x08, 0x08, 0x3E, 0x08, 0x08 },   /* + */
+    { 0x00, 0x50, 0x30, 0x00, 0x00 },   /* , */
+    { 0x08, 0x08, 0x08, 0x08, 0x08 },   /* - */
+    { 0x00, 0x60, 0x60, 0x00, 0x00 },   /* . */
+    { 0x20, 0x10, 0x08, 0x04, 0x02 },   /* / */
+    { 0x3E, 0x51, 0x49, 0x45, 0x3E },   /* 0 */
+    { 0x00, 0x42, 0x7F, 0x40, 0x00 },   /* 1 */
+    { 0x42, 0x61, 0x51, 0x49, 0x46 },   /* 2 */
+    { 0x21, 0x41, 0x45, 0x4B, 0x31 },   /* 3 */
+    { 0x18, 0x14, 0x12, 0x7F, 0x10 },   /* 4 */
+    { 0x27, 0x45, 0x45, 0x45, 0x39 },   /* 5 */
+    { 0x3C, 0x4A, 0x49, 0x49, 0x30 },   /* 6 */
+    { 0x01, 0x71, 0x09, 0x05, 0x03 },   /* 7 */
+    { 0x36, 0x49, 0x49, 0x49, 0x36 },   /* 8 */
+    { 0x06, 0x49, 0x49, 0x29, 0x1E },   /* 9 */
+    { 0x00, 0x36, 0x36, 0x00, 0x00 },   /* : */
+    { 0x00, 0x56, 0x36, 0x00, 0x00 },   /* ; */
+    { 0x08, 0x14, 0x22, 0x41, 0x00 },   /* < */
+    { 0x14, 0x14, 0x14, 0x14, 0x14 },   /* = */
+    { 0x00, 0x41, 0x22, 0x14, 0x08 },   /* > */
+    { 0x02, 0x01, 0x51, 0x09, 0x06 },   /* ? */
+    { 0x32, 0x49, 0x79, 0x41, 0x3E },   /* @ */
+    { 0x7E, 0x11, 0x11, 0x11, 0x7E },   /* A */
+    { 0x7F, 0x49, 0x49, 0x49, 0x36 },   /* B */
+    { 0x3E, 0x41, 0x41, 0x41, 0x22 },   /* C */
+    { 0x7F, 0x41, 0x41, 0x22, 0x1C },   /* D */
+    { 0x7F, 0x49, 0x49, 0x49, 0x41 },   /* E */
+    { 0x7F, 0x09, 0x09, 0x09, 0x01 },   /* F */
+    { 0x3E, 0x41, 0x49, 0x49, 0x7A },   /* G */
+    { 0x7F, 0x08, 0x08, 0x08, 0x7F },   /* H */
+    { 0x00, 0x41, 0x7F, 0x41, 0x00 },   /* I */
+    { 0x20, 0x40, 0x41, 0x3F, 0x01 },   /* J */
+    { 0x7F, 0x08, 0x14, 0x22, 0x41 },   /* K */
+    { 0x7F, 0x40, 0x40, 0x40, 0x40 },   /* L */
+    { 0x7F, 0x02, 0x0C, 0x02, 0x7F },   /* M */
+    { 0x7F, 0x04, 0x08, 0x10, 0x7F },   /* N */
+    { 0x3E, 0x41, 0x41, 0x41, 0x3E },   /* O */
+    { 0x7F, 0x09, 0x09, 0x09, 0x06 },   /* P */
+    { 0x3E, 0x41, 0x51, 0x21, 0x5E },   /* Q */
+    { 0x7F, 0x09, 0x19, 0x29, 0x46 },   /* R */
+    { 0x46, 0x49, 0x49, 0x49, 0x31 },   /* S */
+    { 0x01, 0x01, 0x7F, 0x01, 0x01 },   /* T */
+    { 0x3F, 0x40, 0x40, 0x40, 0x3F },   /* U */
+    { 0x1F, 0x20, 0x40, 0x20, 0x1F },   /* V */
+    { 0x3F, 0x40, 0x38, 0x40, 0x3F },   /* W */
+    { 0x63, 0x14, 0x08, 0x14, 0x63 },   /* X */
+    { 0x07, 0x08, 0x70, 0x08, 0x07 },   /* Y */
+    { 0x61, 0x51, 0x49, 0x45, 0x43 },   /* Z */
+    { 0x00, 0x7F, 0x41, 0x41, 0x00 },   /* [ */
+    { 0x02, 0x04, 0x08, 0x10, 0x20 },   /* \ */
+    { 0x00, 0x41, 0x41, 0x7F, 0x00 },   /* ] */
+    { 0x04, 0x02, 0x01, 0x02, 0x04 },   /* ^ */
+    { 0x40, 0x40, 0x40, 0x40, 0x40 },   /* _ */
+    { 0x00, 0x01, 0x02, 0x04, 0x00 },   /* ` */
+    { 0x20, 0x54, 0x54, 0x54, 0x78 },   /* a */
+    { 0x7F, 0x48, 0x44, 0x44, 0x38 },   /* b */
+    { 0x38, 0x44, 0x44, 0x44, 0x20 },   /* c */
+    { 0x38, 0x44, 0x44, 0x48, 0x7F },   /* d */
+    { 0x38, 0x54, 0x54, 0x54, 0x18 },   /* e */
+    { 0x08, 0x7E, 0x09, 0x01, 0x02 },   /* f */
+    { 0x0C, 0x52, 0x52, 0x52, 0x3E },   /* g */
+    { 0x7F, 0x08, 0x04, 0x04, 0x78 },   /* h */
+    { 0x00, 0x44, 0x7D, 0x40, 0x00 },   /* i */
+    { 0x20, 0x40, 0x44, 0x3D, 0x00 },   /* j */
+    { 0x7F, 0x10, 0x28, 0x44, 0x00 },   /* k */
+    { 0x00, 0x41, 0x7F, 0x40, 0x00 },   /* l */
+    { 0x7C, 0x04, 0x18, 0x04, 0x78 },   /* m */
+    { 0x7C, 0x08, 0x04, 0x04, 0x78 },   /* n */
+    { 0x38, 0x44, 0x44, 0x44, 0x38 },   /* o */
+    { 0x7C, 0x14, 0x14, 0x14, 0x08 },   /* p */
+    { 0x08, 0x14, 0x14, 0x18, 0x7C },   /* q */
+    { 0x7C, 0x08, 0x04, 0x04, 0x08 },   /* r */
+    { 0x48, 0x54, 0x54, 0x54, 0x20 },   /* s */
+    { 0x04, 0x3F, 0x44, 0x40, 0x20 },   /* t */
+    { 0x3C, 0x40, 0x40, 0x20, 0x7C },   /* u */
+    { 0x1C, 0x20, 0x40, 0x20, 0x1C },   /* v */
+    { 0x3C, 0x40, 0x30, 0x40, 0x3C },   /* w */
+    { 0x44, 0x28, 0x10, 0x28, 0x44 },   /* x */
+    { 0x0C, 0x50, 0x50, 0x50, 0x3C },   /* y */
+    { 0x44, 0x64, 0x54, 0x4C, 0x44 },   /* z */
+    { 0x00, 0x08, 0x36, 0x41, 0x00 },   /* { */
+    { 0x00, 0x00, 0x7F, 0x00, 0x00 },   /* | */
+    { 0x00, 0x41, 0x36, 0x08, 0x00 },   /* } */
+    { 0x08, 0x04, 0x08, 0x10, 0x08 },   /* ~ */
+};
+
+/*
+ * Type: pointT
+ * ------------
+ * This type represents a vertex of a polygon in pixel coordinates.
+ */
+
+typedef struct {
+    int x, y;
+} pointT;
+
+/*
+ * Private variables
+ * -----------------
+ * displayIsOpen   -- TRUE if the display parameters have been set
+ * eraseMode       -- TRUE if erase mode has been set
+ * xdpi, ydpi      -- Dots per inch in each coordinate
+ * frame           -- Pixels of the framebuffer, row by row
+ * frameWidth      -- Width of the framebuffer in pixels
+ * frameHeight     -- Height of the framebuffer in pixels
+ * drawColor       -- Color used for drawing
+ * currentFont     -- Name of current font
+ * currentSize     -- Current point size
+ * currentStyle    -- Current style
+ * fontScale       -- Number of pixels in each dot of the font
+ * windowWidth     -- Width of the window in inches
+ * windowHeight    -- Height of the window in inches
+ * screenWidth     -- Width of the full screen in inches
+ * screenHeight    -- Height of the full screen in inches
+ * regionStarted   -- TRUE is a region is in progress
+ * regionGrayScale -- Gray scale density [0,1]
+ * polygonPoints   -- Array of points, which is reused for each region
+ * nPolygonPoints  -- Number of active points
+ * polygonSize     -- Number of allocated points
+ * crossings       -- Array of polygonSize edge crossings for one row
+ */
+
+static bool displayIsOpen = FALSE;
+static bool eraseMode;
+static double xdpi, ydpi;
+
+static unsigned int *frame;
+static int frameWidth, frameHeight;
+static unsigned int drawColor;
+static string currentFont;
+static int currentSize;
+static int currentStyle;
+static int fontScale;
+static double windowWidth, windowHeight;
+static double screenWidth, screenHeight;
+
+static bool regionStarted;
+static double regionGrayScale;
+static pointT *polygonPoints = NULL;
+static int nPolygonPoints;
+static int polygonSize;
+static double *crossings;
+
+/* Private function prototypes */
+
+static void StartToOpenDisplay(void);
+static void FillBlock(int x, int y, int width, int height,
+                      unsigned int color);
+static void PlotLine(int x0, int y0, int x1, int y1, unsigned int color);
+static void PlotArc(int xc, int yc, int rx, int ry, int start, int sweep,
+                    unsigned int color);
+static void PlotChar(int x, int y, int ch, unsigned int color);
+static void StartPolygon(void);
+static void AddSegment(int x0, int y0, int x1, int y1);
+static void DisplayPolygon(void);
+static void ExpandPolygon(int minSize);
+static void FillSpan(int x0, int x1, int y, char *stipple);
+static void RenderArc(double x, double y, double rx, double ry,
+                      double start, double sweep);
+static void WriteSnapshot(string filename);
+static void WritePNG(FILE *outfile);
+static void WriteChunk(FILE *outfile, string type,
+                       unsigned char *data, unsigned long length);
+static void WriteWord(FILE *outfile, unsigned long word);
+static double InchesX(int x);
+static double InchesY(int y);
+static int PixelsX(double x);
+static int PixelsY(double y);
+static int ScaleX(double x);
+static int ScaleY(double y);
+
+/* Exported entries */
+
+/*
+ * Function: XDOpenDisplay
+ * -----------------------
+ * This function computes the size of the window in the same way
+ * as xdisplay.c, reducing the resolution if the window does not
+ * fit on the simulated screen, and then allocates and clears the
+ * framebuffer.
+ */
+
+void XDOpenDisplay(string title)
+{
+    double xScale, yScale, scaleFactor;
+
+    StartToOpenDisplay();
+    xScale = yScale = 1.0;
+    if (windowWidth > screenWidth - 2 * RequiredMargin) {
+        xScale = (screenWidth - 2 * RequiredMargin) / windowWidth;
+    }
+    if (windowHeight > screenHeight - 2 * RequiredMargin) {
+        yScale = (screenHeight - 2 * RequiredMargin) / windowHeight;
+    }
+    scaleFactor = GLMinF(xScale, yScale);
+    xdpi *= scaleFactor;
+    ydpi *= scaleFactor;
+    frameWidth = GLMax(PixelsX(windowWidth), 1);
+    frameHeight = GLMax(PixelsY(windowHeight), 1);
+    frame = NewArray(frameWidth * frameHeight, unsigned int);
+    drawColor = 0x000000;
+    eraseMode = FALSE;
+    fontScale = 1;
+    currentFont = "Default";
+    currentSize = GLRound(CellHeight * 72 / ydpi);
+    currentStyle = Normal;
+    regionStarted = FALSE;
+    XDClearDisplay();
+}
+
+/*
+ * Function: XDCloseDisplay
+ * ------------------------
+ * This function writes the snapshot, if one has been requested,
+ * and frees the framebuffer and the arrays used for regions.
+ */
+
+void XDCloseDisplay(void)
+{
+    string filename;
+
+    filename = getenv(SnapshotVar);
+    if (filename != NULL && *filename != '\0') WriteSnapshot(filename);
+    FreeBlock(frame);
+    if (polygonPoints != NULL) {
+        FreeBlock(polygonPoints);
+        FreeBlock(crossings);
+        polygonPoints = NULL;
+    }
+}
+
+/*
+ * Function: XDDisplayFD
+ * ---------------------
+ * This function returns -1 because there is no connection to a
+ * display server.
+ */
+
+int XDDisplayFD(void)
+{
+    return (-1);
+}
+
+/*
+ * Functions: XDEventsQueued, XDProcessXEvent
+ * ------------------------------------------
+ * These functions return FALSE because no events ever arrive.
+ */
+
+bool XDEventsQueued(void)
+{
+    return (FALSE);
+}
+
+
+bool XDProcessXEvent(void)
+{
+    return (FALSE);
+}
+
+/*
+ * Functions: XDCheckForRedraw, XDSetRedrawFlag
+ * --------------------------------------------
+ * These functions do nothing, because every operation takes
+ * effect in the framebuffer immediately.
+ */
+
+void XDCheckForRedraw(void)
+{
+}
+
+void XDSetRedrawFlag(void)
+{
+}
+
+/*
+ * Function: XDClearDisplay
+ * ------------------------
+ * This function erases the entire display by filling with the
+ * erase color.
+ */
+
+void XDClearDisplay(void)
+{
+    FillBlock(0, 0, frameWidth, frameHeight, EraseColor);
+}
+
+/*
+ * Function: XDDrawLine
+ * --------------------
+ * This function draws the requested line unless a region is in
+ * progress, in which case it adds the line segment to the polygon.
+ */
+
+void XDDrawLine(double x, double y, double dx, double dy)
+{
+    int x0, y0, x1, y1;
+
+    x0 = ScaleX(x);
+    y0 = ScaleY(y);
+    x1 = ScaleX(x + dx);
+    y1 = ScaleY(y + dy);
+    if (regionStarted) {
+        AddSegment(x0, y0, x1, y1);
+    } else {
+        PlotLine(x0, y0, x1, y1, (eraseMode) ? EraseColor : drawColor);
+    }
+}
+
+/*
+ * Function: XDDrawArc
+ * -------------------
+ * This function scales its arguments in the same way as the X
+ * implementation and draws the arc with PlotArc.  If a region has
+ * been started, the arc is instead added to the polygon by
+ * RenderArc.
+ */
+
+void XDDrawArc(double x, double y, double rx, double ry,
+                double start, double sweep)
+{
+    int istart, isweep;
+
+    if (regionStarted) {
+        RenderArc(x, y, rx, ry, start, sweep);
+    } else {
+        istart = GLRound(start);
+        isweep = GLRound(sweep);
+        if (isweep < 0) {
+            isweep = -isweep;
+            istart -= isweep;
+        }
+        if (istart < 0) {
+            istart = 360 - (-istart % 360);
+        }
+        istart %= 360;
+        PlotArc(ScaleX(x), ScaleY(y), PixelsX(rx), PixelsY(ry),
+                istart, isweep, (eraseMode) ? EraseColor : drawColor);
+    }
+}
+
+/*
+ * Function: XDDrawText
+ * --------------------
+ * This function draws the characters of the text one at a time,
+ * starting with the left edge of the first character at x and
+ * with the baseline at y.
+ */
+
+void XDDrawText(double x, double y, string text)
+{
+    int ix, iy;
+    unsigned int color;
+
+    ix = ScaleX(x);
+    iy = ScaleY(y);
+    color = (eraseMode) ? EraseColor : drawColor;
+    while (*text != '\0') {
+        PlotChar(ix, iy, *text++, color);
+        ix += CellWidth * fontScale;
+    }
+}
+
+/*
+ * Function: XDTextWidth
+ * ---------------------
+ * This function returns the width of the text, which is the same
+ * for every character in the built-in font.
+ */
+
+double XDTextWidth(string text)
+{
+    return (InchesX(strlen(text) * CellWidth * fontScale));
+}
+
+/*
+ * Function: XDSetFont
+ * -------------------
+ * This function chooses the scale factor for the built-in font
+ * that comes closest to the requested point size.  Every font
+ * name is accepted, since all of them are rendered by the same
+ * bitmaps, and the Bold and Italic styles are simulated.  The
+ * size in the result is the point size that corresponds to the
+ * scale factor, as required by the extgraph.h client interface.
+ */
+
+string XDSetFont(string font, int size, int style)
+{
+    char fontbuf[MaxFontName + 30];
+
+    fontScale = GLMax(GLRound(size * ydpi / 72 / CellHeight), 1);
+    currentFont = CopyString(font);
+    currentSize = GLRound(fontScale * CellHeight * 72 / ydpi);
+    currentStyle = style;
+    sprintf(fontbuf, "%d %d %s", currentSize, currentStyle, currentFont);
+    return (CopyString(fontbuf));
+}
+
+/*
+ * Function: DisplayFontMetrics
+ * ----------------------------
+ * This function returns the necessary font metric information through
+ * its argument pointers.
+ */
+
+void DisplayFontMetrics(double *pAscent, double *pDescent, double *pHeight)
+{
+    *pAscent = InchesY(GlyphHeight * fontScale);
+    *pDescent = InchesY((CellHeight - GlyphHeight) * fontScale);
+    *pHeight = InchesY(CellHeight * fontScale);
+}
+
+/*
+ * Function: XDSetTitle
+ * --------------------
+ * This function has no effect, because there is no title bar.
+ */
+
+void XDSetTitle(string title)
+{
+}
+
+/*
+ * Function: XDSetEraseMode
+ * ------------------------
+ * This function sets the internal state of the display logic so
+ * that it maintains the correct state of the eraseMode flag.  In
+ * the rest of the code, the eraseMode flag is used to control
+ * which colors are used.
+ */
+
+void XDSetEraseMode(bool flag)
+{
+    eraseMode = flag;
+}
+
+/*
+ * Function: XDStartRegion
+ * -----------------------
+ * This function changes the state of the package so that subsequent
+ * calls to XDDrawLine and XDDrawArc are used to add segments to a
+ * polygonal region instead of having them appear on the display.
+ */
+
+void XDStartRegion(double grayScale)
+{
+    regionStarted = TRUE;
+    regionGrayScale = grayScale;
+    StartPolygon();
+}
+
+/*
+ * Function: XDEndRegion
+ * ---------------------
+ * This function closes the region opened by XDStartRegion
+ * and displays the assembled polygon.
+ */
+
+void XDEndRegion(void)
+{
+    DisplayPolygon();
+    regionStarted = FALSE;
+}
+
+/*
+ * Function: XDGetMouse
+ * --------------------
+ * This function reports that the mouse is at the upper left
+ * corner of the window with the button up.
+ */
+
+void XDGetMouse(bool *buttonStateP, double *xp, double *yp)
+{
+    *buttonStateP = FALSE;
+    *xp = 0;
+    *yp = windowHeight;
+}
+
+/*
+ * Function: XDWaitForMouse
+ * ------------------------
+ * This function releases the client immediately, whatever state
+ * it is waiting for, since no user can press the button.
+ */
+
+void XDWaitForMouse(bool buttonState)
+{
+    XMReleaseClient();
+}
+
+/*
+ * Function: XDSetColor
+ * --------------------
+ * This function sets the pen color as specified by the arguments.
+ */
+
+void XDSetColor(double red, double green, double blue)
+{
+    drawColor = ((unsigned int) GLRound(red * 255) << 16)
+                | ((unsigned int) GLRound(green * 255) << 8)
+                | (unsigned int) GLRound(blue * 255);
+}
+
+/*
+ * Function: XDSetWindowSize
+ * -------------------------
+ * This function sets the width and height values of the window.
+ */
+
+void XDSetWindowSize(double width, double height)
+{
+    windowWidth = width;
+    windowHeight = height;
+}
+
+/*
+ * Function: XDGetScreenSize
+ * -------------------------
+ * This function returns the size of the simulated screen.
+ */
+
+void XDGetScreenSize(double *pScreenWidth, double *pScreenHeight)
+{
+    StartToOpenDisplay();
+    *pScreenWidth = screenWidth;
+    *pScreenHeight = screenHeight;
+}
+
+/*
+ * Function: XDGetResolution
+ * -------------------------
+ * This function returns the screen resolution, possibly modified by
+ * the scale reduction.
+ */
+
+void XDGetResolution(double *pXDPI, double *pYDPI)
+{
+    StartToOpenDisplay();
+    *pXDPI = xdpi;
+    *pYDPI = ydpi;
+}
+
+/*
+ * Function: XDGetNColors
+ * ----------------------
+ * This function returns the number of colors a pixel can hold.
+ */
+
+int XDGetNColors(void)
+{
+    return (1 << ColorBits);
+}
+
+/* Private functions */
+
+/*
+ * Function: StartToOpenDisplay
+ * Usage: StartToOpenDisplay();
+ * ----------------------------
+ * This function sets the fixed parameters of the simulated screen
+ * if they have not already been set.
+ */
+
+static void StartToOpenDisplay(void)
+{
+    if (displayIsOpen) return;
+    xdpi = ydpi = ScreenDPI;
+    screenWidth = (double) ScreenPixelsX / ScreenDPI;
+    screenHeight = (double) ScreenPixelsY / ScreenDPI;
+    displayIsOpen = TRUE;
+}
+
+/*
+ * Function: FillBlock
+ * Usage: FillBlock(x, y, width, height, color);
+ * ---------------------------------------------
+ * This function fills the rectangle with the given upper left
+ * corner and size, clipped to the framebuffer, with the color.
+ */
+
+static void FillBlock(int x, int y, int width, int height,
+                      unsigned int color)
+{
+    int x0, y0, x1, y1, i;
+    unsigned int *row;
+
+    x0 = GLMax(x, 0);
+    y0 = GLMax(y, 0);
+    x1 = GLMin(x + width, frameWidth);
+    y1 = GLMin(y + height, frameHeight);
+    for (; y0 < y1; y0++) {
+        row = frame + y0 * frameWidth;
+        for (i = x0; i < x1; i++) {
+            row[i] = color;
+        }
+    }
+}
+
+/*
+ * Function: PlotLine
+ * Usage: PlotLine(x0, y0, x1, y1, color);
+ * ---------------------------------------
+ * This function draws a line one pixel wide from (x0, y0) to
+ * (x1, y1), including both endpoints, using the Bresenham
+ * algorithm.  Pixels outside the framebuffer are skipped, and a
+ * line that lies entirely to one side of the framebuffer is
+ * rejected without plotting any points.
+ */
+
+static void PlotLine(int x0, int y0, int x1, int y1, unsigned int color)
+{
+    int dx, dy, sx, sy, err, e2;
+
+    if ((x0 < 0 && x1 < 0) || (y0 < 0 && y1 < 0)
+        || (x0 >= frameWidth && x1 >= frameWidth)
+        || (y0 >= frameHeight && y1 >= frameHeight)) return;
+    dx = abs(x1 - x0);
+    dy = -abs(y1 - y0);
+    sx = (x0 < x1) ? 1 : -1;
+    sy = (y0 < y1) ? 1 : -1;
+    err = dx + dy;
+    while (TRUE) {
+        if (x0 >= 0 && x0 < frameWidth && y0 >= 0 && y0 < frameHeight) {
+            frame[y0 * frameWidth + x0] = color;
+        }
+        if (x0 == x1 && y0 == y1) break;
+        e2 = 2 * err;
+        if (e2 >= dy) {
+            err += dy;
+            x0 += sx;
+        }
+        if (e2 <= dx) {
+            err += dx;
+            y0 += sy;
+        }
+    }
+}
+
+/*
+ * Function: PlotArc
+ * Usage: PlotArc(xc, yc, rx, ry, start, sweep, color);
+ * ----------------------------------------------------
+ * This function draws the outline of an elliptical arc centered
+ * at (xc, yc) in pixel coordinates, where start and sweep are
+ * given in degrees as in XDrawArc.  The arc is drawn as a series
+ * of lines between points that are close enough together that
+ * each line spans at most one pixel.
+ */
+
+static void PlotArc(int xc, int yc, int rx, int ry, int start, int sweep,
+                    unsigned int color)
+{
+    double t, dt, mint, maxt;
+    int x0, y0, x1, y1;
+
+    dt = 1.0 / GLMax(GLMax(rx, ry), 1);
+    mint = GLRadians(start);
+    maxt = GLRadians(start + sweep);
+    x0 = xc + GLRound(rx * cos(mint));
+    y0 = yc - GLRound(ry * sin(mint));
+    PlotLine(x0, y0, x0, y0, color);
+    for (t = mint + dt; t < maxt + dt; t += dt) {
+        if (t > maxt) t = maxt;
+        x1 = xc + GLRound(rx * cos(t));
+        y1 = yc - GLRound(ry * sin(t));
+        PlotLine(x0, y0, x1, y1, color);
+        x0 = x1;
+        y0 = y1;
+        if (t == maxt) break;
+    }
+}
+
+/*
+ * Function: PlotChar
+ * Usage: PlotChar(x, y, ch, color);
+ * ---------------------------------
+ * This function draws the character ch with the left edge of its
+ * cell at x and its baseline at y.  Each dot of the bitmap becomes
+ * a square fontScale pixels on a side.  Characters missing from
+ * the font are drawn as a question mark.  Bold characters are
+ * drawn a second time one pixel to the right, and italic ones are
+ * slanted by shifting each row in proportion to its height above
+ * the baseline.
+ */
+
+static void PlotChar(int x, int y, int ch, unsigned int color)
+{
+    unsigned char *glyph;
+    int row, col, px, py;
+
+    if (ch < FirstGlyph || ch > LastGlyph) ch = '?';
+    glyph = fontTable[ch - FirstGlyph];
+    for (row = 0; row < GlyphHeight; row++) {
+        py = y - (GlyphHeight - row) * fontScale;
+        px = x;
+        if (currentStyle & Italic) {
+            px += (GlyphHeight - 1 - row) * fontScale / 3;
+        }
+        for (col = 0; col < GlyphWidth; col++) {
+            if (glyph[col] & (1 << row)) {
+                FillBlock(px + col * fontScale, py, fontScale, fontScale,
+                          color);
+                if (currentStyle & Bold) {
+                    FillBlock(px + col * fontScale + 1, py,
+                              fontScale, fontScale, color);
+                }
+            }
+        }
+    }
+}
+
+/*
+ * Functions: StartPolygon, AddSegment, DisplayPolygon
+ * Usage: StartPolygon();
+ *        AddSegment(x0, y0, x1, y1);
+ *        AddSegment(x1, y1, x2, y2);
+ *        . . .
+ *        DisplayPolygon();
+ * ---------------------------------------------------
+ * These functions assemble a region into a polygon in the same
+ * way as the corresponding functions in xdisplay.c, reusing the
+ * array polygonPoints from one region to the next.  DisplayPolygon
+ * fills the polygon one scan line at a time: for the center of each
+ * row of pixels, it finds the points at which the edges cross the
+ * row, sorts them, and fills the spans between alternate pairs.
+ * A pixel is filled if its center lies inside the polygon, which
+ * matches the rule used by XFillPolygon.  Since a row cannot cross
+ * more edges than the polygon has points, the crossings array is
+ * kept the same size as polygonPoints.
+ */
+
+static void StartPolygon(void)
+{
+    if (polygonPoints == NULL) {
+        polygonPoints = NewArray(PStartSize, pointT);
+        crossings = NewArray(PStartSize, double);
+        polygonSize = PStartSize;
+    }
+    nPolygonPoints = 0;
+}
+
+static void AddSegment(int x0, int y0, int x1, int y1)
+{
+    if (nPolygonPoints + 2 > polygonSize) {
+        ExpandPolygon(nPolygonPoints + 2);
+    }
+    if (nPolygonPoints == 0) {
+        polygonPoints[nPolygonPoints].x = x0;
+        polygonPoints[nPolygonPoints].y = y0;
+        nPolygonPoints++;
+    }
+    polygonPoints[nPolygonPoints].x = x1;
+    polygonPoints[nPolygonPoints].y = y1;
+    nPolygonPoints++;
+}
+
+static void DisplayPolygon(void)
+{
+    char *stipple;
+    double yc, xc;
+    int i, j, n, px, y, ymin, ymax;
+    pointT *p0, *p1;
+
+    if (nPolygonPoints == 0) return;
+    px = regionGrayScale * (NGrays - 1) + 0.5 - Epsilon;
+    stipple = (eraseMode) ? NULL : grayList[px];
+    if (polygonPoints[0].x != polygonPoints[nPolygonPoints-1].x
+        || polygonPoints[0].y != polygonPoints[nPolygonPoints-1].y) {
+        if (nPolygonPoints == polygonSize) {
+            ExpandPolygon(nPolygonPoints + 1);
+        }
+        polygonPoints[nPolygonPoints++] = polygonPoints[0];
+    }
+    ymin = ymax = polygonPoints[0].y;
+    for (i = 1; i < nPolygonPoints; i++) {
+        ymin = GLMin(ymin, polygonPoints[i].y);
+        ymax = GLMax(ymax, polygonPoints[i].y);
+    }
+    ymin = GLMax(ymin, 0);
+    ymax = GLMin(ymax, frameHeight - 1);
+    for (y = ymin; y <= ymax; y++) {
+        yc = y + 0.5;
+        n = 0;
+        for (i = 1; i < nPolygonPoints; i++) {
+            p0 = &polygonPoints[i - 1];
+            p1 = &polygonPoints[i];
+            if ((p0->y <= yc) == (p1->y <= yc)) continue;
+            xc = p0->x + (yc - p0->y) * (p1->x - p0->x) / (p1->y - p0->y);
+            for (j = n; j > 0 && crossings[j - 1] > xc; j--) {
+                crossings[j] = crossings[j - 1];
+            }
+            crossings[j] = xc;
+            n++;
+        }
+        for (i = 0; i + 1 < n; i += 2) {
+            FillSpan((int) ceil(crossings[i] - 0.5),
+                     (int) ceil(crossings[i + 1] - 0.5), y, stipple);
+        }
+    }
+}
+
+/*
+ * Function: ExpandPolygon
+ * Usage: ExpandPolygon(minSize);
+ * ------------------------------
+ * This function makes room in polygonPoints for at least minSize
+ * points by doubling the size of the array as many times as
+ * necessary and copying the existing points to the new array.
+ * The crossings array is replaced by one of the same size.
+ */
+
+static void ExpandPolygon(int minSize)
+{
+    pointT *newPolygon;
+    int newSize;
+
+    newSize = polygonSize;
+    while (newSize < minSize) newSize *= 2;
+    newPolygon = NewArray(newSize, pointT);
+    memcpy(newPolygon, polygonPoints, nPolygonPoints * sizeof (pointT));
+    FreeBlock(polygonPoints);
+    FreeBlock(crossings);
+    polygonPoints = newPolygon;
+    crossings = NewArray(newSize, double);
+    polygonSize = newSize;
+}
+
+/*
+ * Function: FillSpan
+ * Usage: FillSpan(x0, x1, y, stipple);
+ * ------------------------------------
+ * This function fills the pixels of row y from x0 up to but not
+ * including x1.  If stipple is NULL, the pixels are erased;
+ * otherwise, the pixels whose bits are set in the stipple pattern
+ * are set to the drawing color and the others are erased, as in
+ * an opaque stipple in X.
+ */
+
+static void FillSpan(int x0, int x1, int y, char *stipple)
+{
+    unsigned int *row;
+    int bits;
+
+    x0 = GLMax(x0, 0);
+    x1 = GLMin(x1, frameWidth);
+    row = frame + y * frameWidth;
+    if (stipple == NULL) {
+        for (; x0 < x1; x0++) row[x0] = EraseColor;
+    } else {
+        bits = stipple[y & 7];
+        for (; x0 < x1; x0++) {
+            row[x0] = (bits & (1 << (x0 & 7))) ? drawColor : EraseColor;
+        }
+    }
+}
+
+/*
+ * Function: RenderArc
+ * Usage: RenderArc(x, y, rx, ry, start, sweep);
+ * ---------------------------------------------
+ * This function is identical to the XDDrawArc function except
+ * that the arc is rendered using line segments as part of a
+ * polygonal region.  The arc is divided into n equal steps, where
+ * n is the smallest number for which no chord strays more than
+ * MaxArcError pixels from the arc.  Rather than calling cos and
+ * sin at every step, the function rotates the point (c, s) on the
+ * unit circle by the angle of one step, computing only the last
+ * point directly so that the arc ends exactly where it should.
+ * Points that round to the same pixel as the previous point are
+ * skipped, except that a region always receives at least one
+ * point.
+ */
+
+static void RenderArc(double x, double y, double rx, double ry,
+                      double start, double sweep)
+{
+    double r, mint, maxt, dt, c, s, cdt, sdt, temp;
+    int i, n, ix0, iy0, ix1, iy1;
+
+    if (sweep < 0) {
+        start += sweep;
+        sweep = -sweep;
+    }
+    mint = GLRadians(start);
+    maxt = GLRadians(start + sweep);
+    r = GLMaxF(fabs(rx) * xdpi, fabs(ry) * ydpi);
+    n = 1;
+    if (r > MaxArcError) {
+        n = (int) ceil((maxt - mint) / (2 * acos(1 - MaxArcError / r)));
+        n = GLMax(n, 1);
+    }
+    dt = (maxt - mint) / n;
+    c = cos(mint);
+    s = sin(mint);
+    cdt = cos(dt);
+    sdt = sin(dt);
+    ix0 = ScaleX(x + rx * c);
+    iy0 = ScaleY(y + ry * s);
+    for (i = 1; i <= n; i++) {
+        if (i == n) {
+            c = cos(maxt);
+            s = sin(maxt);
+        } else {
+            temp = c * cdt - s * sdt;
+            s = s * cdt + c * sdt;
+            c = temp;
+        }
+        ix1 = ScaleX(x + rx * c);
+        iy1 = ScaleY(y + ry * s);
+        if (ix1 != ix0 || iy1 != iy0 || (i == n && nPolygonPoints == 0)) {
+            AddSegment(ix0, iy0, ix1, iy1);
+            ix0 = ix1;
+            iy0 = iy1;
+        }
+    }
+}
+
+/* Snapshot functions */
+
+/*
+ * Function: WriteSnapshot
+ * Usage: WriteSnapshot(filename);
+ * -------------------------------
+ * This function writes the contents of the framebuffer to the
+ * named file, in PNG format if the name ends with .png and as a
+ * binary PPM file otherwise.
+ */
+
+static void WriteSnapshot(string filename)
+{
+    FILE *outfile;
+    int len, i;
+    unsigned int color;
+
+    outfile = fopen(filename, "wb");
+    if (outfile == NULL) Error("Can't write snapshot %s", filename);
+    len = strlen(filename);
+    if (len >= 4 && StringEqual(filename + len - 4, ".png")) {
+        WritePNG(outfile);
+    } else {
+        fprintf(outfile, "P6\n%d %d\n255\n", frameWidth, frameHeight);
+        for (i = 0; i < frameWidth * frameHeight; i++) {
+            color = frame[i];
+            putc((color >> 16) & 0xFF, outfile);
+            putc((color >> 8) & 0xFF, outfile);
+            putc(color & 0xFF, outfile);
+        }
+    }
+    if (fclose(outfile) != 0) Error("Can't write snapshot %s", filename);
+}
+
+/*
+ * Function: WritePNG
+ * Usage: WritePNG(outfile);
+ * -------------------------
+ * This function writes the framebuffer to outfile as an 8-bit RGB
+ * PNG image.  The rows, each preceded by a filter byte of zero,
+ * are compressed with zlib into a single IDAT chunk.
+ */
+
+static void WritePNG(FILE *outfile)
+{
+    unsigned char header[13], *raw, *data, *cp;
+    unsigned long rawSize;
+    uLongf dataSize;
+    unsigned int color;
+    int x, y;
+
+    rawSize = (unsigned long) frameHeight * (3 * frameWidth + 1);
+    raw = GetBlock(rawSize);
+    cp = raw;
+    for (y = 0; y < frameHeight; y++) {
+        *cp++ = 0;
+        for (x = 0; x < frameWidth; x++) {
+            color = frame[y * frameWidth + x];
+            *cp++ = (color >> 16) & 0xFF;
+            *cp++ = (color >> 8) & 0xFF;
+            *cp++ = color & 0xFF;
+        }
+    }
+    dataSize = compressBound(rawSize);
+    data = GetBlock(dataSize);
+    if (compress2(data, &dataSize, raw, rawSize,
+                  Z_DEFAULT_COMPRESSION) != Z_OK) {
+        Error("Can't compress snapshot");
+    }
+    for (x = 0; x < 4; x++) {
+        header[x] = ((unsigned long) frameWidth >> (24 - 8 * x)) & 0xFF;
+        header[x + 4] = ((unsigned long) frameHeight >> (24 - 8 * x)) & 0xFF;
+    }
+    header[8] = 8;
+    header[9] = 2;
+    header[10] = header[11] = header[12] = 0;
+    fwrite("\211PNG\r\n\032\n", 1, 8, outfile);
+    WriteChunk(outfile, "IHDR", header, sizeof header);
+    WriteChunk(outfile, "IDAT", data, dataSize);
+    WriteChunk(outfile, "IEND", NULL, 0);
+    FreeBlock(data);
+    FreeBlock(raw);
+}
+
+/*
+ * Function: WriteChunk
+ * Usage: WriteChunk(outfile, type, data, length);
+ * -----------------------------------------------
+ * This function writes a PNG chunk with the given four-letter
+ * type, followed by its length bytes of data and the CRC that
+ * covers both.
+ */
+
+static void WriteChunk(FILE *outfile, string type,
+                       unsigned char *data, unsigned long length)
+{
+    uLong crc;
+
+    crc = crc32(0L, (Bytef *) type, 4);
+    if (length > 0) crc = crc32(crc, data, length);
+    WriteWord(outfile, length);
+    fwrite(type, 1, 4, outfile);
+    if (length > 0) fwrite(data, 1, length, outfile);
+    WriteWord(outfile, crc);
+}
+
+/*
+ * Function: WriteWord
+ * Usage: WriteWord(outfile, word);
+ * --------------------------------
+ * This function writes the low-order 32 bits of word to outfile
+ * with the most significant byte first.
+ */
+
+static void WriteWord(FILE *outfile, unsigned long word)
+{
+    putc((word >> 24) & 0xFF, outfile);
+    putc((word >> 16) & 0xFF, outfile);
+    putc((word >> 8) & 0xFF, outfile);
+    putc(word & 0xFF, outfile);
+}
+
+/* Low-level conversion functions */
+
+/*
+ * Functions: InchesX, InchesY
+ * Usage: inches = InchesX(pixels);
+ *        inches = InchesY(pixels);
+ * --------------------------------
+ * These functions convert distances measured in pixels to inches.
+ * Because the resolution may not be uniform in the horizontal and
+ * vertical directions, the coordinates are treated separately.
+ */
+
+static double InchesX(int x)
+{
+    return ((double) x / xdpi);
+}
+
+static double InchesY(int y)
+{
+    return ((double) y / ydpi);
+}
+
+/*
+ * Functions: PixelsX, PixelsY
+ * Usage: pixels = PixelsX(inches);
+ *        pixels = PixelsY(inches);
+ * --------------------------------
+ * These functions convert distances measured in inches to pixels.
+ */
+
+static int PixelsX(double x)
+{
+    return (GLRound(x * xdpi + Epsilon));
+}
+
+static int PixelsY(double y)
+{
+    return (GLRound(y * ydpi + Epsilon));
+}
+
+/*
+ * Functions: ScaleX, ScaleY
+ * Usage: pixels = ScaleX(inches);
+ *        pixels = ScaleY(inches);
+ * -------------------------------
+ * These functions are like PixelsX and PixelsY but convert coordinates
+ * rather than lengths.  The difference is that y-coordinate values must
+ * be inverted top to bottom to support the cartesian coordinates of
+ * the graphics.h model.
+ */
+
+static int ScaleX(double x)
+{
+    return (PixelsX(x));
+}
+
+static int ScaleY(double y)
+{
+    return (PixelsY(windowHeight - y));
+}
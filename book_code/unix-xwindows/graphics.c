@@ -98,7 +98,8 @@ typedef struct {
  * ----------------
  * initialized   -- TRUE if initialization has been done
  * windowTitle   -- Current window title (initialized statically)
- * cmdBuffer     -- Static buffer for sending commands
+ * cmdBuffer     -- Static buffer for command text and responses
+ * cmdArgs       -- Static array for numeric command arguments
  * regionState   -- Current state of the region
  * colorTable    -- Table of defined colors
  * nColors       -- Number of defined colors
@@ -120,6 +121,7 @@ static bool initialized = FALSE;
 static string windowTitle = "Graphics Window";
 
 static char cmdBuffer[CommandBufferSize];
+static double cmdArgs[MaxCommandArgs];
 
 static regionStateT regionState;
 
@@ -169,7 +171,7 @@ static void USleep(unsigned useconds);
 void InitGraphics(void)
 {
     if (initialized) {
-        XMSendCommand(ClearCmd, "");
+        XMSendCommand(ClearCmd, NULL, 0, NULL);
     } else {
         initialized = TRUE;
         ProtectVariable(stateStack);
@@ -202,8 +204,11 @@ void DrawLine(double dx, double dy)
       case PenHasMoved:
         Error("Region segments must be contiguous");
     }
-    sprintf(cmdBuffer, "%.12g %.12g %.12g %.12g", cx, cy, dx, dy);
-    XMSendCommand(LineCmd, cmdBuffer);
+    cmdArgs[0] = cx;
+    cmdArgs[1] = cy;
+    cmdArgs[2] = dx;
+    cmdArgs[3] = dy;
+    XMSendCommand(LineCmd, cmdArgs, 4, NULL);
     cx += dx;
     cy += dy;
 }
@@ -254,9 +259,13 @@ void DrawEllipticalArc(double rx, double ry,
     }
     x = cx + rx * cos(GLRadians(start + 180));
     y = cy + ry * sin(GLRadians(start + 180));
-    sprintf(cmdBuffer, "%.12g %.12g %.12g %.12g %.12g %.12g",
-                       x, y, rx, ry, start, sweep);
-    XMSendCommand(ArcCmd, cmdBuffer);
+    cmdArgs[0] = x;
+    cmdArgs[1] = y;
+    cmdArgs[2] = rx;
+    cmdArgs[3] = ry;
+    cmdArgs[4] = start;
+    cmdArgs[5] = sweep;
+    XMSendCommand(ArcCmd, cmdArgs, 6, NULL);
     cx = x + rx * cos(GLRadians(start + sweep));
     cy = y + ry * sin(GLRadians(start + sweep));
 }
@@ -273,8 +282,8 @@ void StartFilledRegion(double density)
         Error("Density for regions must be between 0 and 1");
     }
     regionState = RegionStarting;
-    sprintf(cmdBuffer, "%.12g", density);
-    XMSendCommand(StartRegionCmd, cmdBuffer);
+    cmdArgs[0] = density;
+    XMSendCommand(StartRegionCmd, cmdArgs, 1, NULL);
 }
 
 void EndFilledRegion(void)
@@ -284,7 +293,7 @@ void EndFilledRegion(void)
         Error("EndFilledRegion without StartFilledRegion");
     }
     regionState = NoRegion;
-    XMSendCommand(EndRegionCmd, "");
+    XMSendCommand(EndRegionCmd, NULL, 0, NULL);
 }
 
 /* Section 4 -- String functions */
@@ -299,25 +308,22 @@ void DrawTextString(string text)
         Error("Text string too long");
     }
     InstallFont();
-    sprintf(cmdBuffer, "%.12g %.12g %s", cx, cy, text);
-    XMSendCommand(TextCmd, cmdBuffer);
+    cmdArgs[0] = cx;
+    cmdArgs[1] = cy;
+    XMSendCommand(TextCmd, cmdArgs, 2, text);
     cx += TextStringWidth(text);
 }
 
 double TextStringWidth(string text)
 {
-    double result;
-
     InitCheck();
     if (strlen(text) > MaxTextString) {
         Error("Text string too long");
     }
     InstallFont();
-    sprintf(cmdBuffer, "%s", text);
-    XMSendCommand(WidthCmd, cmdBuffer);
-    XMGetResponse(cmdBuffer);
-    (void) sscanf(cmdBuffer, "%lg", &result);
-    return (result);
+    XMSendCommand(WidthCmd, NULL, 0, text);
+    XMGetResponse(cmdArgs, NULL);
+    return (cmdArgs[0]);
 }
 
 void SetFont(string font)
@@ -365,92 +371,71 @@ int GetStyle(void)
 
 double GetFontAscent(void)
 {
-    double ascent;
-
     InitCheck();
     InstallFont();
-    XMSendCommand(FontMetricsCmd, "");
-    XMGetResponse(cmdBuffer);
-    (void) sscanf(cmdBuffer, "%lg", &ascent);
-    return (ascent);
+    XMSendCommand(FontMetricsCmd, NULL, 0, NULL);
+    XMGetResponse(cmdArgs, NULL);
+    return (cmdArgs[0]);
 }
 
 double GetFontDescent(void)
 {
-    double descent;
-
     InitCheck();
     InstallFont();
-    XMSendCommand(FontMetricsCmd, "");
-    XMGetResponse(cmdBuffer);
-    (void) sscanf(cmdBuffer, "%*lg %lg", &descent);
-    return (descent);
+    XMSendCommand(FontMetricsCmd, NULL, 0, NULL);
+    XMGetResponse(cmdArgs, NULL);
+    return (cmdArgs[1]);
 }
 
 double GetFontHeight(void)
 {
-    double height;
-
     InitCheck();
     InstallFont();
-    XMSendCommand(FontMetricsCmd, "");
-    XMGetResponse(cmdBuffer);
-    (void) sscanf(cmdBuffer, "%*lg %*lg %lg", &height);
-    return (height);
+    XMSendCommand(FontMetricsCmd, NULL, 0, NULL);
+    XMGetResponse(cmdArgs, NULL);
+    return (cmdArgs[2]);
 }
 
 /* Section 5 -- Mouse support */
 
 double GetMouseX(void)
 {
-    double x, y;
-    int state;
-
     InitCheck();
-    XMSendCommand(GetMouseCmd, "");
-    XMGetResponse(cmdBuffer);
-    (void) sscanf(cmdBuffer, "%d, %lg, %lg", &state, &x, &y);
-    return (x);
+    XMSendCommand(GetMouseCmd, NULL, 0, NULL);
+    XMGetResponse(cmdArgs, NULL);
+    return (cmdArgs[1]);
 }
 
 double GetMouseY(void)
 {
-    string line;
-    double x, y;
-    int state;
-
     InitCheck();
-    XMSendCommand(GetMouseCmd, "");
-    XMGetResponse(cmdBuffer);
-    (void) sscanf(cmdBuffer, "%d, %lg, %lg", &state, &x, &y);
-    return (y);
+    XMSendCommand(GetMouseCmd, NULL, 0, NULL);
+    XMGetResponse(cmdArgs, NULL);
+    return (cmdArgs[2]);
 }
 
 bool MouseButtonIsDown(void)
 {
-    string line;
-    double x, y;
-    int state;
-
     InitCheck();
-    XMSendCommand(GetMouseCmd, "");
-    XMGetResponse(cmdBuffer);
-    (void) sscanf(cmdBuffer, "%d, %lg, %lg", &state, &x, &y);
-    return (state != 0);
+    XMSendCommand(GetMouseCmd, NULL, 0, NULL);
+    XMGetResponse(cmdArgs, NULL);
+    return (cmdArgs[0] != 0);
 }
 
 void WaitForMouseDown(void)
 {
     InitCheck();
-    XMSendCommand(WaitForMouseCmd, "D");
-    XMGetResponse(cmdBuffer);
+    cmdArgs[0] = TRUE;
+    XMSendCommand(WaitForMouseCmd, cmdArgs, 1, NULL);
+    XMGetResponse(NULL, NULL);
 }
 
 void WaitForMouseUp(void)
 {
     InitCheck();
-    XMSendCommand(WaitForMouseCmd, "U");
-    XMGetResponse(cmdBuffer);
+    cmdArgs[0] = FALSE;
+    XMSendCommand(WaitForMouseCmd, cmdArgs, 1, NULL);
+    XMGetResponse(NULL, NULL);
 }
 
 /* Section 6 -- Color support */
@@ -472,11 +457,10 @@ void SetPenColor(string color)
     if (penColor == lastColor) return;
     lastColor = penColor;
     if (HasColor()) {
-        sprintf(cmdBuffer, "%g %g %g\n",
-                colorTable[cindex].red,
-                colorTable[cindex].green,
-                colorTable[cindex].blue);
-        XMSendCommand(SetColorCmd, cmdBuffer);
+        cmdArgs[0] = colorTable[cindex].red;
+        cmdArgs[1] = colorTable[cindex].green;
+        cmdArgs[2] = colorTable[cindex].blue;
+        XMSendCommand(SetColorCmd, cmdArgs, 3, NULL);
     } else {
         SetEraseMode(eraseMode);
     }
@@ -514,8 +498,8 @@ void SetEraseMode(bool mode)
 {
     InitCheck();
     eraseMode = mode;
-    sprintf(cmdBuffer, "%d", (int) (mode || ShouldBeWhite()));
-    XMSendCommand(SetEraseCmd, cmdBuffer);
+    cmdArgs[0] = (mode || ShouldBeWhite());
+    XMSendCommand(SetEraseCmd, cmdArgs, 1, NULL);
 }
 
 bool GetEraseMode(void)
@@ -528,8 +512,7 @@ void SetWindowTitle(string title)
 {
     windowTitle = CopyString(title);
     if (initialized) {
-        sprintf(cmdBuffer, "%s", windowTitle);
-        XMSendCommand(SetTitleCmd, cmdBuffer);
+        XMSendCommand(SetTitleCmd, NULL, 0, windowTitle);
     }
 }
 
@@ -543,7 +526,7 @@ void UpdateDisplay(void)
     int cnt;
 
     InitCheck();
-    XMSendCommand(UpdateCmd, "");
+    XMSendCommand(UpdateCmd, NULL, 0, NULL);
 }
 
 void Pause(double seconds)
@@ -554,7 +537,7 @@ void Pause(double seconds)
 
 void ExitGraphics(void)
 {
-    XMSendCommand(ExitGraphicsCmd, "");
+    XMSendCommand(ExitGraphicsCmd, NULL, 0, NULL);
     exit(0);
 }
 
@@ -681,9 +664,10 @@ static void InstallFont(void)
     string line;
 
     if (!fontChanged) return;
-    sprintf(cmdBuffer, "%d %d %s", pointSize, textStyle, textFont);
-    XMSendCommand(SetFontCmd, cmdBuffer);
-    XMGetResponse(cmdBuffer);
+    cmdArgs[0] = pointSize;
+    cmdArgs[1] = textStyle;
+    XMSendCommand(SetFontCmd, cmdArgs, 2, textFont);
+    XMGetResponse(NULL, cmdBuffer);
     (void) sscanf(cmdBuffer, "%d %d %s", &pointSize, &textStyle, fontbuf);
     textFont = CopyString(fontbuf);
     fontChanged = FALSE;
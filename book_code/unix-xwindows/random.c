@@ -3,75 +3,1439 @@
  * Version: 1.0
  * Last modified on Mon Sep 13 10:42:45 1993 by eroberts
  * -----------------------------------------------------
- * This file implements the random.h interface.
+ * This file implements the random.h interface.  Earlier versions
+ * used the rand function from <stdlib.h>, whose quality, speed,
+ * and sequence differ from one C library to the next.  This
+ * version implements its own generators so that the results are
+ * the same everywhere.
  */
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdint.h>
+#include <limits.h>
 #include <time.h>
+#include <pthread.h>
 
 #include "genlib.h"
 #include "random.h"
 
+/*
+ * Constants:
+ * ----------
+ * DefaultSeed   -- Seed of the default generator for the first thread
+ * PCGMultiplier -- Multiplier of the PCG linear congruential step
+ * GoldenGamma   -- Increment of the SplitMix64 sequence
+ * UnitScale     -- Converts a 53-bit integer to a double in [0,1)
+ * UnitBits      -- Number of bits in the integer scaled by UnitScale
+ * FillBatch     -- Number of values converted in each batch of a fill
+ * PCGJumpSteps  -- Number of PCG32 steps taken by JumpRandom
+ * NormalLayers  -- Number of layers in the normal ziggurat
+ * NormalR       -- Start of the tail of the normal ziggurat
+ * NormalV       -- Area of each layer of the normal ziggurat
+ * ExpLayers     -- Number of layers in the exponential ziggurat
+ * ExpR          -- Start of the tail of the exponential ziggurat
+ * ExpV          -- Area of each layer of the exponential ziggurat
+ * SmallMean     -- Largest mean for which counting methods are used
+ * ShuffleBatch  -- Number of exchanges whose targets are prefetched
+ */
+
+#define DefaultSeed 1994
+#define PCGMultiplier 6364136223846793005ULL
+#define GoldenGamma 0x9E3779B97F4A7C15ULL
+#define UnitScale (1.0 / 9007199254740992.0)
+#define UnitBits 53
+#define FillBatch 512
+#define PCGJumpSteps (1ULL << 48)
+#define NormalLayers 128
+#define NormalR 3.442619855899
+#define NormalV 9.91256303526217e-3
+#define ExpLayers 256
+#define ExpR 7.69711747013104972
+#define ExpV 3.949659822581572e-3
+#define SmallMean 10.0
+#define ShuffleBatch 32
+
+/*
+ * Macro: Prefetch
+ * ---------------
+ * This macro asks the processor to begin loading the cache line
+ * that contains addr, on compilers that provide a way to do so.
+ */
+
+#ifdef __GNUC__
+#  define Prefetch(addr) __builtin_prefetch(addr, 1)
+#else
+#  define Prefetch(addr)
+#endif
+
+/*
+ * Private constants
+ * -----------------
+ * xoshiroJump -- Polynomial that advances xoshiro256** by 2^128
+ */
+
+static const uint64_t xoshiroJump[4] = {
+    0x180EC6D33CFD0ABAULL, 0xD5A61266F0C9392CULL,
+    0xA9582618E03FC9AAULL, 0x39ABDC4529B1661CULL
+};
+
+/*
+ * Types: reservoirCDT, aliasCDT
+ * -----------------------------
+ * These types are the concrete representations of reservoirs
+ * and alias tables.  A reservoir records the number of items
+ * seen so far, the index of the next item that will be selected,
+ * and the quantity w used to compute the gaps between selected
+ * items.  An alias table has one column for each integer, which
+ * holds the probability of choosing that integer rather than its
+ * alias when the column is chosen.  The probability and alias
+ * for a column are stored together, so that choosing a column
+ * touches only one cache line of a large table.
+ */
+
+struct reservoirCDT {
+    randomADT rng;
+    long k, seen, next;
+    double w;
+};
+
+typedef struct {
+    double prob;
+    long alias;
+} aliasColumnT;
+
+struct aliasCDT {
+    long n;
+    aliasColumnT *columns;
+};
+
+/*
+ * Type: randomCDT
+ * ---------------
+ * This type is the concrete representation of a generator.  A
+ * Xoshiro256 generator uses all four words of the state array.
+ * A PCG32 generator keeps its state in state[0] and its odd
+ * increment, which selects one of 2^63 distinct sequences, in
+ * state[1].
+ */
+
+struct randomCDT {
+    generatorT type;
+    uint64_t state[4];
+};
+
+/*
+ * Private variables
+ * -----------------
+ * defaultGenerator -- The default generator for each thread
+ * defaultReady     -- TRUE once the thread's default is seeded
+ * nextDefault      -- Start of the next thread's default generator
+ * nextRandomized   -- Start of the generator for the next Randomize
+ * defaultsSeeded   -- TRUE once nextDefault has been seeded
+ * randomized       -- TRUE once nextRandomized has been seeded
+ * streamLock       -- Protects the four variables above
+ * normalX, expX    -- Right edges of the layers of each ziggurat
+ * normalF, expF    -- Density at each of those edges
+ * normalRatio      -- Ratio of each normal edge to the one above it
+ * expRatio         -- Ratio of each exponential edge to the one above
+ * zigguratOnce     -- Makes sure that the tables are built once
+ */
+
+static _Thread_local struct randomCDT defaultGenerator;
+static _Thread_local bool defaultReady = FALSE;
+static struct randomCDT nextDefault, nextRandomized;
+static bool defaultsSeeded = FALSE;
+static bool randomized = FALSE;
+static pthread_mutex_t streamLock = PTHREAD_MUTEX_INITIALIZER;
+static double normalX[NormalLayers + 1], normalF[NormalLayers + 1];
+static double normalRatio[NormalLayers];
+static double expX[ExpLayers + 1], expF[ExpLayers + 1];
+static double expRatio[ExpLayers];
+static pthread_once_t zigguratOnce = PTHREAD_ONCE_INIT;
+
+/* Private function prototypes */
+
+static void InitGenerator(randomADT rng, generatorT type, uint64_t seed);
+static uint64_t SplitMix64(uint64_t *xp);
+static uint64_t NextXoshiro(uint64_t *s);
+static uint32_t NextPCG(uint64_t *s);
+static double NextUnit(randomADT rng);
+static uint32_t BoundedRandom(randomADT rng, uint32_t range);
+static void FillBits(randomADT rng, uint32_t bits[], long n);
+static void FillWords(randomADT rng, uint64_t words[], long n);
+static void JumpXoshiro(uint64_t *s);
+static uint64_t AdvancePCG(uint64_t state, uint64_t increment,
+                           uint64_t delta);
+static void InitZiggurats(void);
+static double NormalFromBits(randomADT rng, uint64_t bits);
+static double NormalTail(randomADT rng, bool negative);
+static double ExponentialFromBits(randomADT rng, uint64_t bits);
+static double OpenUnit(randomADT rng);
+static long SmallPoisson(randomADT rng, double mean);
+static long LargePoisson(randomADT rng, double mean);
+static long SmallBinomial(randomADT rng, long n, double p);
+static long LargeBinomial(randomADT rng, long n, double p);
+static uint64_t BoundedIndex(randomADT rng, uint64_t n);
+static void SwapBatch(char *base, long i, long targets[], long count,
+                      size_t size, char *temp);
+static bool InsertIndex(long table[], uint64_t mask, long index);
+static long ReservoirGap(reservoirADT reservoir);
+
+/* Section 1 -- Functions that use the default generator */
+
 /*
  * Function: Randomize
  * -------------------
- * This function operates by setting the random number
- * seed to the current time.  The srand function is
- * provided by the <stdlib.h> library and requires an
- * integer argument.  The time function is provided
- * by <time.h>.
+ * The first call to Randomize seeds nextRandomized from the
+ * current time.  Each call, including the first, then gives the
+ * calling thread's default generator the stream at which
+ * nextRandomized starts and advances nextRandomized to the next
+ * stream.  Threads that call Randomize in the same second
+ * therefore still receive different sequences.  The function
+ * also calls srand, which keeps the old behavior for clients
+ * that call rand directly.
  */
 
 void Randomize(void)
 {
+    randomADT rng;
+
     srand((int) time(NULL));
+    rng = DefaultRandom();
+    pthread_mutex_lock(&streamLock);
+    if (!randomized) {
+        InitGenerator(&nextRandomized, Xoshiro256, (uint64_t) time(NULL));
+        randomized = TRUE;
+    }
+    *rng = nextRandomized;
+    JumpXoshiro(nextRandomized.state);
+    pthread_mutex_unlock(&streamLock);
+}
+
+int RandomInteger(int low, int high)
+{
+    return (RandomIntegerFrom(DefaultRandom(), low, high));
+}
+
+double RandomReal(double low, double high)
+{
+    return (RandomRealFrom(DefaultRandom(), low, high));
+}
+
+bool RandomChance(double p)
+{
+    return (RandomChanceFrom(DefaultRandom(), p));
+}
+
+/* Section 2 -- Generators with explicit state */
+
+randomADT NewRandom(generatorT type, uint64_t seed)
+{
+    randomADT rng;
+
+    rng = New(randomADT);
+    InitGenerator(rng, type, seed);
+    return (rng);
+}
+
+/*
+ * Function: NewRandomStream
+ * -------------------------
+ * A PCG32 generator can be advanced by any distance in a single
+ * step, so it jumps directly to the start of the stream.  A
+ * Xoshiro256 generator jumps one stream at a time.
+ */
+
+randomADT NewRandomStream(generatorT type, uint64_t seed, long stream)
+{
+    randomADT rng;
+    long i;
+
+    if (stream < 0) Error("NewRandomStream: negative stream");
+    rng = NewRandom(type, seed);
+    if (type == PCG32) {
+        rng->state[0] = AdvancePCG(rng->state[0], rng->state[1],
+                                   PCGJumpSteps * (uint64_t) stream);
+    } else {
+        for (i = 0; i < stream; i++) JumpXoshiro(rng->state);
+    }
+    return (rng);
+}
+
+void SeedRandom(randomADT rng, uint64_t seed)
+{
+    InitGenerator(rng, rng->type, seed);
+}
+
+void JumpRandom(randomADT rng)
+{
+    if (rng->type == PCG32) {
+        rng->state[0] = AdvancePCG(rng->state[0], rng->state[1],
+                                   PCGJumpSteps);
+    } else {
+        JumpXoshiro(rng->state);
+    }
+}
+
+void FreeRandom(randomADT rng)
+{
+    if (rng == &defaultGenerator) Error("FreeRandom: can't free default");
+    FreeBlock(rng);
 }
 
 /*
- * Function: RandomInteger
+ * Function: DefaultRandom
  * -----------------------
- * This function first obtains a random integer in
- * the range [0..RAND_MAX] by applying four steps:
- * (1) Generate a real number in the interval [0,1)
- * (2) Scale it to the appropriate range size
- * (3) Truncate the value to an integer
- * (4) Translate it to the appropriate starting point
+ * The default generator is stored in thread-local storage and is
+ * created the first time the thread uses it.  The first thread to
+ * do so gets stream 0 of DefaultSeed, which makes single-threaded
+ * programs repeatable.  Each later thread gets the stream given
+ * by its position in that order, so that no two threads share a
+ * sequence.  Rather than jumping from stream 0 each time, which
+ * would make the cost grow with the number of threads, the
+ * function copies nextDefault, which always holds the next
+ * stream, and advances it with a single jump.
  */
 
-int RandomInteger(int low, int high)
+randomADT DefaultRandom(void)
 {
-    int k;
-    double d;
+    if (!defaultReady) {
+        pthread_mutex_lock(&streamLock);
+        if (!defaultsSeeded) {
+            InitGenerator(&nextDefault, Xoshiro256, DefaultSeed);
+            defaultsSeeded = TRUE;
+        }
+        defaultGenerator = nextDefault;
+        JumpXoshiro(nextDefault.state);
+        pthread_mutex_unlock(&streamLock);
+        defaultReady = TRUE;
+    }
+    return (&defaultGenerator);
+}
 
-    d = (double) rand() / ((double) RAND_MAX + 1);
-    k = (int) (d * (high - low + 1));
-    return (low + k);
+/*
+ * Function: NextRandom
+ * --------------------
+ * A PCG32 generator produces 32 bits per step, so two steps are
+ * combined to form the result.
+ */
+
+uint64_t NextRandom(randomADT rng)
+{
+    uint64_t high;
+
+    if (rng->type == Xoshiro256) return (NextXoshiro(rng->state));
+    high = NextPCG(rng->state);
+    return ((high << 32) | NextPCG(rng->state));
 }
 
 /*
- * Function: RandomReal
+ * Function: RandomIntegerFrom
+ * ---------------------------
+ * This function applies three steps:
+ * (1) Compute the size of the range as an unsigned integer
+ * (2) Choose an offset within the range using BoundedRandom
+ * (3) Translate it to the appropriate starting point
+ * The arithmetic is unsigned so that it cannot overflow.  A
+ * range that includes every int has a size of 2^32, which wraps
+ * around to 0 and is handled separately.
+ */
+
+int RandomIntegerFrom(randomADT rng, int low, int high)
+{
+    uint32_t range;
+
+    range = (uint32_t) high - (uint32_t) low + 1;
+    if (range == 0) return ((int) (uint32_t) (NextRandom(rng) >> 32));
+    return ((int) ((uint32_t) low + BoundedRandom(rng, range)));
+}
+
+double RandomRealFrom(randomADT rng, double low, double high)
+{
+    return (low + NextUnit(rng) * (high - low));
+}
+
+bool RandomChanceFrom(randomADT rng, double p)
+{
+    return (NextUnit(rng) < p);
+}
+
+/*
+ * Function: MakeChance
  * --------------------
- * The implementation of RandomReal is similar to that
- * of RandomInteger, without the truncation step.
+ * RandomChanceFrom succeeds when the 53-bit integer u taken from
+ * the generator satisfies u * 2^-53 < p.  Since u is an integer,
+ * that is the same as u < ceil(p * 2^53), which is the threshold
+ * stored in the chanceT value.  Multiplying by a power of two is
+ * exact, so the threshold gives exactly the same results.
  */
 
-double RandomReal(double low, double high)
+chanceT MakeChance(double p)
+{
+    chanceT chance;
+
+    if (p <= 0) {
+        chance.threshold = 0;
+    } else if (p >= 1) {
+        chance.threshold = 1ULL << UnitBits;
+    } else {
+        chance.threshold = (uint64_t) ceil(p / UnitScale);
+    }
+    return (chance);
+}
+
+bool TestChance(randomADT rng, chanceT chance)
+{
+    return ((NextRandom(rng) >> (64 - UnitBits)) < chance.threshold);
+}
+
+/*
+ * Function: RandomChanceMask
+ * --------------------------
+ * Each bit of the result is the outcome of comparing a random
+ * 53-bit integer with the threshold, as in TestChance, but the
+ * 64 comparisons are carried out in parallel, one binary digit
+ * at a time from the most significant end.  Each value from the
+ * generator supplies the next digit of all 64 random integers.
+ * A trial is decided at the first digit where its random integer
+ * differs from the threshold: if the random digit is 0 and the
+ * threshold digit is 1, the random integer is smaller and the
+ * trial succeeds; in the opposite case, it fails.  Half of the
+ * undecided trials are decided at each step, so the loop usually
+ * ends after about eight steps.  A trial whose random integer
+ * equals the threshold fails, as it does in TestChance.
+ */
+
+uint64_t RandomChanceMask(randomADT rng, chanceT chance)
+{
+    uint64_t result, undecided, r;
+    int digit;
+
+    if (chance.threshold == 0) return (0);
+    if (chance.threshold >= 1ULL << UnitBits) return (~0ULL);
+    result = 0;
+    undecided = ~0ULL;
+    for (digit = UnitBits - 1; digit >= 0 && undecided != 0; digit--) {
+        r = NextRandom(rng);
+        if (chance.threshold & (1ULL << digit)) {
+            result |= undecided & ~r;
+            undecided &= r;
+        } else {
+            undecided &= ~r;
+        }
+    }
+    return (result);
+}
+
+/*
+ * Function: FillRandomIntegers
+ * ----------------------------
+ * This function uses the same method as BoundedRandom, but it
+ * applies it to a batch of values at a time.  The first loop
+ * maps each value into the range and notes whether any of them
+ * fell into the small biased region that must be rejected.  It
+ * has no branches and is vectorized by the compiler.  In the
+ * rare case that a value must be rejected, a second loop replaces
+ * it with a value from BoundedRandom.
+ */
+
+void FillRandomIntegers(randomADT rng, int array[], long n,
+                        int low, int high)
+{
+    uint32_t bits[FillBatch];
+    uint32_t range, threshold, reject;
+    uint64_t m;
+    long i, j, count;
+
+    range = (uint32_t) high - (uint32_t) low + 1;
+    threshold = (range == 0) ? 0 : (0 - range) % range;
+    for (i = 0; i < n; i += count) {
+        count = (n - i < FillBatch) ? n - i : FillBatch;
+        FillBits(rng, bits, count);
+        if (range == 0) {
+            for (j = 0; j < count; j++) array[i + j] = (int) bits[j];
+            continue;
+        }
+        reject = 0;
+        for (j = 0; j < count; j++) {
+            m = (uint64_t) bits[j] * range;
+            array[i + j] = (int) ((uint32_t) low + (uint32_t) (m >> 32));
+            reject |= ((uint32_t) m < threshold);
+        }
+        if (reject == 0) continue;
+        for (j = 0; j < count; j++) {
+            if ((uint32_t) ((uint64_t) bits[j] * range) < threshold) {
+                array[i + j] = (int) ((uint32_t) low
+                                      + BoundedRandom(rng, range));
+            }
+        }
+    }
+}
+
+/*
+ * Function: FillRandomReals
+ * -------------------------
+ * The conversion loop treats the upper 53 bits of each word as a
+ * signed integer, which converts to a double more quickly than
+ * an unsigned one.
+ */
+
+void FillRandomReals(randomADT rng, double array[], long n,
+                     double low, double high)
+{
+    uint64_t words[FillBatch];
+    double scale;
+    long i, j, count;
+
+    scale = (high - low) * UnitScale;
+    for (i = 0; i < n; i += count) {
+        count = (n - i < FillBatch) ? n - i : FillBatch;
+        FillWords(rng, words, count);
+        for (j = 0; j < count; j++) {
+            array[i + j] = low + (int64_t) (words[j] >> 11) * scale;
+        }
+    }
+}
+
+/* Section 3 -- Non-uniform distributions */
+
+/*
+ * Functions: RandomNormal, RandomExponential
+ * ------------------------------------------
+ * These functions use the ziggurat method of Marsaglia and Tsang,
+ * in the form given by Doornik.  The area under the density is
+ * covered by a stack of layers of equal area, all but the bottom
+ * one rectangular.  Choosing a layer and a point within it takes
+ * a single 64-bit value: the low bits select the layer, and the
+ * upper 53 bits give the position.  The point is almost always
+ * in the part of the layer that lies entirely under the curve,
+ * in which case it is returned after a single comparison,
+ * without computing any logarithms or square roots.  The rare
+ * points in the wedge at the end of a layer, or in the tail
+ * beyond the bottom layer, are handled by the slower code in
+ * NormalFromBits and ExponentialFromBits.
+ */
+
+double RandomNormal(randomADT rng, double mean, double stddev)
+{
+    return (mean + stddev * NormalFromBits(rng, NextRandom(rng)));
+}
+
+double RandomExponential(randomADT rng, double mean)
+{
+    return (mean * ExponentialFromBits(rng, NextRandom(rng)));
+}
+
+/*
+ * Function: RandomPoisson
+ * -----------------------
+ * For small means, this function counts the number of uniform
+ * values whose product remains above exp(-mean), which takes
+ * time proportional to the mean.  For larger means, it uses
+ * LargePoisson, whose time does not depend on the mean.
+ */
+
+long RandomPoisson(randomADT rng, double mean)
+{
+    if (mean < 0) Error("RandomPoisson: negative mean");
+    if (mean < SmallMean) return (SmallPoisson(rng, mean));
+    return (LargePoisson(rng, mean));
+}
+
+/*
+ * Function: RandomBinomial
+ * ------------------------
+ * The function works with the probability of the less likely
+ * outcome, which keeps the expected count small, and converts
+ * the result back at the end.  As in RandomPoisson, it uses a
+ * counting method when the expected count is small and a
+ * rejection method otherwise.
+ */
+
+long RandomBinomial(randomADT rng, long n, double p)
+{
+    long k;
+    double q;
+
+    if (n < 0 || p < 0 || p > 1) Error("RandomBinomial: illegal arguments");
+    q = (p <= 0.5) ? p : 1 - p;
+    if (n * q < SmallMean) {
+        k = SmallBinomial(rng, n, q);
+    } else {
+        k = LargeBinomial(rng, n, q);
+    }
+    return ((p <= 0.5) ? k : n - k);
+}
+
+/*
+ * Functions: FillRandomNormals, FillRandomExponentials
+ * ----------------------------------------------------
+ * These functions draw their 64-bit values in batches with
+ * FillWords and pass each one to the ziggurat code, which takes
+ * more values from the generator directly in the rare cases
+ * that need them.
+ */
+
+void FillRandomNormals(randomADT rng, double array[], long n,
+                       double mean, double stddev)
 {
-    double d;
+    uint64_t words[FillBatch];
+    long i, j, count;
 
-    d = (double) rand() / ((double) RAND_MAX + 1);
-    return (low + d * (high - low));
+    for (i = 0; i < n; i += count) {
+        count = (n - i < FillBatch) ? n - i : FillBatch;
+        FillWords(rng, words, count);
+        for (j = 0; j < count; j++) {
+            array[i + j] = mean + stddev * NormalFromBits(rng, words[j]);
+        }
+    }
 }
 
+void FillRandomExponentials(randomADT rng, double array[], long n,
+                            double mean)
+{
+    uint64_t words[FillBatch];
+    long i, j, count;
+
+    for (i = 0; i < n; i += count) {
+        count = (n - i < FillBatch) ? n - i : FillBatch;
+        FillWords(rng, words, count);
+        for (j = 0; j < count; j++) {
+            array[i + j] = mean * ExponentialFromBits(rng, words[j]);
+        }
+    }
+}
+
+/* Section 4 -- Shuffling and sampling */
+
 /*
- * Function: RandomChance
+ * Function: ShuffleArray
  * ----------------------
- * This function uses RandomReal to generate a number
- * between 0 and 100, which it then compares to p.
+ * This function implements the Fisher-Yates shuffle, which
+ * exchanges each element, working down from the end, with an
+ * element chosen at random from those at or below it.  In a
+ * large array, almost every exchange touches an element that is
+ * not in the cache.  The function therefore chooses the targets
+ * of a batch of exchanges in advance and asks the processor to
+ * start fetching them, so that the memory accesses overlap
+ * rather than occurring one at a time.  The exchanges are still
+ * performed in order, so the result does not depend on the
+ * batch size.
  */
 
-bool RandomChance(double p)
+void ShuffleArray(randomADT rng, void *array, long n, size_t size)
+{
+    long targets[ShuffleBatch];
+    char *base, *temp;
+    long i, k, count;
+
+    base = (char *) array;
+    temp = GetBlock(size);
+    for (i = n - 1; i > 0; i -= count) {
+        count = (i < ShuffleBatch) ? i : ShuffleBatch;
+        for (k = 0; k < count; k++) {
+            targets[k] = (long) BoundedIndex(rng, i - k + 1);
+            Prefetch(base + targets[k] * size);
+        }
+        SwapBatch(base, i, targets, count, size, temp);
+    }
+    FreeBlock(temp);
+}
+
+/*
+ * Function: SampleIndices
+ * -----------------------
+ * This function implements Floyd's algorithm, which considers
+ * the last k integers of the range in turn.  For each integer j,
+ * it chooses an integer t at random from 0 to j and adds t to
+ * the sample if it is not already there, or j if it is.  Since j
+ * cannot already be in the sample, each step adds exactly one
+ * integer.  The sample is kept in an open-addressed hash table
+ * whose size is a power of two at least twice k, so that probes
+ * are short.
+ */
+
+void SampleIndices(randomADT rng, long result[], long k, long n)
+{
+    long *table;
+    uint64_t size, i;
+    long j, t;
+
+    if (k < 0 || k > n) Error("SampleIndices: illegal sample size");
+    size = 1;
+    while (size < 2 * (uint64_t) k) size *= 2;
+    table = NewArray(size, long);
+    for (i = 0; i < size; i++) table[i] = -1;
+    for (j = n - k; j < n; j++) {
+        t = (long) BoundedIndex(rng, j + 1);
+        if (!InsertIndex(table, size - 1, t)) {
+            t = j;
+            (void) InsertIndex(table, size - 1, t);
+        }
+        *result++ = t;
+    }
+    FreeBlock(table);
+}
+
+/*
+ * Functions: NewReservoir, NextReservoirSlot
+ * ------------------------------------------
+ * These functions implement Li's Algorithm L.  Rather than
+ * deciding separately for each item whether it is selected, the
+ * reservoir computes the gap to the next selected item directly
+ * from the distribution of that gap, so the generator is used
+ * only for the items that are selected.  The variable w is the
+ * largest of k uniform values assigned to the items in the
+ * current sample; each selection replaces it with a smaller one.
+ */
+
+reservoirADT NewReservoir(randomADT rng, long k)
+{
+    reservoirADT reservoir;
+
+    if (k <= 0) Error("NewReservoir: sample size must be positive");
+    reservoir = New(reservoirADT);
+    reservoir->rng = rng;
+    reservoir->k = k;
+    reservoir->seen = 0;
+    reservoir->w = exp(log(OpenUnit(rng)) / k);
+    reservoir->next = k + ReservoirGap(reservoir);
+    return (reservoir);
+}
+
+long NextReservoirSlot(reservoirADT reservoir)
+{
+    long index, slot;
+
+    index = reservoir->seen++;
+    if (index < reservoir->k) return (index);
+    if (index < reservoir->next) return (-1);
+    slot = (long) BoundedIndex(reservoir->rng, reservoir->k);
+    reservoir->w *= exp(log(OpenUnit(reservoir->rng)) / reservoir->k);
+    reservoir->next = index + 1 + ReservoirGap(reservoir);
+    return (slot);
+}
+
+void FreeReservoir(reservoirADT reservoir)
+{
+    FreeBlock(reservoir);
+}
+
+/*
+ * Function: NewAliasTable
+ * -----------------------
+ * This function implements Vose's method.  The weights are first
+ * scaled so that their average is 1.  The columns are then
+ * divided into those whose scaled weight is less than 1, which
+ * need an alias, and the others, which can supply one.  Each step
+ * pairs a column of the first kind with one of the second, which
+ * fills the first column and reduces the weight of the second,
+ * perhaps moving it to the first group.  The two groups are kept
+ * as stacks at the two ends of a single work array.  Columns left
+ * over at the end, whose weights differ from 1 only because of
+ * rounding errors, are filled completely.
+ */
+
+aliasADT NewAliasTable(double weights[], long n)
+{
+    aliasADT table;
+    aliasColumnT *cp;
+    long *work, nSmall, nLarge, i, small, large;
+    double sum;
+
+    if (n <= 0) Error("NewAliasTable: table must not be empty");
+    sum = 0;
+    for (i = 0; i < n; i++) {
+        if (weights[i] < 0) Error("NewAliasTable: negative weight");
+        sum += weights[i];
+    }
+    if (sum <= 0) Error("NewAliasTable: weights are all zero");
+    table = New(aliasADT);
+    table->n = n;
+    table->columns = cp = NewArray(n, aliasColumnT);
+    work = NewArray(n, long);
+    nSmall = nLarge = 0;
+    for (i = 0; i < n; i++) {
+        cp[i].prob = weights[i] * n / sum;
+        cp[i].alias = i;
+        if (cp[i].prob < 1) {
+            work[nSmall++] = i;
+        } else {
+            work[n - 1 - nLarge++] = i;
+        }
+    }
+    while (nSmall > 0 && nLarge > 0) {
+        small = work[--nSmall];
+        large = work[n - nLarge];
+        cp[small].alias = large;
+        cp[large].prob -= 1 - cp[small].prob;
+        if (cp[large].prob < 1) {
+            nLarge--;
+            work[nSmall++] = large;
+        }
+    }
+    while (nSmall > 0) cp[work[--nSmall]].prob = 1;
+    while (nLarge > 0) cp[work[n - nLarge--]].prob = 1;
+    FreeBlock(work);
+    return (table);
+}
+
+long RandomAlias(randomADT rng, aliasADT table)
+{
+    aliasColumnT *cp;
+    long i;
+
+    i = (long) BoundedIndex(rng, table->n);
+    cp = &table->columns[i];
+    return ((NextUnit(rng) < cp->prob) ? i : cp->alias);
+}
+
+void FreeAliasTable(aliasADT table)
+{
+    FreeBlock(table->columns);
+    FreeBlock(table);
+}
+
+/* Private functions */
+
+/*
+ * Function: InitGenerator
+ * Usage: InitGenerator(rng, type, seed);
+ * --------------------------------------
+ * This function sets the type of the generator and derives its
+ * state from the seed.  The seed is expanded with SplitMix64,
+ * which turns nearby seeds into unrelated states and never
+ * produces the all-zero state that xoshiro256** must avoid.
+ * The PCG32 state is then advanced once, as in O'Neill's
+ * reference implementation, so that its first output already
+ * depends on every bit of the seed.  Since every generator is
+ * initialized here, this is also where the ziggurat tables are
+ * built, which saves the distribution functions from checking.
+ */
+
+static void InitGenerator(randomADT rng, generatorT type, uint64_t seed)
+{
+    int i;
+
+    pthread_once(&zigguratOnce, InitZiggurats);
+    rng->type = type;
+    if (type == Xoshiro256) {
+        for (i = 0; i < 4; i++) rng->state[i] = SplitMix64(&seed);
+    } else if (type == PCG32) {
+        rng->state[0] = SplitMix64(&seed);
+        rng->state[1] = SplitMix64(&seed) | 1;
+        rng->state[2] = rng->state[3] = 0;
+        (void) NextPCG(rng->state);
+    } else {
+        Error("NewRandom: unknown generator type");
+    }
+}
+
+/*
+ * Function: SplitMix64
+ * Usage: bits = SplitMix64(&x);
+ * -----------------------------
+ * This function advances x by a fixed odd constant and returns a
+ * thoroughly mixed function of the result.  It is used only to
+ * expand seeds.
+ */
+
+static uint64_t SplitMix64(uint64_t *xp)
+{
+    uint64_t z;
+
+    z = (*xp += GoldenGamma);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return (z ^ (z >> 31));
+}
+
+/*
+ * Function: NextXoshiro
+ * Usage: bits = NextXoshiro(state);
+ * ---------------------------------
+ * This function advances a xoshiro256** state and returns the
+ * next 64-bit output.
+ */
+
+static uint64_t NextXoshiro(uint64_t *s)
+{
+    uint64_t result, t;
+
+    result = s[1] * 5;
+    result = ((result << 7) | (result >> 57)) * 9;
+    t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = (s[3] << 45) | (s[3] >> 19);
+    return (result);
+}
+
+/*
+ * Function: NextPCG
+ * Usage: bits = NextPCG(state);
+ * -----------------------------
+ * This function advances a PCG32 state and returns the next
+ * 32-bit output, which is computed from the old state by an
+ * xorshift followed by a rotation that depends on the top bits.
+ */
+
+static uint32_t NextPCG(uint64_t *s)
+{
+    uint64_t old;
+    uint32_t xorshifted, rot;
+
+    old = s[0];
+    s[0] = old * PCGMultiplier + s[1];
+    xorshifted = (uint32_t) (((old >> 18) ^ old) >> 27);
+    rot = (uint32_t) (old >> 59);
+    return ((xorshifted >> rot) | (xorshifted << ((32 - rot) & 31)));
+}
+
+/*
+ * Function: NextUnit
+ * Usage: d = NextUnit(rng);
+ * -------------------------
+ * This function returns a random double in [0,1) whose 53 bits
+ * of precision are all taken from the generator.
+ */
+
+static double NextUnit(randomADT rng)
+{
+    return ((NextRandom(rng) >> 11) * UnitScale);
+}
+
+/*
+ * Function: BoundedRandom
+ * Usage: offset = BoundedRandom(rng, range);
+ * ------------------------------------------
+ * This function returns a random integer in the range 0 to
+ * range - 1 without bias, using Lemire's nearly divisionless
+ * method.  Multiplying 32 random bits by the range gives a
+ * 64-bit product whose upper half is in the desired range.  The
+ * upper half is slightly more likely to take some values than
+ * others, but the excess comes only from products whose lower
+ * half is less than 2^32 mod range, and rejecting those makes
+ * every result equally likely.  Since the lower half is almost
+ * always at least range, the remainder needs to be computed only
+ * rarely, and the loop almost never repeats.
+ */
+
+static uint32_t BoundedRandom(randomADT rng, uint32_t range)
+{
+    uint64_t m;
+    uint32_t threshold;
+
+    m = (NextRandom(rng) >> 32) * range;
+    if ((uint32_t) m < range) {
+        threshold = (0 - range) % range;
+        while ((uint32_t) m < threshold) {
+            m = (NextRandom(rng) >> 32) * range;
+        }
+    }
+    return ((uint32_t) (m >> 32));
+}
+
+/*
+ * Function: FillBits
+ * Usage: FillBits(rng, bits, n);
+ * ------------------------------
+ * This function fills the first n elements of bits with random
+ * 32-bit values, taking two from each output of the generator.
+ * For the default generator type, the state is copied into local
+ * variables for the duration of the loop, which lets the
+ * compiler keep it in registers.
+ */
+
+static void FillBits(randomADT rng, uint32_t bits[], long n)
+{
+    uint64_t s[4], x;
+    long i;
+
+    if (rng->type == Xoshiro256) {
+        memcpy(s, rng->state, sizeof s);
+        for (i = 0; i + 1 < n; i += 2) {
+            x = NextXoshiro(s);
+            bits[i] = (uint32_t) x;
+            bits[i + 1] = (uint32_t) (x >> 32);
+        }
+        if (i < n) bits[i] = (uint32_t) NextXoshiro(s);
+        memcpy(rng->state, s, sizeof s);
+    } else {
+        for (i = 0; i < n; i++) bits[i] = NextPCG(rng->state);
+    }
+}
+
+/*
+ * Function: FillWords
+ * Usage: FillWords(rng, words, n);
+ * --------------------------------
+ * This function fills the first n elements of words with random
+ * 64-bit values in the same way that FillBits fills an array of
+ * 32-bit values.
+ */
+
+static void FillWords(randomADT rng, uint64_t words[], long n)
+{
+    uint64_t s[4];
+    long i;
+
+    if (rng->type == Xoshiro256) {
+        memcpy(s, rng->state, sizeof s);
+        for (i = 0; i < n; i++) words[i] = NextXoshiro(s);
+        memcpy(rng->state, s, sizeof s);
+    } else {
+        for (i = 0; i < n; i++) words[i] = NextRandom(rng);
+    }
+}
+
+/*
+ * Function: JumpXoshiro
+ * Usage: JumpXoshiro(state);
+ * --------------------------
+ * This function advances a xoshiro256** state by 2^128 steps.
+ * The generator is linear over GF(2), so the state after the
+ * jump is a fixed linear combination of the states that follow
+ * the current one.  The bits of the jump polynomial select which
+ * of the next 256 states are combined with exclusive or.
+ */
+
+static void JumpXoshiro(uint64_t *s)
+{
+    uint64_t t[4];
+    int i, b;
+
+    t[0] = t[1] = t[2] = t[3] = 0;
+    for (i = 0; i < 4; i++) {
+        for (b = 0; b < 64; b++) {
+            if (xoshiroJump[i] & (1ULL << b)) {
+                t[0] ^= s[0];
+                t[1] ^= s[1];
+                t[2] ^= s[2];
+                t[3] ^= s[3];
+            }
+            (void) NextXoshiro(s);
+        }
+    }
+    memcpy(s, t, sizeof t);
+}
+
+/*
+ * Function: AdvancePCG
+ * Usage: state = AdvancePCG(state, increment, delta);
+ * ---------------------------------------------------
+ * This function returns the PCG32 state that follows the given
+ * one after delta steps, using Brown's method for jumping a
+ * linear congruential generator.  Composing the step with itself
+ * gives another affine map, so the maps for 1, 2, 4, ... steps
+ * are found by repeated squaring, and those corresponding to the
+ * bits of delta are combined.  The time is proportional to the
+ * number of bits in delta.
+ */
+
+static uint64_t AdvancePCG(uint64_t state, uint64_t increment,
+                           uint64_t delta)
+{
+    uint64_t accMult, accPlus, curMult, curPlus;
+
+    accMult = 1;
+    accPlus = 0;
+    curMult = PCGMultiplier;
+    curPlus = increment;
+    while (delta > 0) {
+        if (delta & 1) {
+            accMult *= curMult;
+            accPlus = accPlus * curMult + curPlus;
+        }
+        curPlus = (curMult + 1) * curPlus;
+        curMult *= curMult;
+        delta >>= 1;
+    }
+    return (accMult * state + accPlus);
+}
+
+/*
+ * Function: InitZiggurats
+ * Usage: pthread_once(&zigguratOnce, InitZiggurats);
+ * --------------------------------------------------
+ * This function builds the tables for both ziggurats.  Layer 0
+ * is the bottom layer, which consists of a rectangle of width R
+ * together with the tail beyond it; its width is recorded as the
+ * width of a rectangle with the same area, V / f(R).  Each layer
+ * above it is a rectangle of area V, which determines the edge
+ * of the next layer.  The top edge is 0.
+ */
+
+static void InitZiggurats(void)
+{
+    double f;
+    int i;
+
+    f = exp(-0.5 * NormalR * NormalR);
+    normalX[0] = NormalV / f;
+    normalX[1] = NormalR;
+    normalX[NormalLayers] = 0;
+    for (i = 2; i < NormalLayers; i++) {
+        normalX[i] = sqrt(-2 * log(NormalV / normalX[i - 1] + f));
+        f = exp(-0.5 * normalX[i] * normalX[i]);
+    }
+    for (i = 0; i <= NormalLayers; i++) {
+        normalF[i] = exp(-0.5 * normalX[i] * normalX[i]);
+    }
+    for (i = 0; i < NormalLayers; i++) {
+        normalRatio[i] = normalX[i + 1] / normalX[i];
+    }
+    f = exp(-ExpR);
+    expX[0] = ExpV / f;
+    expX[1] = ExpR;
+    expX[ExpLayers] = 0;
+    for (i = 2; i < ExpLayers; i++) {
+        expX[i] = -log(ExpV / expX[i - 1] + f);
+        f = exp(-expX[i]);
+    }
+    for (i = 0; i <= ExpLayers; i++) expF[i] = exp(-expX[i]);
+    for (i = 0; i < ExpLayers; i++) expRatio[i] = expX[i + 1] / expX[i];
+}
+
+/*
+ * Function: NormalFromBits
+ * Usage: x = NormalFromBits(rng, bits);
+ * -------------------------------------
+ * This function returns a standard normal value chosen using the
+ * 64-bit value bits.  The low seven bits choose a layer, and the
+ * upper 53 bits choose a position u in [-1,1), which is scaled
+ * by the width of the layer.  If the point is outside the part
+ * of the layer that lies under the next layer up, the function
+ * tests it against the curve, or draws from the tail if it is in
+ * the bottom layer.  Rejected points are replaced by new values
+ * from the generator.
+ */
+
+static double NormalFromBits(randomADT rng, uint64_t bits)
+{
+    double u, x;
+    int i;
+
+    while (TRUE) {
+        u = (int64_t) (bits >> 11) * (2 * UnitScale) - 1;
+        i = (int) (bits & (NormalLayers - 1));
+        if (fabs(u) < normalRatio[i]) return (u * normalX[i]);
+        if (i == 0) return (NormalTail(rng, u < 0));
+        x = u * normalX[i];
+        if (normalF[i + 1] + NextUnit(rng) * (normalF[i] - normalF[i + 1])
+              < exp(-0.5 * x * x)) {
+            return (x);
+        }
+        bits = NextRandom(rng);
+    }
+}
+
+/*
+ * Function: NormalTail
+ * Usage: x = NormalTail(rng, negative);
+ * -------------------------------------
+ * This function returns a value from the tail of the normal
+ * distribution beyond NormalR, using Marsaglia's method.
+ */
+
+static double NormalTail(randomADT rng, bool negative)
+{
+    double x, y;
+
+    do {
+        x = log(OpenUnit(rng)) / NormalR;
+        y = log(OpenUnit(rng));
+    } while (-2 * y < x * x);
+    return ((negative) ? x - NormalR : NormalR - x);
+}
+
+/*
+ * Function: ExponentialFromBits
+ * Usage: x = ExponentialFromBits(rng, bits);
+ * ------------------------------------------
+ * This function returns an exponential value with mean 1 chosen
+ * using the 64-bit value bits, in the same way as NormalFromBits.
+ * The low eight bits choose a layer, and the upper 53 bits give
+ * a position in [0,1).  Because the exponential distribution is
+ * memoryless, a value in the tail is simply ExpR plus a new
+ * exponential value.
+ */
+
+static double ExponentialFromBits(randomADT rng, uint64_t bits)
+{
+    double u, x;
+    int i;
+
+    while (TRUE) {
+        u = (int64_t) (bits >> 11) * UnitScale;
+        i = (int) (bits & (ExpLayers - 1));
+        if (u < expRatio[i]) return (u * expX[i]);
+        if (i == 0) return (ExpR - log(OpenUnit(rng)));
+        x = u * expX[i];
+        if (expF[i + 1] + NextUnit(rng) * (expF[i] - expF[i + 1])
+              < exp(-x)) {
+            return (x);
+        }
+        bits = NextRandom(rng);
+    }
+}
+
+/*
+ * Function: OpenUnit
+ * Usage: d = OpenUnit(rng);
+ * -------------------------
+ * This function returns a random double in the open interval
+ * (0,1), which is safe to pass to log.
+ */
+
+static double OpenUnit(randomADT rng)
+{
+    return (((NextRandom(rng) >> 11) + 0.5) * UnitScale);
+}
+
+/*
+ * Function: SmallPoisson
+ * Usage: k = SmallPoisson(rng, mean);
+ * -----------------------------------
+ * This function implements Knuth's method for the Poisson
+ * distribution: the result is the number of uniform values that
+ * can be multiplied together before the product falls below
+ * exp(-mean).
+ */
+
+static long SmallPoisson(randomADT rng, double mean)
+{
+    double limit, product;
+    long k;
+
+    limit = exp(-mean);
+    product = NextUnit(rng);
+    for (k = 0; product > limit; k++) product *= NextUnit(rng);
+    return (k);
+}
+
+/*
+ * Function: LargePoisson
+ * Usage: k = LargePoisson(rng, mean);
+ * -----------------------------------
+ * This function implements Hormann's PTRS method, a transformed
+ * rejection method whose hat function closely fits the Poisson
+ * distribution, so that most candidates are accepted by a quick
+ * test and the exact test with lgamma is rarely needed.  The
+ * constants are those of Hormann's paper.
+ */
+
+static long LargePoisson(randomADT rng, double mean)
 {
-    return (RandomReal(0, 1) < p);
+    double slam, loglam, a, b, invAlpha, vr, u, v, us;
+    long k;
+
+    slam = sqrt(mean);
+    loglam = log(mean);
+    b = 0.931 + 2.53 * slam;
+    a = -0.059 + 0.02483 * b;
+    invAlpha = 1.1239 + 1.1328 / (b - 3.4);
+    vr = 0.9277 - 3.6224 / (b - 2);
+    while (TRUE) {
+        u = NextUnit(rng) - 0.5;
+        v = NextUnit(rng);
+        us = 0.5 - fabs(u);
+        k = (long) floor((2 * a / us + b) * u + mean + 0.43);
+        if (us >= 0.07 && v <= vr) return (k);
+        if (k < 0 || (us < 0.013 && v > us)) continue;
+        if (log(v) + log(invAlpha) - log(a / (us * us) + b)
+              <= -mean + k * loglam - lgamma(k + 1.0)) {
+            return (k);
+        }
+    }
+}
+
+/*
+ * Function: SmallBinomial
+ * Usage: k = SmallBinomial(rng, n, p);
+ * ------------------------------------
+ * This function chooses a binomial value by inversion: it
+ * subtracts the probabilities of 0, 1, 2, ... successes from a
+ * uniform value until it becomes negative.  Each probability is
+ * computed from the one before it.  If rounding errors exhaust
+ * the probabilities first, the function starts again.
+ */
+
+static long SmallBinomial(randomADT rng, long n, double p)
+{
+    double q, s, a, r, u;
+    long k;
+
+    q = 1 - p;
+    s = p / q;
+    a = (n + 1) * s;
+    while (TRUE) {
+        r = pow(q, (double) n);
+        u = NextUnit(rng);
+        for (k = 0; k <= n; k++) {
+            if (u < r) return (k);
+            u -= r;
+            r *= a / (k + 1) - s;
+        }
+    }
+}
+
+/*
+ * Function: LargeBinomial
+ * Usage: k = LargeBinomial(rng, n, p);
+ * ------------------------------------
+ * This function implements Hormann's BTRS method, the binomial
+ * counterpart of the PTRS method used by LargePoisson.  It
+ * requires p <= 0.5 and n * p >= 10.
+ */
+
+static long LargeBinomial(randomADT rng, long n, double p)
+{
+    double q, spq, a, b, c, vr, alpha, lpq, h, u, v, us;
+    long k, m;
+
+    q = 1 - p;
+    spq = sqrt(n * p * q);
+    b = 1.15 + 2.53 * spq;
+    a = -0.0873 + 0.0248 * b + 0.01 * p;
+    c = n * p + 0.5;
+    vr = 0.92 - 4.2 / b;
+    alpha = (2.83 + 5.1 / b) * spq;
+    lpq = log(p / q);
+    m = (long) floor((n + 1) * p);
+    h = lgamma(m + 1.0) + lgamma(n - m + 1.0);
+    while (TRUE) {
+        u = NextUnit(rng) - 0.5;
+        v = NextUnit(rng);
+        us = 0.5 - fabs(u);
+        k = (long) floor((2 * a / us + b) * u + c);
+        if (k < 0 || k > n) continue;
+        if (us >= 0.07 && v <= vr) return (k);
+        v = log(v * alpha / (a / (us * us) + b));
+        if (v <= h - lgamma(k + 1.0) - lgamma(n - k + 1.0) + (k - m) * lpq) {
+            return (k);
+        }
+    }
+}
+
+/*
+ * Function: BoundedIndex
+ * Usage: i = BoundedIndex(rng, n);
+ * --------------------------------
+ * This function returns a random integer from 0 to n - 1 without
+ * bias, for any positive n.  Ranges that fit in 32 bits use
+ * BoundedRandom.  Larger ones mask the generator's output to the
+ * smallest enclosing power of two and reject values that are too
+ * large, which happens less than half the time.
+ */
+
+static uint64_t BoundedIndex(randomADT rng, uint64_t n)
+{
+    uint64_t mask, x;
+
+    if (n <= 0xFFFFFFFFULL) return (BoundedRandom(rng, (uint32_t) n));
+    mask = n - 1;
+    mask |= mask >> 1;
+    mask |= mask >> 2;
+    mask |= mask >> 4;
+    mask |= mask >> 8;
+    mask |= mask >> 16;
+    mask |= mask >> 32;
+    do {
+        x = NextRandom(rng) & mask;
+    } while (x >= n);
+    return (x);
+}
+
+/*
+ * Function: SwapBatch
+ * Usage: SwapBatch(base, i, targets, count, size, temp);
+ * ------------------------------------------------------
+ * This function exchanges element i - k of the array with
+ * element targets[k] for each k from 0 to count - 1, using temp,
+ * which must hold at least size bytes, as scratch space.  Arrays
+ * of ints and longs are handled by separate loops in which the
+ * size is a constant, which lets the compiler turn each exchange
+ * into a pair of loads and stores.
+ */
+
+static void SwapBatch(char *base, long i, long targets[], long count,
+                      size_t size, char *temp)
+{
+    int *ip, it;
+    long *lp, lt;
+    long k;
+
+    if (size == sizeof (int)) {
+        ip = (int *) base;
+        for (k = 0; k < count; k++) {
+            it = ip[i - k];
+            ip[i - k] = ip[targets[k]];
+            ip[targets[k]] = it;
+        }
+    } else if (size == sizeof (long)) {
+        lp = (long *) base;
+        for (k = 0; k < count; k++) {
+            lt = lp[i - k];
+            lp[i - k] = lp[targets[k]];
+            lp[targets[k]] = lt;
+        }
+    } else {
+        for (k = 0; k < count; k++) {
+            memcpy(temp, base + (i - k) * size, size);
+            memcpy(base + (i - k) * size, base + targets[k] * size, size);
+            memcpy(base + targets[k] * size, temp, size);
+        }
+    }
+}
+
+/*
+ * Function: InsertIndex
+ * Usage: if (InsertIndex(table, mask, index)) . . .
+ * -------------------------------------------------
+ * This function adds a nonnegative index to a hash table whose
+ * size is mask + 1, in which empty entries are -1.  It returns
+ * TRUE if the index was added and FALSE if it was already there.
+ * The hash function multiplies by a constant derived from the
+ * golden ratio, which spreads consecutive indices evenly.
+ */
+
+static bool InsertIndex(long table[], uint64_t mask, long index)
+{
+    uint64_t h;
+
+    h = ((uint64_t) index * GoldenGamma) >> 32;
+    while (TRUE) {
+        h &= mask;
+        if (table[h] == index) return (FALSE);
+        if (table[h] == -1) {
+            table[h] = index;
+            return (TRUE);
+        }
+        h++;
+    }
+}
+
+/*
+ * Function: ReservoirGap
+ * Usage: gap = ReservoirGap(reservoir);
+ * -------------------------------------
+ * This function returns the number of items to skip before the
+ * next selected item, which has a geometric distribution with
+ * parameter 1 - w.  Gaps too large to represent are limited to
+ * LONG_MAX / 2, which no stream will reach.
+ */
+
+static long ReservoirGap(reservoirADT reservoir)
+{
+    double gap;
+
+    gap = floor(log(OpenUnit(reservoir->rng)) / log1p(-reservoir->w));
+    return ((gap < LONG_MAX / 2) ? (long) gap : LONG_MAX / 2);
 }
@@ -12,6 +12,7 @@
 
 #include "genlib.h"
 #include <stdlib.h>
+#include <stdint.h>
 
 /*
  * Constant: RAND_MAX
@@ -26,6 +27,8 @@
 #  define RAND_MAX ((int) ((unsigned) ~0 >> 1))
 #endif
 
+/* Section 1 -- Functions that use the default generator */
+
 /*
  * Function: Randomize
  * Usage: Randomize();
@@ -33,6 +36,14 @@
  * This function sets the random seed so that the random sequence
  * is unpredictable.  During the debugging phase, it is best not
  * to call this function, so that program behavior is repeatable.
+ *
+ * The functions RandomInteger, RandomReal, and RandomChance draw
+ * their values from a default generator that belongs to the
+ * calling thread, so that threads never contend for it.  Unless
+ * Randomize is called, the default generator of the first thread
+ * produces the same sequence on every run and on every platform.
+ * Randomize affects only the default generator of the thread
+ * that calls it.
  */
 
 void Randomize(void);
@@ -42,7 +53,8 @@ void Randomize(void);
  * Usage: n = RandomInteger(low, high);
  * ------------------------------------
  * This function returns a random integer in the range low to high,
- * inclusive.
+ * inclusive.  Every integer in the range is equally likely, even
+ * when the range is very large.
  */
 
 int RandomInteger(int low, int high);
@@ -70,4 +82,363 @@ double RandomReal(double low, double high);
 
 bool RandomChance(double p);
 
+/* Section 2 -- Generators with explicit state */
+
+/*
+ * Type: randomADT
+ * ---------------
+ * This abstract type represents the state of a pseudo-random
+ * number generator.  Programs that need several independent
+ * sequences, or that need a sequence whose values do not depend
+ * on any other use of the random functions, create a generator
+ * of their own and pass it to the functions in this section.
+ * A generator must not be used by more than one thread at a
+ * time.
+ */
+
+typedef struct randomCDT *randomADT;
+
+/*
+ * Type: generatorT
+ * ----------------
+ * This type identifies the algorithm used by a generator.
+ * Xoshiro256 is the xoshiro256** generator of Blackman and
+ * Vigna, which has 256 bits of state and is the default.
+ * PCG32 is O'Neill's PCG-XSH-RR generator, which has 64 bits of
+ * state and produces 32 bits at a time.  Both produce the same
+ * sequence on every platform for a given seed.
+ */
+
+typedef enum { Xoshiro256, PCG32 } generatorT;
+
+/*
+ * Function: NewRandom
+ * Usage: rng = NewRandom(type, seed);
+ * -----------------------------------
+ * This function returns a new generator of the given type whose
+ * state is determined by seed.  Any seed is acceptable, and
+ * nearby seeds produce unrelated sequences.
+ */
+
+randomADT NewRandom(generatorT type, uint64_t seed);
+
+/*
+ * Function: NewRandomStream
+ * Usage: rng = NewRandomStream(type, seed, stream);
+ * -------------------------------------------------
+ * This function returns a generator for one of many independent
+ * streams derived from a single seed.  Stream 0 is the sequence
+ * that NewRandom(type, seed) produces, and stream k is the same
+ * sequence after JumpRandom has been applied k times, so that
+ * the streams never overlap.  A parallel program that assigns
+ * one stream to each piece of its work, rather than to each
+ * thread, obtains the same results no matter how many threads
+ * it uses.
+ */
+
+randomADT NewRandomStream(generatorT type, uint64_t seed, long stream);
+
+/*
+ * Function: SeedRandom
+ * Usage: SeedRandom(rng, seed);
+ * -----------------------------
+ * This function resets the generator to the state that
+ * NewRandom would give it for the same seed.
+ */
+
+void SeedRandom(randomADT rng, uint64_t seed);
+
+/*
+ * Function: JumpRandom
+ * Usage: JumpRandom(rng);
+ * -----------------------
+ * This function advances the generator as if NextRandom had been
+ * called a very large number of times: 2^128 times for a
+ * Xoshiro256 generator and 2^47 times for a PCG32 generator,
+ * which advances its 32-bit output sequence by 2^48 steps.  It
+ * takes about as long as a few hundred calls to NextRandom.
+ */
+
+void JumpRandom(randomADT rng);
+
+/*
+ * Function: FreeRandom
+ * Usage: FreeRandom(rng);
+ * -----------------------
+ * This function frees the storage for a generator.
+ */
+
+void FreeRandom(randomADT rng);
+
+/*
+ * Function: DefaultRandom
+ * Usage: rng = DefaultRandom();
+ * -----------------------------
+ * This function returns the default generator for the calling
+ * thread, which is the one used by RandomInteger, RandomReal,
+ * and RandomChance.  The result must not be freed.
+ */
+
+randomADT DefaultRandom(void);
+
+/*
+ * Function: NextRandom
+ * Usage: bits = NextRandom(rng);
+ * ------------------------------
+ * This function returns the next 64 random bits from the
+ * generator.  All 64 bits are of equally high quality.
+ */
+
+uint64_t NextRandom(randomADT rng);
+
+/*
+ * Functions: RandomIntegerFrom, RandomRealFrom, RandomChanceFrom
+ * Usage: n = RandomIntegerFrom(rng, low, high);
+ *        d = RandomRealFrom(rng, low, high);
+ *        if (RandomChanceFrom(rng, p)) . . .
+ * --------------------------------------------------------------
+ * These functions are like RandomInteger, RandomReal, and
+ * RandomChance, except that they take their values from the
+ * generator rng.
+ */
+
+int RandomIntegerFrom(randomADT rng, int low, int high);
+double RandomRealFrom(randomADT rng, double low, double high);
+bool RandomChanceFrom(randomADT rng, double p);
+
+/*
+ * Type: chanceT
+ * -------------
+ * A chanceT value holds a probability in a form that can be
+ * tested more quickly than a double.  Programs that test the
+ * same probability many times, such as simulations in which an
+ * event occurs with a fixed probability at each step, can
+ * convert the probability once with MakeChance and then use
+ * TestChance or RandomChanceMask.  The representation is given
+ * here only so that chanceT values can be declared as variables;
+ * clients should not use its field directly.
+ */
+
+typedef struct {
+    uint64_t threshold;
+} chanceT;
+
+/*
+ * Function: MakeChance
+ * Usage: chance = MakeChance(p);
+ * ------------------------------
+ * This function converts the probability p, which should be
+ * between 0 and 1, to a chanceT value.
+ */
+
+chanceT MakeChance(double p);
+
+/*
+ * Function: TestChance
+ * Usage: if (TestChance(rng, chance)) . . .
+ * -----------------------------------------
+ * This function returns TRUE with the probability represented
+ * by chance.  Given the same generator state, it returns the
+ * same result as RandomChanceFrom does for the original
+ * probability, but it needs only an integer comparison.
+ */
+
+bool TestChance(randomADT rng, chanceT chance);
+
+/*
+ * Function: RandomChanceMask
+ * Usage: mask = RandomChanceMask(rng, chance);
+ * --------------------------------------------
+ * This function performs 64 independent trials with the
+ * probability represented by chance and returns a word in which
+ * each bit is 1 if the corresponding trial succeeded.  It uses
+ * about eight values from the generator rather than 64.
+ */
+
+uint64_t RandomChanceMask(randomADT rng, chanceT chance);
+
+/*
+ * Functions: FillRandomIntegers, FillRandomReals
+ * Usage: FillRandomIntegers(rng, array, n, low, high);
+ *        FillRandomReals(rng, array, n, low, high);
+ * ----------------------------------------------------
+ * These functions fill the first n elements of the array with
+ * values chosen as RandomIntegerFrom and RandomRealFrom choose
+ * them.  They are much faster than calling those functions in a
+ * loop, because the generator runs in a tight loop of its own
+ * and the values are converted in batches by loops that the
+ * compiler can vectorize.  The values are not the same as those
+ * that repeated calls would produce from the same state.
+ */
+
+void FillRandomIntegers(randomADT rng, int array[], long n,
+                        int low, int high);
+void FillRandomReals(randomADT rng, double array[], long n,
+                     double low, double high);
+
+/* Section 3 -- Non-uniform distributions */
+
+/*
+ * Overview
+ * --------
+ * The functions in this section choose values from distributions
+ * other than the uniform distribution.  Each takes its values
+ * from the generator passed as its first argument; to use the
+ * default generator, pass DefaultRandom().
+ */
+
+/*
+ * Function: RandomNormal
+ * Usage: x = RandomNormal(rng, mean, stddev);
+ * -------------------------------------------
+ * This function returns a random real number from the normal
+ * (Gaussian) distribution with the given mean and standard
+ * deviation.
+ */
+
+double RandomNormal(randomADT rng, double mean, double stddev);
+
+/*
+ * Function: RandomExponential
+ * Usage: x = RandomExponential(rng, mean);
+ * ----------------------------------------
+ * This function returns a random real number from the
+ * exponential distribution with the given mean, such as the
+ * waiting time between events that occur at random at an
+ * average rate of 1/mean per unit time.
+ */
+
+double RandomExponential(randomADT rng, double mean);
+
+/*
+ * Function: RandomPoisson
+ * Usage: k = RandomPoisson(rng, mean);
+ * ------------------------------------
+ * This function returns a random integer from the Poisson
+ * distribution with the given mean, which is the number of
+ * events that occur in a unit of time when events occur at
+ * random at that average rate.
+ */
+
+long RandomPoisson(randomADT rng, double mean);
+
+/*
+ * Function: RandomBinomial
+ * Usage: k = RandomBinomial(rng, n, p);
+ * -------------------------------------
+ * This function returns a random integer from the binomial
+ * distribution, which is the number of successes in n
+ * independent trials that each succeed with probability p.
+ */
+
+long RandomBinomial(randomADT rng, long n, double p);
+
+/*
+ * Functions: FillRandomNormals, FillRandomExponentials
+ * Usage: FillRandomNormals(rng, array, n, mean, stddev);
+ *        FillRandomExponentials(rng, array, n, mean);
+ * ------------------------------------------------------
+ * These functions fill the first n elements of the array with
+ * values chosen as RandomNormal and RandomExponential choose
+ * them.  Like the other fill functions, they are faster than
+ * calling the corresponding function in a loop but do not
+ * produce the same values.
+ */
+
+void FillRandomNormals(randomADT rng, double array[], long n,
+                       double mean, double stddev);
+void FillRandomExponentials(randomADT rng, double array[], long n,
+                            double mean);
+
+/* Section 4 -- Shuffling and sampling */
+
+/*
+ * Function: ShuffleArray
+ * Usage: ShuffleArray(rng, array, n, sizeof array[0]);
+ * ----------------------------------------------------
+ * This function rearranges the first n elements of the array
+ * into a random order, in which every possible order is equally
+ * likely.  The last argument gives the size of each element in
+ * bytes, so that the function can shuffle arrays of any type.
+ */
+
+void ShuffleArray(randomADT rng, void *array, long n, size_t size);
+
+/*
+ * Function: SampleIndices
+ * Usage: SampleIndices(rng, result, k, n);
+ * ----------------------------------------
+ * This function chooses k distinct integers at random from the
+ * range 0 to n - 1 and stores them in the first k elements of
+ * result, in no particular order.  Every set of k integers is
+ * equally likely to be chosen.  The time and storage required
+ * are proportional to k rather than n, which makes the function
+ * suitable for choosing a small sample from a large array.
+ */
+
+void SampleIndices(randomADT rng, long result[], long k, long n);
+
+/*
+ * Type: reservoirADT
+ * ------------------
+ * A reservoir chooses a random sample of k items from a stream
+ * whose length is not known in advance, such as the lines of a
+ * file.  The client keeps the sample in an array of k elements
+ * and calls NextReservoirSlot once for each item of the stream.
+ * The result tells the client where to store the item: a value
+ * between 0 and k - 1 is the index of the element the item
+ * replaces, and -1 means that the item is not part of the
+ * sample.  At any point, the array holds a sample of the items
+ * seen so far, in which every set of k items is equally likely.
+ * Until k items have been seen, the sample holds all of them.
+ */
+
+typedef struct reservoirCDT *reservoirADT;
+
+/*
+ * Functions: NewReservoir, NextReservoirSlot, FreeReservoir
+ * Usage: reservoir = NewReservoir(rng, k);
+ *        slot = NextReservoirSlot(reservoir);
+ *        FreeReservoir(reservoir);
+ * ---------------------------------------------------------
+ * NewReservoir returns a reservoir for a sample of k items that
+ * takes its values from the generator rng.  NextReservoirSlot
+ * returns the slot for the next item of the stream, and
+ * FreeReservoir frees the reservoir, but not the generator.
+ * Most items are not selected, and the reservoir decides how
+ * many to skip at once, so the cost per item is very small.
+ */
+
+reservoirADT NewReservoir(randomADT rng, long k);
+long NextReservoirSlot(reservoirADT reservoir);
+void FreeReservoir(reservoirADT reservoir);
+
+/*
+ * Type: aliasADT
+ * --------------
+ * An alias table chooses integers from 0 to n - 1 with given
+ * relative weights, so that integer i is chosen with probability
+ * weights[i] divided by the sum of the weights.  Building the
+ * table takes time proportional to n, after which each choice
+ * takes constant time no matter how large n is.
+ */
+
+typedef struct aliasCDT *aliasADT;
+
+/*
+ * Functions: NewAliasTable, RandomAlias, FreeAliasTable
+ * Usage: table = NewAliasTable(weights, n);
+ *        i = RandomAlias(rng, table);
+ *        FreeAliasTable(table);
+ * -----------------------------------------------------
+ * NewAliasTable builds an alias table from the first n elements
+ * of the weights array, which must not be negative and must not
+ * all be zero.  RandomAlias chooses an integer from the table,
+ * and FreeAliasTable frees it.
+ */
+
+aliasADT NewAliasTable(double weights[], long n);
+long RandomAlias(randomADT rng, aliasADT table);
+void FreeAliasTable(aliasADT table);
+
 #endif
@@ -8,6 +8,20 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <limits.h>
+#include <math.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <zlib.h>
+#ifdef HAVE_ZSTD
+#  include <zstd.h>
+#endif
 
 #include "genlib.h"
 #include "strlib.h"
@@ -17,9 +31,285 @@
  * Constants:
  * ----------
  * InitialBufferSize -- Initial buffer size for ReadLine
+ * ReaderBufferSize  -- Initial buffer size for streaming readers
+ * MaxFastDigits     -- Most significant digits in a fast-path real
+ * MaxFastExponent   -- Largest power of ten represented exactly
+ * MaxNumberToken    -- Longest real copied into a local buffer
+ * MaxErrorToken     -- Most characters of a token shown in errors
+ * ParseChunkSize    -- Size of the pieces parsed by each thread
+ * WriterBufferSize  -- Size of the buffer used by a writer
+ * MaxFastPrecision  -- Most digits WriteReal formats directly
+ * FastRealLimit     -- Bound on scaled values WriteReal formats
+ * RoundingMargin    -- Closest approach to a tie WriteReal allows
+ * MaxNumberChars    -- Size of the local buffers used by writers
+ * RingSlots         -- Number of buffers in a ring
+ * RingSlotSize      -- Size of each buffer in the ring
+ * StopPollInterval  -- Milliseconds between checks for a stop request
  */
 
 #define InitialBufferSize 120
+#define ReaderBufferSize 65536
+#define MaxFastDigits 15
+#define MaxFastExponent 22
+#define MaxNumberToken 63
+#define MaxErrorToken 20
+#define ParseChunkSize (1 << 20)
+#define WriterBufferSize (1 << 20)
+#define MaxFastPrecision 9
+#define FastRealLimit 1e12
+#define RoundingMargin 1e-3
+#define MaxNumberChars 64
+#define RingSlots 4
+#define RingSlotSize (1 << 20)
+#define StopPollInterval 100
+
+/*
+ * Macros: IsBlank, IsDigit
+ * ------------------------
+ * These macros test for white space and decimal digits in the
+ * C locale.  They are used in place of the <ctype.h> functions
+ * in the number scanner, where they are faster.
+ */
+
+#define IsBlank(ch) ((ch) == ' ' || ((ch) >= '\t' && (ch) <= '\r'))
+#define IsDigit(ch) ((ch) >= '0' && (ch) <= '9')
+
+/*
+ * Type: compressionT
+ * ------------------
+ * This type identifies the compression format of an input file.
+ */
+
+typedef enum {
+    Uncompressed,
+    GzipCompressed,
+    ZstdCompressed
+} compressionT;
+
+/*
+ * Type: ringT
+ * -----------
+ * This type holds the state of a ring of buffers that is filled by
+ * a background thread and emptied by the thread that owns the
+ * reader.  The background thread either decompresses the input or,
+ * in prefetch mode, copies it from the file descriptor.  The full
+ * buffers run from head to tail, and count is the number of them;
+ * offset is the number of characters already taken from the buffer
+ * at head.  The producer sets done when it has no more data, and it
+ * sets problem if it stopped because of an error.  The consumer
+ * sets stop to ask the producer to quit early.  All of these fields
+ * are protected by the lock.  The remaining fields belong to the
+ * producer: the stream from which it reads, the compression format,
+ * and a buffer for compressed input, the first pendingInput
+ * characters of which were read by the reader before the format was
+ * detected.  The streamBuffered flag is TRUE while the stream may
+ * still hold characters that it read ahead for the reader.
+ */
+
+typedef struct {
+    char *slots[RingSlots];
+    size_t lengths[RingSlots];
+    int head, tail, count;
+    size_t offset;
+    bool done, stop;
+    string problem;
+    pthread_mutex_t lock;
+    pthread_cond_t notEmpty, notFull;
+    pthread_t thread;
+    FILE *infile;
+    compressionT format;
+    char *input;
+    size_t pendingInput;
+    bool streamBuffered;
+} ringT;
+
+/*
+ * Type: readerCDT
+ * ---------------
+ * This type is the concrete representation of a reader.  The
+ * unread characters always occupy the range from cp up to end.
+ * For a mapped file, the buffer is the mapping itself, which
+ * covers the entire file, and mapSize is its length.  For a
+ * streaming reader, mapSize is 0 and the buffer is a block of
+ * bufferSize characters that is refilled from infile or, if the
+ * input turns out to be compressed, from a ring of buffers that
+ * a background thread fills with decompressed data.  The
+ * detectCompression flag is TRUE until the first characters of
+ * a streaming reader have been examined.  The numberOnLine flag
+ * records whether a number has already been read from the
+ * current line, which is used to enforce the LineSeparated
+ * layout.
+ */
+
+struct readerCDT {
+    char *buffer;
+    char *cp;
+    char *end;
+    size_t bufferSize;
+    size_t mapSize;
+    FILE *infile;
+    ringT *ring;
+    bool ownsFile;
+    bool eof;
+    bool detectCompression;
+    long lineNumber;
+    numberLayoutT layout;
+    bool numberOnLine;
+};
+
+/*
+ * Type: writerCDT
+ * ---------------
+ * This type is the concrete representation of a writer.  The
+ * buffered characters occupy the range from buffer up to cp,
+ * and limit marks the end of the buffer.
+ */
+
+struct writerCDT {
+    char *buffer;
+    char *cp;
+    char *limit;
+    FILE *outfile;
+    bool ownsFile;
+};
+
+/*
+ * Type: parseModeT
+ * ----------------
+ * This type indicates what the parallel file readers do with
+ * each number they parse.
+ */
+
+typedef enum { ParseLongs, ParseReals, SummarizeReals } parseModeT;
+
+/*
+ * Type: chunkT
+ * ------------
+ * This type describes one of the pieces into which a file is
+ * divided for parallel parsing, which extends from start up to
+ * end.  When a thread parses the chunk, it stores the values in
+ * a dynamic array or reduces them into the summary field.  If
+ * an error occurs, the thread records the problem, the position
+ * and length of the bad token, and the line number relative to
+ * the start of the chunk.
+ */
+
+typedef struct {
+    char *start;
+    char *end;
+    size_t count;
+    void *values;
+    numberSummaryT summary;
+    string problem;
+    char *errorToken;
+    size_t errorLength;
+    long errorLine;
+} chunkT;
+
+/*
+ * Type: parseJobT
+ * ---------------
+ * This type holds the state shared by the threads that parse a
+ * file in parallel.  Each thread repeatedly claims the chunk
+ * whose index is nextChunk, which is protected by the lock.  If
+ * the file cannot be mapped, stream is the reader and there is
+ * only one chunk, which is parsed directly from that reader.
+ */
+
+typedef struct {
+    parseModeT mode;
+    readerADT stream;
+    chunkT *chunks;
+    int nChunks;
+    int nextChunk;
+    pthread_mutex_t lock;
+} parseJobT;
+
+/*
+ * Private variable: parseThreads
+ * ------------------------------
+ * This variable holds the value set by SetParseThreads.
+ */
+
+static int parseThreads = 0;
+
+/*
+ * Constant: powersOfTen
+ * ---------------------
+ * This table holds the powers of ten that can be represented
+ * exactly as a double, which are used by ParseReal.
+ */
+
+static double powersOfTen[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/*
+ * Constant: digitPairs
+ * --------------------
+ * This string holds the two-digit representations of the numbers
+ * from 0 to 99, which allows FormatUnsigned to produce two digits
+ * with each division.
+ */
+
+static char digitPairs[] =
+    "00010203040506070809101112131415161718192021222324"
+    "25262728293031323334353637383940414243444546474849"
+    "50515253545556575859606162636465666768697071727374"
+    "75767778798081828384858687888990919293949596979899";
+
+/* Private function prototypes */
+
+static bool MapReader(readerADT reader);
+static bool FillReader(readerADT reader);
+static size_t ReadSource(readerADT reader, char *dst, size_t max);
+static compressionT DetectCompression(char *cp, size_t n);
+static bool StartNumber(readerADT reader, string caller, size_t *np);
+static string ParseLong(char *token, size_t n, long *lp);
+static string ParseReal(char *token, size_t n, double *dp);
+static string ConvertReal(char *token, size_t n, double *dp);
+static void NumberError(readerADT reader, string caller, string problem,
+                        size_t n);
+static void ParseNumberFile(string filename, string caller,
+                            parseJobT *job);
+static void SplitIntoChunks(readerADT reader, parseJobT *job);
+static void *ParseWorker(void *arg);
+static void ParseChunk(parseJobT *job, chunkT *chunk);
+static void StoreValue(chunkT *chunk, size_t *capacityp, size_t size,
+                       void *vp);
+static void InitChunkReader(readerADT reader, char *start, char *end);
+static void ReportChunkError(readerADT reader, string caller,
+                             parseJobT *job, chunkT *chunk);
+static void FreeParseJob(parseJobT *job);
+static long CountLines(char *start, char *end);
+static void WriteChars(writerADT writer, char *chars, size_t n);
+static void WritePadded(writerADT writer, char *chars, size_t n,
+                        int width);
+static void WriteSlowReal(writerADT writer, double x, int width,
+                          int precision);
+static char *FormatUnsigned(char *end, unsigned long value);
+static void FlushBuffer(writerADT writer);
+static ringT *StartDecompression(FILE *infile, compressionT format,
+                                 char *input, size_t n);
+static ringT *NewRing(FILE *infile);
+static void StartRing(ringT *ring, void *(*worker)(void *));
+static void *PrefetchWorker(void *arg);
+static long ReadDescriptor(int fd, char *dst, size_t max);
+static bool InputReady(int fd);
+static bool WaitForInput(ringT *ring, int fd);
+static void *DecompressWorker(void *arg);
+static string InflateInput(ringT *ring);
+#ifdef HAVE_ZSTD
+static string ZstdInput(ringT *ring);
+#endif
+static long ReadCompressed(ringT *ring);
+static long DrainStream(FILE *infile, char *dst, size_t max);
+static char *GetFreeSlot(ringT *ring);
+static void PublishSlot(ringT *ring, size_t n);
+static void FinishRing(ringT *ring, string problem);
+static size_t ReadRing(ringT *ring, char *dst, size_t max);
+static void StopRing(ringT *ring);
 
 /* Exported entries */
 
@@ -124,39 +414,1813 @@ string GetLine(void)
 /*
  * Function: ReadLine
  * ------------------
- * This function operates by reading characters from the file
- * into a dynamically allocated buffer.  
+ * This function operates by reading the line in chunks with
+ * fgets, which copies characters out of the stdio buffer in
+ * bulk rather than one getc call at a time.  Staying within
+ * stdio keeps ReadLine compatible with any other input
+ * operations the client performs on the same file.
  * [We assume that none of the characters read is '\0'. (PF)]
- *                                       If the buffer becomes
- * full before the end of the line is reached, a new buffer
- * twice the size of the previous one is allocated.
+ *                                       The end of each chunk
+ * is located with memchr, which finds the null character that
+ * fgets writes after the data.  If the buffer becomes full
+ * before the end of the line is reached, a new buffer twice
+ * the size of the previous one is allocated.  The buffer is
+ * returned directly rather than being copied once more into a
+ * block of the exact size; any unused space at the end of the
+ * buffer is reclaimed when the client calls FreeBlock.
  */
 
 string ReadLine(FILE *infile)
 {
-    string line, nline;
-    int n, ch, size;
+    string line, nline, end;
+    int n, size;
 
     n = 0;
     size = InitialBufferSize;
     line = GetBlock(size + 1);
-    while ((ch = getc(infile)) != '\n' && ch != EOF) {
+    while (fgets(line + n, size + 1 - n, infile) != NULL) {
+        end = memchr(line + n, '\0', size + 1 - n);
+        n = end - line;
+        if (n > 0 && line[n - 1] == '\n') {
+            line[--n] = '\0';
+            return (line);
+        }
         if (n == size) {
             size *= 2;
             nline = (string) GetBlock(size + 1);
-            strncpy(nline, line, n);
+            memcpy(nline, line, n);
             FreeBlock(line);
             line = nline;
         }
-        line[n++] = ch;
     }
-    if (n == 0 && ch == EOF) {
+    if (n == 0) {
         FreeBlock(line);
         return (NULL);
     }
     line[n] = '\0';
-    nline = (string) GetBlock(n + 1);
-    strcpy(nline, line);
-    FreeBlock(line);
-    return (nline);
+    return (line);
+}
+
+/*
+ * Function: OpenReader
+ * --------------------
+ * This function opens the file with fopen and then uses
+ * NewReader to do the rest of the work.
+ */
+
+readerADT OpenReader(string filename)
+{
+    FILE *infile;
+    readerADT reader;
+
+    infile = fopen(filename, "r");
+    if (infile == NULL) return (NULL);
+    reader = NewReader(infile);
+    reader->ownsFile = TRUE;
+    return (reader);
+}
+
+/*
+ * Function: NewReader
+ * -------------------
+ * This function first tries to map the file into memory.  If
+ * that fails, because the file is not a regular file or because
+ * the address space is too small to hold it, the reader streams
+ * the file instead.  A compressed file is also streamed, since
+ * the mapping would contain only the compressed data.  Because
+ * mapping the file does not change the position of the stream,
+ * the reader can simply discard the mapping in that case.
+ */
+
+readerADT NewReader(FILE *infile)
+{
+    readerADT reader;
+
+    reader = New(readerADT);
+    reader->infile = infile;
+    reader->ring = NULL;
+    reader->ownsFile = FALSE;
+    reader->eof = FALSE;
+    reader->detectCompression = TRUE;
+    reader->mapSize = 0;
+    reader->lineNumber = 1;
+    reader->layout = WhitespaceSeparated;
+    reader->numberOnLine = FALSE;
+    if (MapReader(reader)) {
+        if (DetectCompression(reader->cp, reader->end - reader->cp)
+              == Uncompressed) {
+            return (reader);
+        }
+        munmap(reader->buffer, reader->mapSize);
+        reader->mapSize = 0;
+        reader->eof = FALSE;
+    }
+    reader->bufferSize = ReaderBufferSize;
+    reader->buffer = GetBlock(reader->bufferSize);
+    reader->cp = reader->end = reader->buffer;
+    return (reader);
+}
+
+/*
+ * Function: EnablePrefetch
+ * ------------------------
+ * Prefetching replaces the first read from the stream, so the
+ * prefetch thread takes over the detection of compressed input.
+ */
+
+void EnablePrefetch(readerADT reader)
+{
+    if (reader->mapSize != 0) return;
+    if (reader->ring != NULL || !reader->detectCompression
+          || reader->end != reader->buffer) {
+        Error("EnablePrefetch: reader has already been used");
+    }
+    reader->detectCompression = FALSE;
+    reader->ring = NewRing(reader->infile);
+    StartRing(reader->ring, PrefetchWorker);
+}
+
+/*
+ * Function: ReadLineView
+ * ----------------------
+ * This function searches for the newline with memchr.  If the
+ * unread characters do not contain a newline, the function
+ * refills the buffer and continues the search from the point at
+ * which it left off.  A final line that is not terminated by a
+ * newline is returned as if it were.
+ */
+
+bool ReadLineView(readerADT reader, lineViewT *view)
+{
+    char *nl;
+    size_t scanned;
+
+    scanned = 0;
+    while (TRUE) {
+        nl = memchr(reader->cp + scanned, '\n',
+                    reader->end - reader->cp - scanned);
+        if (nl != NULL) break;
+        scanned = reader->end - reader->cp;
+        if (!FillReader(reader)) {
+            if (reader->cp == reader->end) return (FALSE);
+            nl = reader->end;
+            break;
+        }
+    }
+    view->start = reader->cp;
+    view->length = nl - reader->cp;
+    if (nl == reader->end) {
+        reader->cp = nl;
+    } else {
+        reader->cp = nl + 1;
+        reader->lineNumber++;
+    }
+    reader->numberOnLine = FALSE;
+    return (TRUE);
+}
+
+void SetNumberLayout(readerADT reader, numberLayoutT layout)
+{
+    reader->layout = layout;
+}
+
+/*
+ * Functions: ReadInteger, ReadLong, ReadReal
+ * ------------------------------------------
+ * Each of these functions first calls StartNumber to skip white
+ * space and to make sure that the entire token is present in the
+ * buffer.  The token is then converted by a parser that works
+ * directly on the characters in the buffer.  The parsers do not
+ * call Error themselves but instead return a description of the
+ * problem, so that they can also be used by worker threads.
+ * ReadInteger uses the same parser as ReadLong and then checks
+ * that the result fits in an int.
+ */
+
+bool ReadInteger(readerADT reader, int *ip)
+{
+    size_t n;
+    long value;
+    string problem;
+
+    if (!StartNumber(reader, "ReadInteger", &n)) return (FALSE);
+    problem = ParseLong(reader->cp, n, &value);
+    if (problem == NULL && (value < INT_MIN || value > INT_MAX)) {
+        problem = "number out of range";
+    }
+    if (problem != NULL) NumberError(reader, "ReadInteger", problem, n);
+    *ip = (int) value;
+    reader->cp += n;
+    return (TRUE);
+}
+
+bool ReadLong(readerADT reader, long *lp)
+{
+    size_t n;
+    string problem;
+
+    if (!StartNumber(reader, "ReadLong", &n)) return (FALSE);
+    problem = ParseLong(reader->cp, n, lp);
+    if (problem != NULL) NumberError(reader, "ReadLong", problem, n);
+    reader->cp += n;
+    return (TRUE);
+}
+
+bool ReadReal(readerADT reader, double *dp)
+{
+    size_t n;
+    string problem;
+
+    if (!StartNumber(reader, "ReadReal", &n)) return (FALSE);
+    problem = ParseReal(reader->cp, n, dp);
+    if (problem != NULL) NumberError(reader, "ReadReal", problem, n);
+    reader->cp += n;
+    return (TRUE);
+}
+
+bool ViewToLong(lineViewT view, long *lp)
+{
+    if (view.length == 0) return (FALSE);
+    return (ParseLong(view.start, view.length, lp) == NULL);
+}
+
+bool ViewToReal(lineViewT view, double *dp)
+{
+    if (view.length == 0 || IsBlank(view.start[0])) return (FALSE);
+    return (ParseReal(view.start, view.length, dp) == NULL);
+}
+
+long ReaderLineNumber(readerADT reader)
+{
+    return (reader->lineNumber);
+}
+
+/*
+ * Functions: ReadLongFile, ReadRealFile, SummarizeRealFile
+ * --------------------------------------------------------
+ * These functions use ParseNumberFile to parse the chunks of the
+ * file and then combine the results from each chunk in order.
+ */
+
+long *ReadLongFile(string filename, long *np)
+{
+    parseJobT job;
+    long *array;
+    size_t n;
+    int i;
+
+    job.mode = ParseLongs;
+    ParseNumberFile(filename, "ReadLongFile", &job);
+    n = 0;
+    for (i = 0; i < job.nChunks; i++) n += job.chunks[i].count;
+    array = NewArray(n + 1, long);
+    n = 0;
+    for (i = 0; i < job.nChunks; i++) {
+        memcpy(array + n, job.chunks[i].values,
+               job.chunks[i].count * sizeof (long));
+        n += job.chunks[i].count;
+    }
+    FreeParseJob(&job);
+    *np = n;
+    return (array);
+}
+
+double *ReadRealFile(string filename, long *np)
+{
+    parseJobT job;
+    double *array;
+    size_t n;
+    int i;
+
+    job.mode = ParseReals;
+    ParseNumberFile(filename, "ReadRealFile", &job);
+    n = 0;
+    for (i = 0; i < job.nChunks; i++) n += job.chunks[i].count;
+    array = NewArray(n + 1, double);
+    n = 0;
+    for (i = 0; i < job.nChunks; i++) {
+        memcpy(array + n, job.chunks[i].values,
+               job.chunks[i].count * sizeof (double));
+        n += job.chunks[i].count;
+    }
+    FreeParseJob(&job);
+    *np = n;
+    return (array);
+}
+
+numberSummaryT SummarizeRealFile(string filename)
+{
+    parseJobT job;
+    numberSummaryT result, *sp;
+    int i;
+
+    job.mode = SummarizeReals;
+    ParseNumberFile(filename, "SummarizeRealFile", &job);
+    result.count = 0;
+    result.sum = result.min = result.max = 0;
+    for (i = 0; i < job.nChunks; i++) {
+        sp = &job.chunks[i].summary;
+        if (sp->count == 0) continue;
+        if (result.count == 0 || sp->min < result.min) result.min = sp->min;
+        if (result.count == 0 || sp->max > result.max) result.max = sp->max;
+        result.count += sp->count;
+        result.sum += sp->sum;
+    }
+    FreeParseJob(&job);
+    return (result);
+}
+
+void SetParseThreads(int n)
+{
+    parseThreads = n;
+}
+
+void CloseReader(readerADT reader)
+{
+    if (reader->ring != NULL) StopRing(reader->ring);
+    if (reader->mapSize != 0) {
+        munmap(reader->buffer, reader->mapSize);
+    } else {
+        FreeBlock(reader->buffer);
+    }
+    if (reader->ownsFile) fclose(reader->infile);
+    FreeBlock(reader);
+}
+
+/*
+ * Function: OpenWriter
+ * --------------------
+ * This function opens the file with fopen and then uses
+ * NewWriter to do the rest of the work.
+ */
+
+writerADT OpenWriter(string filename)
+{
+    FILE *outfile;
+    writerADT writer;
+
+    outfile = fopen(filename, "w");
+    if (outfile == NULL) return (NULL);
+    writer = NewWriter(outfile);
+    writer->ownsFile = TRUE;
+    return (writer);
+}
+
+writerADT NewWriter(FILE *outfile)
+{
+    writerADT writer;
+
+    writer = New(writerADT);
+    writer->buffer = writer->cp = GetBlock(WriterBufferSize);
+    writer->limit = writer->buffer + WriterBufferSize;
+    writer->outfile = outfile;
+    writer->ownsFile = FALSE;
+    return (writer);
+}
+
+void WriteString(writerADT writer, string s)
+{
+    WriteChars(writer, s, strlen(s));
+}
+
+void WriteChar(writerADT writer, char ch)
+{
+    if (writer->cp == writer->limit) FlushBuffer(writer);
+    *writer->cp++ = ch;
+}
+
+/*
+ * Function: WriteInteger
+ * ----------------------
+ * This function converts the magnitude of n to an unsigned long
+ * before formatting it, which avoids overflow when n is the most
+ * negative long.
+ */
+
+void WriteInteger(writerADT writer, long n, int width)
+{
+    char buffer[MaxNumberChars];
+    char *start, *end;
+
+    end = buffer + MaxNumberChars;
+    if (n < 0) {
+        start = FormatUnsigned(end, - (unsigned long) n);
+        *--start = '-';
+    } else {
+        start = FormatUnsigned(end, (unsigned long) n);
+    }
+    WritePadded(writer, start, end - start, width);
+}
+
+/*
+ * Function: WriteReal
+ * -------------------
+ * This function scales the magnitude of x by 10 to the power
+ * precision and rounds the result to an integer, whose digits
+ * are then formatted with a decimal point inserted.  Because
+ * the power of ten is exact, the scaled value differs from the
+ * exact product by less than half a unit in its last place,
+ * which is far smaller than RoundingMargin as long as the value
+ * is below FastRealLimit.  The rounding therefore agrees with
+ * printf unless the scaled value lies almost exactly halfway
+ * between two integers.  That case, along with large values,
+ * high precision, infinity, and NaN, is handed to WriteSlowReal,
+ * which calls snprintf.
+ */
+
+void WriteReal(writerADT writer, double x, int width, int precision)
+{
+    char buffer[MaxNumberChars];
+    char *start, *end;
+    double scaled, fraction;
+    unsigned long units, scale, fracPart;
+    int i;
+
+    if (precision < 0 || precision > MaxFastPrecision) {
+        WriteSlowReal(writer, x, width, precision);
+        return;
+    }
+    scaled = fabs(x) * powersOfTen[precision];
+    if (!(scaled < FastRealLimit && scaled < (double) ULONG_MAX)) {
+        WriteSlowReal(writer, x, width, precision);
+        return;
+    }
+    fraction = scaled - floor(scaled);
+    if (fabs(fraction - 0.5) < RoundingMargin) {
+        WriteSlowReal(writer, x, width, precision);
+        return;
+    }
+    units = (unsigned long) floor(scaled + 0.5);
+    scale = (unsigned long) powersOfTen[precision];
+    end = buffer + MaxNumberChars;
+    start = end;
+    if (precision > 0) {
+        fracPart = units % scale;
+        for (i = 0; i < precision; i++) {
+            *--start = '0' + fracPart % 10;
+            fracPart /= 10;
+        }
+        *--start = '.';
+    }
+    start = FormatUnsigned(start, units / scale);
+    if (signbit(x)) *--start = '-';
+    WritePadded(writer, start, end - start, width);
+}
+
+void FlushWriter(writerADT writer)
+{
+    FlushBuffer(writer);
+    fflush(writer->outfile);
+}
+
+void CloseWriter(writerADT writer)
+{
+    FlushWriter(writer);
+    if (writer->ownsFile) fclose(writer->outfile);
+    FreeBlock(writer->buffer);
+    FreeBlock(writer);
+}
+
+/* Private functions */
+
+/*
+ * Function: MapReader
+ * Usage: if (MapReader(reader)) . . .
+ * -----------------------------------
+ * This function maps the file underlying the reader into memory
+ * and returns TRUE if it succeeds.  The mapping always begins at
+ * the start of the file, since mmap requires an offset that is
+ * a multiple of the page size, and the cp pointer is then
+ * advanced to the current position of the stream as reported by
+ * ftell, which accounts for any characters already consumed
+ * through stdio.  The madvise call tells the kernel that the
+ * mapping will be read sequentially, so that it reads ahead
+ * aggressively and can reclaim pages soon after they are used.
+ */
+
+static bool MapReader(readerADT reader)
+{
+    struct stat sb;
+    long pos;
+    void *map;
+
+    if (fstat(fileno(reader->infile), &sb) != 0) return (FALSE);
+    if (!S_ISREG(sb.st_mode) || sb.st_size == 0) return (FALSE);
+    if ((off_t) (size_t) sb.st_size != sb.st_size) return (FALSE);
+    pos = ftell(reader->infile);
+    if (pos < 0 || pos > sb.st_size) return (FALSE);
+    map = mmap(NULL, sb.st_size, PROT_READ, MAP_PRIVATE,
+               fileno(reader->infile), 0);
+    if (map == MAP_FAILED) return (FALSE);
+    (void) madvise(map, sb.st_size, MADV_SEQUENTIAL);
+    reader->mapSize = sb.st_size;
+    reader->buffer = map;
+    reader->cp = reader->buffer + pos;
+    reader->end = reader->buffer + reader->mapSize;
+    reader->eof = TRUE;
+    return (TRUE);
+}
+
+/*
+ * Function: FillReader
+ * Usage: if (FillReader(reader)) . . .
+ * ------------------------------------
+ * This function reads more characters into the buffer of a
+ * streaming reader and returns TRUE if any were read.  The
+ * unread characters are first moved to the beginning of the
+ * buffer, and the buffer is doubled in size if it is already
+ * full.  Clients that hold pointers into the buffer must
+ * therefore express them relative to cp, which is the only
+ * pointer that remains meaningful after a call to FillReader.
+ * For a mapped reader, the entire file is already in memory,
+ * and FillReader always returns FALSE.
+ */
+
+static bool FillReader(readerADT reader)
+{
+    size_t nchars, nread;
+    char *nbuffer;
+
+    if (reader->eof) return (FALSE);
+    nchars = reader->end - reader->cp;
+    if (nchars == reader->bufferSize) {
+        reader->bufferSize *= 2;
+        nbuffer = GetBlock(reader->bufferSize);
+        memcpy(nbuffer, reader->cp, nchars);
+        FreeBlock(reader->buffer);
+        reader->buffer = nbuffer;
+    } else if (reader->cp != reader->buffer) {
+        memmove(reader->buffer, reader->cp, nchars);
+    }
+    reader->cp = reader->buffer;
+    reader->end = reader->buffer + nchars;
+    nread = ReadSource(reader, reader->end, reader->bufferSize - nchars);
+    if (nread == 0) {
+        reader->eof = TRUE;
+        return (FALSE);
+    }
+    reader->end += nread;
+    return (TRUE);
+}
+
+/*
+ * Function: ReadSource
+ * Usage: nread = ReadSource(reader, dst, max);
+ * --------------------------------------------
+ * This function reads up to max characters of input into dst
+ * and returns the number of characters read, which is 0 only
+ * at the end of the file.  The first time it is called for a
+ * reader, it checks whether the characters begin with the
+ * signature of a compressed format.  If they do, it passes
+ * those characters to a decompression thread and from then on
+ * takes its input from the ring that thread fills.
+ */
+
+static size_t ReadSource(readerADT reader, char *dst, size_t max)
+{
+    size_t nread;
+    compressionT format;
+
+    if (reader->ring != NULL) return (ReadRing(reader->ring, dst, max));
+    nread = fread(dst, 1, max, reader->infile);
+    if (reader->detectCompression) {
+        reader->detectCompression = FALSE;
+        format = DetectCompression(dst, nread);
+        if (format != Uncompressed) {
+            reader->ring = StartDecompression(reader->infile, format,
+                                              dst, nread);
+            return (ReadRing(reader->ring, dst, max));
+        }
+    }
+    return (nread);
+}
+
+/*
+ * Function: DetectCompression
+ * Usage: format = DetectCompression(cp, n);
+ * -----------------------------------------
+ * This function examines the first n characters of a file and
+ * returns its compression format, which is identified by the
+ * magic number at the beginning of the file.
+ */
+
+static compressionT DetectCompression(char *cp, size_t n)
+{
+    unsigned char *up;
+
+    up = (unsigned char *) cp;
+    if (n >= 2 && up[0] == 0x1f && up[1] == 0x8b) return (GzipCompressed);
+    if (n >= 4 && up[0] == 0x28 && up[1] == 0xb5 && up[2] == 0x2f
+          && up[3] == 0xfd) {
+        return (ZstdCompressed);
+    }
+    return (Uncompressed);
+}
+
+/*
+ * Function: StartNumber
+ * Usage: if (StartNumber(reader, caller, &n)) . . .
+ * -------------------------------------------------
+ * This function skips over white space, counting newlines as it
+ * goes, and then finds the length of the token that follows,
+ * refilling the buffer as necessary so that the entire token is
+ * present.  On return, the token begins at reader->cp and its
+ * length is stored in *np.  The function returns FALSE if the
+ * end of the file is reached before a token is found.  Because
+ * FillReader moves the characters in the buffer, all positions
+ * are kept as offsets from reader->cp.
+ */
+
+static bool StartNumber(readerADT reader, string caller, size_t *np)
+{
+    size_t n, avail;
+
+    while (TRUE) {
+        while (reader->cp < reader->end && IsBlank(*reader->cp)) {
+            if (*reader->cp == '\n') {
+                reader->lineNumber++;
+                reader->numberOnLine = FALSE;
+            }
+            reader->cp++;
+        }
+        if (reader->cp < reader->end) break;
+        if (!FillReader(reader)) return (FALSE);
+    }
+    n = 0;
+    while (TRUE) {
+        avail = reader->end - reader->cp;
+        while (n < avail && !IsBlank(reader->cp[n])) n++;
+        if (n < avail || !FillReader(reader)) break;
+    }
+    if (reader->numberOnLine && reader->layout == LineSeparated) {
+        NumberError(reader, caller, "more than one number on line", n);
+    }
+    reader->numberOnLine = TRUE;
+    *np = n;
+    return (TRUE);
+}
+
+/*
+ * Function: ParseLong
+ * Usage: problem = ParseLong(token, n, &value);
+ * ---------------------------------------------
+ * This function converts the n-character token, which consists
+ * of an optional sign followed by decimal digits, to a long and
+ * stores the result in *lp.  The value is accumulated as an
+ * unsigned long so that overflow can be detected before it
+ * occurs.  The function returns NULL if the conversion succeeds
+ * and a description of the problem if it does not.
+ */
+
+static string ParseLong(char *token, size_t n, long *lp)
+{
+    char *cp, *end;
+    unsigned long value, limit;
+    int digit;
+    bool negative;
+
+    cp = token;
+    end = cp + n;
+    negative = FALSE;
+    if (*cp == '+' || *cp == '-') negative = (*cp++ == '-');
+    if (cp == end || !IsDigit(*cp)) return ("expected an integer");
+    limit = (negative) ? (unsigned long) LONG_MAX + 1 : LONG_MAX;
+    value = 0;
+    while (cp < end && IsDigit(*cp)) {
+        digit = *cp++ - '0';
+        if (value > (limit - digit) / 10) return ("number out of range");
+        value = value * 10 + digit;
+    }
+    if (cp != end) return ("unexpected character");
+    if (negative) {
+        *lp = (value == limit) ? LONG_MIN : -(long) value;
+    } else {
+        *lp = (long) value;
+    }
+    return (NULL);
+}
+
+/*
+ * Function: ParseReal
+ * Usage: problem = ParseReal(token, n, &value);
+ * ---------------------------------------------
+ * This function converts the n-character token to a double and
+ * stores the result in *dp, returning NULL or a description of
+ * the problem as ParseLong does.  The common case of a number
+ * with at most MaxFastDigits significant digits and a small
+ * exponent is handled directly: the digits form an integer that
+ * is exactly representable as a double, and multiplying or
+ * dividing it by an exactly representable power of ten gives a
+ * correctly rounded result.  Any other token, including one that
+ * is not a legal number, is passed to ConvertReal, which uses
+ * strtod.
+ */
+
+static string ParseReal(char *token, size_t n, double *dp)
+{
+    char *cp, *end;
+    double mantissa;
+    int ndigits, exponent, expValue;
+    bool negative, expNegative, sawDigit;
+
+    cp = token;
+    end = cp + n;
+    negative = FALSE;
+    if (*cp == '+' || *cp == '-') negative = (*cp++ == '-');
+    mantissa = 0;
+    ndigits = exponent = 0;
+    sawDigit = FALSE;
+    while (cp < end && IsDigit(*cp)) {
+        if (mantissa != 0 || *cp != '0') ndigits++;
+        mantissa = mantissa * 10 + (*cp++ - '0');
+        sawDigit = TRUE;
+    }
+    if (cp < end && *cp == '.') {
+        cp++;
+        while (cp < end && IsDigit(*cp)) {
+            if (mantissa != 0 || *cp != '0') ndigits++;
+            mantissa = mantissa * 10 + (*cp++ - '0');
+            exponent--;
+            sawDigit = TRUE;
+        }
+    }
+    if (!sawDigit || ndigits > MaxFastDigits) {
+        return (ConvertReal(token, n, dp));
+    }
+    if (cp < end && (*cp == 'e' || *cp == 'E')) {
+        cp++;
+        expNegative = FALSE;
+        if (cp < end && (*cp == '+' || *cp == '-')) {
+            expNegative = (*cp++ == '-');
+        }
+        if (cp == end) return (ConvertReal(token, n, dp));
+        expValue = 0;
+        while (cp < end && IsDigit(*cp) && expValue <= MaxFastExponent) {
+            expValue = expValue * 10 + (*cp++ - '0');
+        }
+        exponent += (expNegative) ? -expValue : expValue;
+    }
+    if (cp != end) return (ConvertReal(token, n, dp));
+    if (exponent < -MaxFastExponent || exponent > MaxFastExponent) {
+        return (ConvertReal(token, n, dp));
+    }
+    if (exponent < 0) {
+        mantissa /= powersOfTen[-exponent];
+    } else {
+        mantissa *= powersOfTen[exponent];
+    }
+    *dp = (negative) ? -mantissa : mantissa;
+    return (NULL);
+}
+
+/*
+ * Function: ConvertReal
+ * Usage: problem = ConvertReal(token, n, &value);
+ * -----------------------------------------------
+ * This function converts the n-character token using strtod,
+ * which accepts the same syntax as the %lf format used by
+ * GetReal.  The token is not null-terminated in the buffer, so
+ * it must first be copied.
+ */
+
+static string ConvertReal(char *token, size_t n, double *dp)
+{
+    char localBuffer[MaxNumberToken + 1];
+    char *copy, *endptr;
+    size_t nparsed;
+
+    copy = (n <= MaxNumberToken) ? localBuffer : GetBlock(n + 1);
+    memcpy(copy, token, n);
+    copy[n] = '\0';
+    *dp = strtod(copy, &endptr);
+    nparsed = endptr - copy;
+    if (copy != localBuffer) FreeBlock(copy);
+    if (nparsed == 0) return ("expected a real number");
+    if (nparsed != n) return ("unexpected character");
+    return (NULL);
+}
+
+/*
+ * Function: NumberError
+ * Usage: NumberError(reader, caller, problem, n);
+ * -----------------------------------------------
+ * This function reports an error in the n-character token at
+ * reader->cp.  Long tokens are truncated in the message.
+ */
+
+static void NumberError(readerADT reader, string caller, string problem,
+                        size_t n)
+{
+    char token[MaxErrorToken + 1];
+
+    if (n > MaxErrorToken) n = MaxErrorToken;
+    memcpy(token, reader->cp, n);
+    token[n] = '\0';
+    Error("%s: line %ld: %s in \"%s\"", caller, reader->lineNumber,
+          problem, token);
+}
+
+/*
+ * Function: ParseNumberFile
+ * Usage: ParseNumberFile(filename, caller, &job);
+ * -----------------------------------------------
+ * This function opens the file, divides it into chunks, and
+ * parses the chunks using a pool of threads.  The calling
+ * thread is one member of the pool.  When the function returns,
+ * each chunk holds its results.  If any chunk contains an
+ * error, the first such error in the file is reported; the
+ * worker threads never call Error themselves, because the
+ * exception handlers belong to the calling thread.
+ */
+
+static void ParseNumberFile(string filename, string caller,
+                            parseJobT *job)
+{
+    readerADT reader;
+    pthread_t *threads;
+    int i, nThreads, nStarted;
+
+    reader = OpenReader(filename);
+    if (reader == NULL) Error("%s: can't open %s", caller, filename);
+    SplitIntoChunks(reader, job);
+    nThreads = parseThreads;
+    if (nThreads <= 0) nThreads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+    if (nThreads > job->nChunks) nThreads = job->nChunks;
+    job->nextChunk = 0;
+    pthread_mutex_init(&job->lock, NULL);
+    threads = NULL;
+    nStarted = 0;
+    if (nThreads > 1) {
+        threads = NewArray(nThreads - 1, pthread_t);
+        while (nStarted < nThreads - 1) {
+            if (pthread_create(&threads[nStarted], NULL, ParseWorker,
+                               job) != 0) break;
+            nStarted++;
+        }
+    }
+    (void) ParseWorker(job);
+    for (i = 0; i < nStarted; i++) pthread_join(threads[i], NULL);
+    if (threads != NULL) FreeBlock(threads);
+    pthread_mutex_destroy(&job->lock);
+    for (i = 0; i < job->nChunks; i++) {
+        if (job->chunks[i].problem != NULL) {
+            ReportChunkError(reader, caller, job, &job->chunks[i]);
+        }
+    }
+    CloseReader(reader);
+}
+
+/*
+ * Function: SplitIntoChunks
+ * Usage: SplitIntoChunks(reader, job);
+ * ------------------------------------
+ * This function divides the unread part of a mapped file into
+ * chunks of roughly ParseChunkSize characters, moving each
+ * boundary forward to just past the next newline so that no
+ * number is split between two chunks.  The chunks are smaller
+ * than the share of any one thread so that the load remains
+ * balanced when some chunks take longer than others.  A reader
+ * that is not mapped forms a single chunk.
+ */
+
+static void SplitIntoChunks(readerADT reader, parseJobT *job)
+{
+    char *cp, *next;
+    size_t total;
+    int i;
+
+    total = reader->end - reader->cp;
+    job->stream = (reader->mapSize == 0) ? reader : NULL;
+    job->nChunks = (job->stream == NULL) ? total / ParseChunkSize + 1 : 1;
+    job->chunks = NewArray(job->nChunks, chunkT);
+    cp = reader->cp;
+    for (i = 0; i < job->nChunks; i++) {
+        job->chunks[i].start = cp;
+        if (i == job->nChunks - 1) {
+            cp = reader->end;
+        } else if (cp + ParseChunkSize < reader->end) {
+            next = memchr(cp + ParseChunkSize, '\n',
+                          reader->end - cp - ParseChunkSize);
+            cp = (next == NULL) ? reader->end : next + 1;
+        } else {
+            cp = reader->end;
+        }
+        job->chunks[i].end = cp;
+        job->chunks[i].values = NULL;
+    }
+}
+
+/*
+ * Function: ParseWorker
+ * Usage: pthread_create(&thread, NULL, ParseWorker, job);
+ * -------------------------------------------------------
+ * This function is the body of each thread in the pool.  It
+ * claims unparsed chunks one at a time until none remain.
+ */
+
+static void *ParseWorker(void *arg)
+{
+    parseJobT *job;
+    int index;
+
+    job = (parseJobT *) arg;
+    while (TRUE) {
+        pthread_mutex_lock(&job->lock);
+        index = job->nextChunk++;
+        pthread_mutex_unlock(&job->lock);
+        if (index >= job->nChunks) break;
+        ParseChunk(job, &job->chunks[index]);
+    }
+    return (NULL);
+}
+
+/*
+ * Function: ParseChunk
+ * Usage: ParseChunk(job, chunk);
+ * ------------------------------
+ * This function parses the numbers in a single chunk using a
+ * private reader that covers only the characters in the chunk.
+ * Parsing stops at the first error, which is recorded in the
+ * chunk so that it can be reported by the calling thread.
+ */
+
+static void ParseChunk(parseJobT *job, chunkT *chunk)
+{
+    struct readerCDT chunkReader;
+    readerADT reader;
+    numberSummaryT *sp;
+    size_t n, capacity;
+    long lvalue;
+    double dvalue;
+    string problem;
+
+    if (job->stream == NULL) {
+        reader = &chunkReader;
+        InitChunkReader(reader, chunk->start, chunk->end);
+    } else {
+        reader = job->stream;
+    }
+    sp = &chunk->summary;
+    sp->count = 0;
+    sp->sum = sp->min = sp->max = 0;
+    chunk->count = 0;
+    chunk->problem = NULL;
+    capacity = 0;
+    while (StartNumber(reader, NULL, &n)) {
+        if (job->mode == ParseLongs) {
+            problem = ParseLong(reader->cp, n, &lvalue);
+        } else {
+            problem = ParseReal(reader->cp, n, &dvalue);
+        }
+        if (problem != NULL) {
+            chunk->problem = problem;
+            chunk->errorToken = reader->cp;
+            chunk->errorLength = n;
+            chunk->errorLine = reader->lineNumber;
+            return;
+        }
+        reader->cp += n;
+        switch (job->mode) {
+          case ParseLongs:
+            StoreValue(chunk, &capacity, sizeof lvalue, &lvalue);
+            break;
+          case ParseReals:
+            StoreValue(chunk, &capacity, sizeof dvalue, &dvalue);
+            break;
+          case SummarizeReals:
+            if (sp->count == 0 || dvalue < sp->min) sp->min = dvalue;
+            if (sp->count == 0 || dvalue > sp->max) sp->max = dvalue;
+            sp->sum += dvalue;
+            sp->count++;
+            break;
+        }
+    }
+}
+
+/*
+ * Function: StoreValue
+ * Usage: StoreValue(chunk, &capacity, size, &value);
+ * --------------------------------------------------
+ * This function appends the value of the given size to the
+ * dynamic array in the chunk, doubling the array when it
+ * becomes full.  The initial capacity is an estimate based on
+ * the number of characters in the chunk.
+ */
+
+static void StoreValue(chunkT *chunk, size_t *capacityp, size_t size,
+                       void *vp)
+{
+    char *nvalues;
+    size_t capacity;
+
+    capacity = *capacityp;
+    if (chunk->count == capacity) {
+        if (capacity == 0) {
+            capacity = (chunk->end - chunk->start) / 8 + 16;
+        } else {
+            capacity *= 2;
+        }
+        nvalues = GetBlock(capacity * size);
+        if (chunk->values != NULL) {
+            memcpy(nvalues, chunk->values, chunk->count * size);
+            FreeBlock(chunk->values);
+        }
+        chunk->values = nvalues;
+        *capacityp = capacity;
+    }
+    memcpy((char *) chunk->values + chunk->count * size, vp, size);
+    chunk->count++;
+}
+
+/*
+ * Function: InitChunkReader
+ * Usage: InitChunkReader(reader, start, end);
+ * -------------------------------------------
+ * This function initializes a reader allocated by the caller so
+ * that it reads the characters from start up to end.  The reader
+ * is marked as being at the end of the file, so that it never
+ * tries to refill its buffer.
+ */
+
+static void InitChunkReader(readerADT reader, char *start, char *end)
+{
+    reader->buffer = reader->cp = start;
+    reader->end = end;
+    reader->bufferSize = reader->mapSize = 0;
+    reader->infile = NULL;
+    reader->ring = NULL;
+    reader->ownsFile = FALSE;
+    reader->eof = TRUE;
+    reader->detectCompression = FALSE;
+    reader->lineNumber = 1;
+    reader->layout = WhitespaceSeparated;
+    reader->numberOnLine = FALSE;
+}
+
+/*
+ * Function: ReportChunkError
+ * Usage: ReportChunkError(reader, caller, job, chunk);
+ * ----------------------------------------------------
+ * This function reports the error recorded in the chunk.  The
+ * line number is converted from one relative to the chunk to
+ * one relative to the file by counting the newlines that come
+ * before the chunk.  The bad token is copied before the file is
+ * closed and the chunks are freed, after which NumberError is
+ * called on a reader that holds the copy.
+ */
+
+static void ReportChunkError(readerADT reader, string caller,
+                             parseJobT *job, chunkT *chunk)
+{
+    struct readerCDT errorReader;
+    char token[MaxErrorToken];
+    size_t n;
+    long line;
+
+    line = chunk->errorLine;
+    if (job->stream == NULL) {
+        line += CountLines(reader->cp, chunk->start);
+        line += reader->lineNumber - 1;
+    }
+    n = chunk->errorLength;
+    if (n > MaxErrorToken) n = MaxErrorToken;
+    memcpy(token, chunk->errorToken, n);
+    FreeParseJob(job);
+    CloseReader(reader);
+    InitChunkReader(&errorReader, token, token + n);
+    errorReader.lineNumber = line;
+    NumberError(&errorReader, caller, chunk->problem, n);
+}
+
+/*
+ * Function: FreeParseJob
+ * Usage: FreeParseJob(job);
+ * -------------------------
+ * This function frees the chunks and any arrays they contain.
+ */
+
+static void FreeParseJob(parseJobT *job)
+{
+    int i;
+
+    for (i = 0; i < job->nChunks; i++) {
+        if (job->chunks[i].values != NULL) FreeBlock(job->chunks[i].values);
+    }
+    FreeBlock(job->chunks);
+}
+
+/*
+ * Function: CountLines
+ * Usage: n = CountLines(start, end);
+ * ----------------------------------
+ * This function returns the number of newlines between start
+ * and end.
+ */
+
+static long CountLines(char *start, char *end)
+{
+    long n;
+
+    n = 0;
+    while ((start = memchr(start, '\n', end - start)) != NULL) {
+        start++;
+        n++;
+    }
+    return (n);
+}
+
+/*
+ * Function: WriteChars
+ * Usage: WriteChars(writer, chars, n);
+ * ------------------------------------
+ * This function appends n characters to the buffer, flushing
+ * it first if there is not enough room.  A block of characters
+ * that is larger than the buffer is written directly.
+ */
+
+static void WriteChars(writerADT writer, char *chars, size_t n)
+{
+    if (n > (size_t) (writer->limit - writer->cp)) {
+        FlushBuffer(writer);
+        if (n >= WriterBufferSize) {
+            if (fwrite(chars, 1, n, writer->outfile) != n) {
+                Error("Writer: output error");
+            }
+            return;
+        }
+    }
+    memcpy(writer->cp, chars, n);
+    writer->cp += n;
+}
+
+/*
+ * Function: WritePadded
+ * Usage: WritePadded(writer, chars, n, width);
+ * --------------------------------------------
+ * This function writes n characters padded with spaces to the
+ * field width, using the conventions described for WriteInteger.
+ */
+
+static void WritePadded(writerADT writer, char *chars, size_t n,
+                        int width)
+{
+    int padding;
+
+    padding = ((width < 0) ? -width : width) - (int) n;
+    if (width > 0) {
+        while (padding-- > 0) WriteChar(writer, ' ');
+    }
+    WriteChars(writer, chars, n);
+    if (width < 0) {
+        while (padding-- > 0) WriteChar(writer, ' ');
+    }
+}
+
+/*
+ * Function: WriteSlowReal
+ * Usage: WriteSlowReal(writer, x, width, precision);
+ * --------------------------------------------------
+ * This function formats x using snprintf.  Very large values
+ * may not fit in the local buffer, in which case a block of
+ * the necessary size is allocated.
+ */
+
+static void WriteSlowReal(writerADT writer, double x, int width,
+                          int precision)
+{
+    char buffer[MaxNumberChars];
+    char *chars;
+    int n;
+
+    if (precision < 0) precision = 6;
+    chars = buffer;
+    n = snprintf(chars, MaxNumberChars, "%.*f", precision, x);
+    if (n >= MaxNumberChars) {
+        chars = GetBlock(n + 1);
+        snprintf(chars, n + 1, "%.*f", precision, x);
+    }
+    WritePadded(writer, chars, n, width);
+    if (chars != buffer) FreeBlock(chars);
+}
+
+/*
+ * Function: FormatUnsigned
+ * Usage: start = FormatUnsigned(end, value);
+ * ------------------------------------------
+ * This function stores the decimal digits of value in the
+ * characters immediately before end and returns a pointer to
+ * the first digit.  The digits are produced two at a time using
+ * the digitPairs table.
+ */
+
+static char *FormatUnsigned(char *end, unsigned long value)
+{
+    char *pair;
+
+    while (value >= 100) {
+        pair = &digitPairs[2 * (value % 100)];
+        value /= 100;
+        *--end = pair[1];
+        *--end = pair[0];
+    }
+    if (value >= 10) {
+        pair = &digitPairs[2 * value];
+        *--end = pair[1];
+        *--end = pair[0];
+    } else {
+        *--end = '0' + value;
+    }
+    return (end);
+}
+
+/*
+ * Function: FlushBuffer
+ * Usage: FlushBuffer(writer);
+ * ---------------------------
+ * This function passes the buffered characters to the stream
+ * and empties the buffer.  Unlike FlushWriter, it does not
+ * flush the stream itself.
+ */
+
+static void FlushBuffer(writerADT writer)
+{
+    size_t n;
+
+    n = writer->cp - writer->buffer;
+    if (n > 0 && fwrite(writer->buffer, 1, n, writer->outfile) != n) {
+        Error("Writer: output error");
+    }
+    writer->cp = writer->buffer;
+}
+
+/*
+ * Function: StartDecompression
+ * Usage: ring = StartDecompression(infile, format, input, n);
+ * -----------------------------------------------------------
+ * This function creates a ring and starts a thread that reads
+ * compressed data from infile and fills the ring with the
+ * decompressed characters.  The n characters at input have
+ * already been read from infile and are copied so that the
+ * thread treats them as the beginning of its input.  Running
+ * the decompression in its own thread allows it to overlap the
+ * parsing done by the client.  Since the reader has used the
+ * stream, the stream may hold more characters it read ahead,
+ * which the thread takes before reading the file descriptor.
+ */
+
+static ringT *StartDecompression(FILE *infile, compressionT format,
+                                 char *input, size_t n)
+{
+    ringT *ring;
+
+    ring = NewRing(infile);
+    ring->format = format;
+    memcpy(ring->input, input, n);
+    ring->pendingInput = n;
+    ring->streamBuffered = TRUE;
+    StartRing(ring, DecompressWorker);
+    return (ring);
+}
+
+/*
+ * Function: NewRing
+ * Usage: ring = NewRing(infile);
+ * ------------------------------
+ * This function allocates and initializes an empty ring whose
+ * producer will read from infile.
+ */
+
+static ringT *NewRing(FILE *infile)
+{
+    ringT *ring;
+    int i;
+
+    ring = New(ringT *);
+    for (i = 0; i < RingSlots; i++) {
+        ring->slots[i] = GetBlock(RingSlotSize);
+    }
+    ring->head = ring->tail = ring->count = 0;
+    ring->offset = 0;
+    ring->done = ring->stop = FALSE;
+    ring->problem = NULL;
+    ring->infile = infile;
+    ring->format = Uncompressed;
+    ring->input = GetBlock(RingSlotSize);
+    ring->pendingInput = 0;
+    ring->streamBuffered = FALSE;
+    pthread_mutex_init(&ring->lock, NULL);
+    pthread_cond_init(&ring->notEmpty, NULL);
+    pthread_cond_init(&ring->notFull, NULL);
+    return (ring);
+}
+
+/*
+ * Function: StartRing
+ * Usage: StartRing(ring, worker);
+ * -------------------------------
+ * This function starts the producer thread for the ring, which
+ * executes the worker function.
+ */
+
+static void StartRing(ringT *ring, void *(*worker)(void *))
+{
+    if (pthread_create(&ring->thread, NULL, worker, ring) != 0) {
+        Error("Reader: can't create input thread");
+    }
+}
+
+/*
+ * Function: PrefetchWorker
+ * Usage: StartRing(ring, PrefetchWorker);
+ * ---------------------------------------
+ * This function is the body of the prefetch thread, which reads
+ * the file descriptor directly into the buffers of the ring.
+ * After each read, the thread continues to fill the same buffer
+ * only as long as more input is ready without waiting, which
+ * allows large buffers to form when the input arrives quickly
+ * but passes each block on at once when it arrives slowly.  The
+ * first block is checked for compression, in which case the
+ * thread becomes a decompression thread instead; the block is
+ * moved to the input buffer, and the buffer in which it was
+ * read is never published.
+ */
+
+static void *PrefetchWorker(void *arg)
+{
+    ringT *ring;
+    char *slot;
+    size_t filled;
+    long nread;
+    int fd;
+    bool first;
+    string problem;
+
+    ring = (ringT *) arg;
+    fd = fileno(ring->infile);
+    first = TRUE;
+    problem = NULL;
+    while ((slot = GetFreeSlot(ring)) != NULL) {
+        if (!WaitForInput(ring, fd)) break;
+        nread = ReadDescriptor(fd, slot, RingSlotSize);
+        if (nread <= 0) {
+            if (nread < 0) problem = "read error";
+            break;
+        }
+        if (first) {
+            first = FALSE;
+            ring->format = DetectCompression(slot, nread);
+            if (ring->format != Uncompressed) {
+                memcpy(ring->input, slot, nread);
+                ring->pendingInput = nread;
+                return (DecompressWorker(ring));
+            }
+        }
+        filled = nread;
+        while (filled < RingSlotSize && InputReady(fd)) {
+            nread = ReadDescriptor(fd, slot + filled, RingSlotSize - filled);
+            if (nread <= 0) break;
+            filled += nread;
+        }
+        PublishSlot(ring, filled);
+    }
+    FinishRing(ring, problem);
+    return (NULL);
+}
+
+/*
+ * Function: ReadDescriptor
+ * Usage: nread = ReadDescriptor(fd, dst, max);
+ * --------------------------------------------
+ * This function calls read, repeating the call if it is
+ * interrupted by a signal.  It returns the number of characters
+ * read, 0 at the end of the file, or -1 on an error.
+ */
+
+static long ReadDescriptor(int fd, char *dst, size_t max)
+{
+    long nread;
+
+    do {
+        nread = read(fd, dst, max);
+    } while (nread < 0 && errno == EINTR);
+    return (nread);
+}
+
+/*
+ * Function: InputReady
+ * Usage: if (InputReady(fd)) . . .
+ * --------------------------------
+ * This function returns TRUE if a read from fd would return
+ * immediately, either with data or at the end of the file.
+ */
+
+static bool InputReady(int fd)
+{
+    struct pollfd pfd;
+
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    return (poll(&pfd, 1, 0) > 0);
+}
+
+/*
+ * Function: WaitForInput
+ * Usage: if (!WaitForInput(ring, fd)) . . .
+ * -----------------------------------------
+ * This function waits until input is ready on fd and returns
+ * TRUE, or returns FALSE if the reader is closed in the meantime.
+ * Waiting in poll rather than in read ensures that CloseReader
+ * does not hang when the writer at the other end of a pipe has
+ * not yet produced more data.
+ */
+
+static bool WaitForInput(ringT *ring, int fd)
+{
+    struct pollfd pfd;
+    bool stop;
+
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    while (TRUE) {
+        if (poll(&pfd, 1, StopPollInterval) > 0) return (TRUE);
+        pthread_mutex_lock(&ring->lock);
+        stop = ring->stop;
+        pthread_mutex_unlock(&ring->lock);
+        if (stop) return (FALSE);
+    }
+}
+
+/*
+ * Function: DecompressWorker
+ * Usage: pthread_create(&thread, NULL, DecompressWorker, ring);
+ * -------------------------------------------------------------
+ * This function is the body of the decompression thread.
+ */
+
+static void *DecompressWorker(void *arg)
+{
+    ringT *ring;
+    string problem;
+
+    ring = (ringT *) arg;
+#ifdef HAVE_ZSTD
+    if (ring->format == ZstdCompressed) {
+        problem = ZstdInput(ring);
+    } else {
+        problem = InflateInput(ring);
+    }
+#else
+    if (ring->format == ZstdCompressed) {
+        problem = "zstd input requires compiling with HAVE_ZSTD";
+    } else {
+        problem = InflateInput(ring);
+    }
+#endif
+    FinishRing(ring, problem);
+    return (NULL);
+}
+
+/*
+ * Function: InflateInput
+ * Usage: problem = InflateInput(ring);
+ * ------------------------------------
+ * This function decompresses gzip data into the ring using
+ * zlib and returns NULL or a description of the problem.  A
+ * file that consists of several gzip members, as produced by
+ * concatenating gzip files or by parallel compressors, is
+ * decompressed as a whole by resetting the stream at the end of
+ * each member.  The loop keeps calling inflate after the input
+ * is exhausted for as long as it fills the output buffer, since
+ * zlib may still hold decompressed data.
+ */
+
+static string InflateInput(ringT *ring)
+{
+    z_stream zs;
+    char *slot;
+    long nread;
+    uInt lastAvailIn;
+    int status;
+    bool inputDone, complete;
+
+    memset(&zs, 0, sizeof zs);
+    if (inflateInit2(&zs, 15 + 16) != Z_OK) return ("can't initialize zlib");
+    slot = NULL;
+    inputDone = complete = FALSE;
+    while (TRUE) {
+        if (zs.avail_in == 0 && !inputDone) {
+            nread = ReadCompressed(ring);
+            if (nread < 0) {
+                inflateEnd(&zs);
+                return ("read error");
+            } else if (nread == 0) {
+                inputDone = TRUE;
+            } else {
+                zs.next_in = (Bytef *) ring->input;
+                zs.avail_in = nread;
+            }
+        }
+        if (slot == NULL) {
+            slot = GetFreeSlot(ring);
+            if (slot == NULL) break;
+            zs.next_out = (Bytef *) slot;
+            zs.avail_out = RingSlotSize;
+        }
+        lastAvailIn = zs.avail_in;
+        status = inflate(&zs, Z_NO_FLUSH);
+        if (status == Z_STREAM_END) {
+            complete = TRUE;
+            inflateReset(&zs);
+        } else if (status == Z_OK || status == Z_BUF_ERROR) {
+            if (zs.avail_in != lastAvailIn) complete = FALSE;
+        } else {
+            inflateEnd(&zs);
+            return ("corrupt gzip data");
+        }
+        if (zs.avail_out == 0) {
+            PublishSlot(ring, RingSlotSize);
+            slot = NULL;
+        } else if (inputDone) {
+            PublishSlot(ring, RingSlotSize - zs.avail_out);
+            break;
+        }
+    }
+    inflateEnd(&zs);
+    if (slot != NULL && !complete) return ("unexpected end of gzip data");
+    return (NULL);
+}
+
+#ifdef HAVE_ZSTD
+
+/*
+ * Function: ZstdInput
+ * Usage: problem = ZstdInput(ring);
+ * ---------------------------------
+ * This function decompresses zstd data into the ring in the
+ * same way that InflateInput decompresses gzip data.  The zstd
+ * library handles a sequence of frames without help, and
+ * ZSTD_decompressStream returns 0 when it completes a frame.
+ */
+
+static string ZstdInput(ringT *ring)
+{
+    ZSTD_DStream *zds;
+    ZSTD_inBuffer in;
+    ZSTD_outBuffer out;
+    char *slot;
+    size_t result, lastPos;
+    long nread;
+    bool inputDone, complete;
+
+    zds = ZSTD_createDStream();
+    if (zds == NULL) return ("can't initialize zstd");
+    ZSTD_initDStream(zds);
+    in.src = ring->input;
+    in.size = in.pos = 0;
+    slot = NULL;
+    inputDone = complete = FALSE;
+    while (TRUE) {
+        if (in.pos == in.size && !inputDone) {
+            nread = ReadCompressed(ring);
+            if (nread < 0) {
+                ZSTD_freeDStream(zds);
+                return ("read error");
+            } else if (nread == 0) {
+                inputDone = TRUE;
+            } else {
+                in.size = nread;
+                in.pos = 0;
+            }
+        }
+        if (slot == NULL) {
+            slot = GetFreeSlot(ring);
+            if (slot == NULL) break;
+            out.dst = slot;
+            out.size = RingSlotSize;
+            out.pos = 0;
+        }
+        lastPos = in.pos;
+        result = ZSTD_decompressStream(zds, &out, &in);
+        if (ZSTD_isError(result)) {
+            ZSTD_freeDStream(zds);
+            return ("corrupt zstd data");
+        }
+        if (result == 0) {
+            complete = TRUE;
+        } else if (in.pos != lastPos) {
+            complete = FALSE;
+        }
+        if (out.pos == out.size) {
+            PublishSlot(ring, out.pos);
+            slot = NULL;
+        } else if (inputDone) {
+            PublishSlot(ring, out.pos);
+            break;
+        }
+    }
+    ZSTD_freeDStream(zds);
+    if (slot != NULL && !complete) return ("unexpected end of zstd data");
+    return (NULL);
+}
+
+#endif
+
+/*
+ * Function: ReadCompressed
+ * Usage: nread = ReadCompressed(ring);
+ * ------------------------------------
+ * This function reads the next block of compressed input into
+ * the input buffer of the ring and returns its length, 0 at the
+ * end of the input or if the reader is closed, or -1 on an
+ * error.  The characters read by the reader before the format
+ * was detected are returned first, followed by any characters
+ * still held by the stream.  After that, the function waits in
+ * WaitForInput and reads the file descriptor, so that CloseReader
+ * does not hang on a pipe or terminal that has no more data yet.
+ */
+
+static long ReadCompressed(ringT *ring)
+{
+    long n;
+    int fd;
+
+    if (ring->pendingInput > 0) {
+        n = ring->pendingInput;
+        ring->pendingInput = 0;
+        return (n);
+    }
+    if (ring->streamBuffered) {
+        n = DrainStream(ring->infile, ring->input, RingSlotSize);
+        if (n < RingSlotSize) ring->streamBuffered = FALSE;
+        if (n != 0) return (n);
+    }
+    fd = fileno(ring->infile);
+    if (!WaitForInput(ring, fd)) return (0);
+    return (ReadDescriptor(fd, ring->input, RingSlotSize));
+}
+
+/*
+ * Function: DrainStream
+ * Usage: nread = DrainStream(infile, dst, max);
+ * ---------------------------------------------
+ * This function reads up to max characters from infile into dst
+ * without waiting for more input to arrive and returns the number
+ * of characters read or -1 on an error.  The file descriptor is
+ * made nonblocking for the duration of the call, so fread returns
+ * what the stream has buffered together with whatever is ready on
+ * the descriptor.  A result shorter than max therefore means that
+ * the stream holds no more characters.  The error and end-of-file
+ * indicators of the stream are cleared afterward.
+ */
+
+static long DrainStream(FILE *infile, char *dst, size_t max)
+{
+    size_t nread;
+    int fd, flags;
+    bool failed;
+
+    fd = fileno(infile);
+    flags = fcntl(fd, F_GETFL);
+    if (flags == -1) return (-1);
+    fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+    errno = 0;
+    nread = fread(dst, 1, max, infile);
+    failed = ferror(infile) && errno != EAGAIN && errno != EWOULDBLOCK;
+    fcntl(fd, F_SETFL, flags);
+    clearerr(infile);
+    return ((failed) ? -1 : (long) nread);
+}
+
+/*
+ * Function: GetFreeSlot
+ * Usage: slot = GetFreeSlot(ring);
+ * --------------------------------
+ * This function is called by the producer to obtain the buffer
+ * at the tail of the ring, waiting until the consumer has
+ * emptied one if all of them are full.  The function returns
+ * NULL if the consumer has asked the producer to stop.
+ */
+
+static char *GetFreeSlot(ringT *ring)
+{
+    char *slot;
+
+    pthread_mutex_lock(&ring->lock);
+    while (ring->count == RingSlots && !ring->stop) {
+        pthread_cond_wait(&ring->notFull, &ring->lock);
+    }
+    slot = (ring->stop) ? NULL : ring->slots[ring->tail];
+    pthread_mutex_unlock(&ring->lock);
+    return (slot);
+}
+
+/*
+ * Function: PublishSlot
+ * Usage: PublishSlot(ring, n);
+ * ----------------------------
+ * This function is called by the producer after it has stored
+ * n characters in the buffer obtained from GetFreeSlot.  The
+ * buffer becomes available to the consumer.  An empty buffer
+ * is not published, so it remains free for the next call to
+ * GetFreeSlot.
+ */
+
+static void PublishSlot(ringT *ring, size_t n)
+{
+    if (n == 0) return;
+    pthread_mutex_lock(&ring->lock);
+    ring->lengths[ring->tail] = n;
+    ring->tail = (ring->tail + 1) % RingSlots;
+    ring->count++;
+    pthread_cond_signal(&ring->notEmpty);
+    pthread_mutex_unlock(&ring->lock);
+}
+
+/*
+ * Function: FinishRing
+ * Usage: FinishRing(ring, problem);
+ * ---------------------------------
+ * This function is called by the producer when it has no more
+ * data to add to the ring, either because the input is
+ * exhausted or because of the error described by problem.
+ */
+
+static void FinishRing(ringT *ring, string problem)
+{
+    pthread_mutex_lock(&ring->lock);
+    ring->done = TRUE;
+    ring->problem = problem;
+    pthread_cond_broadcast(&ring->notEmpty);
+    pthread_mutex_unlock(&ring->lock);
+}
+
+/*
+ * Function: ReadRing
+ * Usage: nread = ReadRing(ring, dst, max);
+ * ----------------------------------------
+ * This function is called by the consumer to copy up to max
+ * characters from the buffer at the head of the ring into dst,
+ * waiting for the producer if no buffer is full.  When the
+ * buffer has been emptied, it is returned to the producer.  The
+ * function returns 0 when the producer has finished and every
+ * buffer has been emptied, and it calls Error if the producer
+ * reported a problem.  The copying is done without holding the
+ * lock, since the producer never touches a full buffer.
+ */
+
+static size_t ReadRing(ringT *ring, char *dst, size_t max)
+{
+    size_t n, length;
+    string problem;
+
+    pthread_mutex_lock(&ring->lock);
+    while (ring->count == 0 && !ring->done) {
+        pthread_cond_wait(&ring->notEmpty, &ring->lock);
+    }
+    if (ring->count == 0) {
+        problem = ring->problem;
+        pthread_mutex_unlock(&ring->lock);
+        if (problem != NULL) Error("Reader: %s", problem);
+        return (0);
+    }
+    length = ring->lengths[ring->head];
+    pthread_mutex_unlock(&ring->lock);
+    n = length - ring->offset;
+    if (n > max) n = max;
+    memcpy(dst, ring->slots[ring->head] + ring->offset, n);
+    ring->offset += n;
+    if (ring->offset == length) {
+        pthread_mutex_lock(&ring->lock);
+        ring->head = (ring->head + 1) % RingSlots;
+        ring->count--;
+        ring->offset = 0;
+        pthread_cond_signal(&ring->notFull);
+        pthread_mutex_unlock(&ring->lock);
+    }
+    return (n);
+}
+
+/*
+ * Function: StopRing
+ * Usage: StopRing(ring);
+ * ----------------------
+ * This function asks the producer to stop, waits for its thread
+ * to exit, and then frees the ring.
+ */
+
+static void StopRing(ringT *ring)
+{
+    int i;
+
+    pthread_mutex_lock(&ring->lock);
+    ring->stop = TRUE;
+    pthread_cond_broadcast(&ring->notFull);
+    pthread_mutex_unlock(&ring->lock);
+    pthread_join(ring->thread, NULL);
+    pthread_mutex_destroy(&ring->lock);
+    pthread_cond_destroy(&ring->notEmpty);
+    pthread_cond_destroy(&ring->notFull);
+    for (i = 0; i < RingSlots; i++) FreeBlock(ring->slots[i]);
+    FreeBlock(ring->input);
+    FreeBlock(ring);
 }
@@ -78,4 +78,328 @@ string GetLine(void);
 
 string ReadLine(FILE *infile);
 
+/*
+ * Type: readerADT
+ * ---------------
+ * This abstract type represents an input file that is read in
+ * bulk.  A reader is intended for programs that process large
+ * files, for which allocating a new string for every line (as
+ * ReadLine does) is too expensive.  If the file is a regular
+ * file, the reader maps it into memory and the characters are
+ * never copied; otherwise, such as when the file is a pipe or a
+ * terminal, the reader falls back to reading it in large blocks.
+ */
+
+typedef struct readerCDT *readerADT;
+
+/*
+ * Type: lineViewT
+ * ---------------
+ * A line view identifies the characters of a line without
+ * copying them.  The start field points to the first character
+ * of the line, and the length field gives the number of
+ * characters, not counting the newline.  The characters are
+ * not terminated by a null character and must not be modified.
+ * They remain valid only until the next call that reads from
+ * the same reader.
+ */
+
+typedef struct {
+    char *start;
+    size_t length;
+} lineViewT;
+
+/*
+ * Function: OpenReader
+ * Usage: reader = OpenReader(filename);
+ * -------------------------------------
+ * OpenReader opens the named file and returns a reader for it.
+ * If the file cannot be opened, OpenReader returns NULL.
+ */
+
+readerADT OpenReader(string filename);
+
+/*
+ * Function: NewReader
+ * Usage: reader = NewReader(infile);
+ * ----------------------------------
+ * NewReader returns a reader that takes its input from infile,
+ * which must already be open.  Reading begins at the current
+ * position of infile, which makes it possible to use a reader
+ * on stdin.  Once a stream has been passed to NewReader, the
+ * client should not read from it by any other means.
+ * Closing the reader does not close the stream.
+ */
+
+readerADT NewReader(FILE *infile);
+
+/*
+ * Function: EnablePrefetch
+ * Usage: EnablePrefetch(reader);
+ * ------------------------------
+ * EnablePrefetch starts a background thread that reads ahead
+ * from the underlying file descriptor into a ring of buffers,
+ * so that input arriving through a pipe is read while the
+ * client is busy processing earlier input.  Each block of input
+ * is handed to the client as soon as it arrives, rather than
+ * when a full buffer has accumulated, which keeps the delay low
+ * when the data arrives slowly.  The function must be called
+ * before anything is read from the reader.  Because the thread
+ * reads the descriptor directly, the stream must not have been
+ * read through stdio before the reader was created.  If the
+ * reader maps a regular file, which is already read ahead by
+ * the operating system, EnablePrefetch has no effect.
+ */
+
+void EnablePrefetch(readerADT reader);
+
+/*
+ * Function: ReadLineView
+ * Usage: while (ReadLineView(reader, &view)) . . .
+ * ------------------------------------------------
+ * ReadLineView reads the next line from the reader and stores
+ * a view of its characters in the structure addressed by view.
+ * The function returns TRUE if a line was read and FALSE if the
+ * reader is at the end of the file.
+ */
+
+bool ReadLineView(readerADT reader, lineViewT *view);
+
+/*
+ * Type: numberLayoutT
+ * -------------------
+ * This type specifies how the numbers read by ReadInteger,
+ * ReadLong, and ReadReal are arranged in the input.  In the
+ * WhitespaceSeparated layout, which is the default, numbers may
+ * be separated by any sequence of spaces, tabs, and newlines.
+ * In the LineSeparated layout, each number must appear on a
+ * line by itself, as it must for GetInteger, although blank
+ * lines are skipped.
+ */
+
+typedef enum { WhitespaceSeparated, LineSeparated } numberLayoutT;
+
+/*
+ * Function: SetNumberLayout
+ * Usage: SetNumberLayout(reader, LineSeparated);
+ * ----------------------------------------------
+ * This function sets the layout used when reading numbers.
+ */
+
+void SetNumberLayout(readerADT reader, numberLayoutT layout);
+
+/*
+ * Functions: ReadInteger, ReadLong, ReadReal
+ * Usage: while (ReadInteger(reader, &n)) . . .
+ * --------------------------------------------
+ * These functions read the next number from the reader and
+ * store it in the variable addressed by the second argument.
+ * Each function returns TRUE if a number was read and FALSE
+ * if only white space remains before the end of the file.
+ * The numbers are parsed directly out of the reader's buffer,
+ * which makes these functions much faster than GetInteger and
+ * its relatives when reading large amounts of data.  Unlike
+ * those functions, however, they do not give the user a chance
+ * to retry.  If the input does not contain a legal number, or
+ * if the number does not fit in the result type, they call
+ * Error with a message that includes the line number.
+ */
+
+bool ReadInteger(readerADT reader, int *ip);
+bool ReadLong(readerADT reader, long *lp);
+bool ReadReal(readerADT reader, double *dp);
+
+/*
+ * Functions: ViewToLong, ViewToReal
+ * Usage: if (ViewToLong(view, &n)) . . .
+ * --------------------------------------
+ * These functions convert the characters in a view, such as a
+ * line view or a field of a CSV record, using the same parsers
+ * as ReadLong and ReadReal.  The view must contain exactly one
+ * number with no surrounding white space.  If it does, the
+ * functions store the value in the variable addressed by the
+ * second argument and return TRUE; if not, they return FALSE.
+ */
+
+bool ViewToLong(lineViewT view, long *lp);
+bool ViewToReal(lineViewT view, double *dp);
+
+/*
+ * Type: numberSummaryT
+ * --------------------
+ * This structure holds the result of SummarizeRealFile: the
+ * number of values in the file together with their sum and
+ * their minimum and maximum values.  If the file contains no
+ * numbers, every field is zero.
+ */
+
+typedef struct {
+    long count;
+    double sum;
+    double min;
+    double max;
+} numberSummaryT;
+
+/*
+ * Functions: ReadLongFile, ReadRealFile
+ * Usage: array = ReadRealFile(filename, &n);
+ * ------------------------------------------
+ * These functions read every number in the named file, which
+ * must be separated by white space, and return a dynamically
+ * allocated array containing the values in the order in which
+ * they appear.  The number of values is stored in the variable
+ * addressed by the second argument.  If the file is a regular
+ * file, it is divided into pieces that end at newlines, and the
+ * pieces are parsed in parallel, using the number of threads
+ * set by SetParseThreads.  If the file cannot be opened or
+ * contains anything other than legal numbers, these functions
+ * call Error.
+ */
+
+long *ReadLongFile(string filename, long *np);
+double *ReadRealFile(string filename, long *np);
+
+/*
+ * Function: SummarizeRealFile
+ * Usage: summary = SummarizeRealFile(filename);
+ * ---------------------------------------------
+ * This function reads the numbers in the named file in the same
+ * way as ReadRealFile but, instead of storing the values,
+ * returns their count, sum, minimum, and maximum.  Because each
+ * thread reduces its own pieces of the file, no array is ever
+ * allocated.  The pieces depend only on the size of the file,
+ * so the result is the same for any number of threads.
+ */
+
+numberSummaryT SummarizeRealFile(string filename);
+
+/*
+ * Function: SetParseThreads
+ * Usage: SetParseThreads(n);
+ * --------------------------
+ * This function sets the number of threads used by the parallel
+ * file readers.  If n is 0, which is the default, the readers
+ * use one thread for each processor that is online.
+ */
+
+void SetParseThreads(int n);
+
+/*
+ * Function: ReaderLineNumber
+ * Usage: n = ReaderLineNumber(reader);
+ * ------------------------------------
+ * This function returns the number of the line that contains
+ * the next unread character, where the first line is line 1.
+ * Clients can use it to report errors in the input.
+ */
+
+long ReaderLineNumber(readerADT reader);
+
+/*
+ * Function: CloseReader
+ * Usage: CloseReader(reader);
+ * ---------------------------
+ * CloseReader frees the storage associated with the reader,
+ * after which no line views obtained from it may be used.  If
+ * the reader was created by OpenReader, the file is closed.
+ */
+
+void CloseReader(readerADT reader);
+
+/*
+ * Type: writerADT
+ * ---------------
+ * This abstract type represents an output file written through
+ * a large buffer.  A writer is intended for programs that print
+ * large tables or many lines of output, for which the cost of
+ * calling printf for each small item is significant.  The
+ * functions that write integers and real numbers format them
+ * directly into the buffer without interpreting a format string.
+ * Output written to a writer appears in the file only when the
+ * buffer fills or when the client calls FlushWriter or
+ * CloseWriter, so a program that mixes a writer with printf on
+ * the same file must flush the writer first.
+ */
+
+typedef struct writerCDT *writerADT;
+
+/*
+ * Function: OpenWriter
+ * Usage: writer = OpenWriter(filename);
+ * -------------------------------------
+ * OpenWriter creates the named file and returns a writer for
+ * it.  If the file cannot be opened, OpenWriter returns NULL.
+ */
+
+writerADT OpenWriter(string filename);
+
+/*
+ * Function: NewWriter
+ * Usage: writer = NewWriter(stdout);
+ * ----------------------------------
+ * NewWriter returns a writer that sends its output to outfile,
+ * which must already be open.  Closing the writer does not
+ * close the stream.
+ */
+
+writerADT NewWriter(FILE *outfile);
+
+/*
+ * Functions: WriteString, WriteChar
+ * Usage: WriteString(writer, s);
+ *        WriteChar(writer, ch);
+ * ------------------------------
+ * These functions append a string or a single character to the
+ * output.
+ */
+
+void WriteString(writerADT writer, string s);
+void WriteChar(writerADT writer, char ch);
+
+/*
+ * Function: WriteInteger
+ * Usage: WriteInteger(writer, n, width);
+ * --------------------------------------
+ * WriteInteger appends the decimal representation of n to the
+ * output.  If the representation is shorter than width, it is
+ * padded with spaces on the left; if width is negative, the
+ * padding appears on the right, as it does with the - flag in a
+ * printf format.  A width of 0 specifies no padding.  Thus,
+ * WriteInteger(writer, n, 4) has the same effect as a printf
+ * call with the format "%4ld".
+ */
+
+void WriteInteger(writerADT writer, long n, int width);
+
+/*
+ * Function: WriteReal
+ * Usage: WriteReal(writer, x, width, precision);
+ * ----------------------------------------------
+ * WriteReal appends x to the output in fixed-point notation with
+ * precision digits after the decimal point, padded to width as
+ * in WriteInteger.  The result is identical to that produced by
+ * printf with the format "%width.precisionf".
+ */
+
+void WriteReal(writerADT writer, double x, int width, int precision);
+
+/*
+ * Function: FlushWriter
+ * Usage: FlushWriter(writer);
+ * ---------------------------
+ * FlushWriter sends any buffered output to the file.
+ */
+
+void FlushWriter(writerADT writer);
+
+/*
+ * Function: CloseWriter
+ * Usage: CloseWriter(writer);
+ * ---------------------------
+ * CloseWriter flushes the writer and frees its storage.  If the
+ * writer was created by OpenWriter, the file is closed.
+ */
+
+void CloseWriter(writerADT writer);
+
 #endif
@@ -17,12 +17,36 @@
  * All rendering is done into the offscreen window.  When update
  * events occur, the graphics window is updated by copying bits
  * from the offscreen window.
+ *
+ * To keep those copies small, the implementation records the
+ * areas of the offscreen window that have changed since the last
+ * update as a short list of damaged rectangles.  Each drawing
+ * operation adds its bounding box to the list, and a redraw
+ * copies only the damaged rectangles, so that a program that
+ * animates a small figure copies a few hundred pixels per frame
+ * rather than the entire window.  When the list is full, a new
+ * box is merged with the rectangle that grows the least, and any
+ * rectangles that then overlap are merged as well, so that no
+ * pixel is copied twice.  Expose events from the server add the
+ * exposed area to the list in the same way.
+ *
+ * Lines and arcs are not sent to the server one at a time.
+ * Consecutive lines and arcs drawn with the same GC are collected
+ * in the arrays segments and arcs and submitted together with
+ * XDrawSegments and XDrawArcs, which saves the cost of a separate
+ * call and request for each one.  Because the primitives in a
+ * batch share a GC, the order in which they are drawn does not
+ * affect the result.  The batch is submitted by FlushBatch before
+ * any operation whose result could depend on it: drawing with a
+ * different GC, drawing text or a filled region, changing the
+ * drawing color, and copying the offscreen window to the screen.
  */
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <stdint.h>
 #include <sys/time.h>
 #include <sys/types.h>
 #include <X11/Xlib.h>
@@ -43,6 +67,10 @@
  * MaxFontList    -- Size of the font list we will accept
  * PStartSize     -- Starting size for polygon (must be greater than 1)
  * DefaultFont    -- Font that serves as the "Default" font
+ * MaxDamage      -- Number of damaged rectangles tracked separately
+ * MaxBatch       -- Number of lines or arcs submitted together
+ * MaxArcError    -- Distance in pixels by which a region may miss an arc
+ * MaxConvexTest  -- Largest polygon tested for convexity
  */
 
 #define RequiredMargin   0.5
@@ -50,6 +78,10 @@
 #define MaxFontList    500
 #define PStartSize      50
 #define DefaultFont     "courier"
+#define MaxDamage        8
+#define MaxBatch       256
+#define MaxArcError      0.25
+#define MaxConvexTest   64
 
 /*
  * Other constants
@@ -92,11 +124,31 @@ typedef enum {
     WaitingForMouseUp
 } waitStateT;
 
+/*
+ * Type: boxT
+ * ----------
+ * This type represents a damaged rectangle of the offscreen
+ * window, which covers the pixels from x0 up to but not including
+ * x1 horizontally and from y0 up to but not including y1
+ * vertically.
+ */
+
+typedef struct {
+    int x0, y0, x1, y1;
+} boxT;
+
 /*
  * Private variables
  * -----------------
  * displayIsOpen   -- TRUE if the display has been opened
  * redraw          -- TRUE if mainWindow needs redrawing
+ * damage          -- Rectangles changed since the last redraw
+ * nDamage         -- Number of rectangles in the damage list
+ * batchGC         -- The GC shared by the lines and arcs in the batch
+ * segments        -- Lines waiting to be submitted
+ * nSegments       -- Number of lines in the batch
+ * arcs            -- Arcs waiting to be submitted
+ * nArcs           -- Number of arcs in the batch
  * eraseMode       -- TRUE if erase mode has been set
  * xdpi, ydpi      -- Dots per inch in each coordinate
  * disp            -- X display containing windows
@@ -123,13 +175,20 @@ typedef enum {
  * waitState       -- Indicates what mouse event is awaited
  * regionStarted   -- TRUE is a region is in progress
  * regionGrayScale -- Gray scale density [0,1]
- * polygonPoints   -- Array of points used in current region
+ * polygonPoints   -- Array of points, which is reused for each region
  * nPolygonPoints  -- Number of active points
  * polygonSize     -- Number of allocated points
  */
 
 static bool displayIsOpen = FALSE;
 static bool redraw = FALSE;
+static boxT damage[MaxDamage];
+static int nDamage = 0;
+static GC batchGC;
+static XSegment segments[MaxBatch];
+static int nSegments = 0;
+static XArc arcs[MaxBatch];
+static int nArcs = 0;
 static bool eraseMode;
 static double xdpi, ydpi;
 
@@ -156,7 +215,7 @@ static waitStateT waitState;
 
 static bool regionStarted;
 static double regionGrayScale;
-static XPoint *polygonPoints;
+static XPoint *polygonPoints = NULL;
 static int nPolygonPoints;
 static int polygonSize;
 
@@ -166,9 +225,18 @@ static void StartToOpenDisplay(void);
 static void InitGC(void);
 static void ForceRedraw(void);
 static void RedrawWindow(void);
+static void AddDamage(int x0, int y0, int x1, int y1);
+static void MergeDamage(int k);
+static int BoxArea(int x0, int y0, int x1, int y1);
+static void BatchLine(GC gc, int x0, int y0, int x1, int y1);
+static void BatchArc(GC gc, int x, int y, int width, int height,
+                     int start, int sweep);
+static void FlushBatch(void);
 static void StartPolygon(void);
 static void AddSegment(int x0, int y0, int x1, int y1);
 static void DisplayPolygon(void);
+static void ExpandPolygon(int minSize);
+static bool ExaminePolygon(XPoint points[], int n, boxT *bbox);
 static void RenderArc(double x, double y, double rx, double ry,
                       double start, double sweep);
 static int SizeFromFontName(string fontName);
@@ -261,7 +329,8 @@ void XDOpenDisplay(string title)
 /*
  * Function: XDCloseDisplay
  * ------------------------
- * This function frees the X structures allocated by the package.
+ * This function frees the X structures allocated by the package,
+ * along with the array used to assemble regions.
  */
 
 void XDCloseDisplay(void)
@@ -278,6 +347,10 @@ void XDCloseDisplay(void)
         XFreePixmap(disp, grayStipple[i]);
     }
     XCloseDisplay(disp);
+    if (polygonPoints != NULL) {
+        FreeBlock(polygonPoints);
+        polygonPoints = NULL;
+    }
 }
 
 /*
@@ -293,6 +366,21 @@ int XDDisplayFD(void)
     return (XConnectionNumber(disp));
 }
 
+/*
+ * Function: XDEventsQueued
+ * ------------------------
+ * Any Xlib call that waits for a reply from the server, such as
+ * XQueryPointer, reads the events that arrive in the meantime
+ * into the queue that Xlib keeps, which is what this function
+ * checks.  Asking for QueuedAlready ensures that the check itself
+ * neither reads from nor flushes the connection.
+ */
+
+bool XDEventsQueued(void)
+{
+    return (XEventsQueued(disp, QueuedAlready) > 0);
+}
+
 /*
  * Function: XDProcessXEvent
  * -------------------------
@@ -309,6 +397,11 @@ bool XDProcessXEvent(void)
     if (event.xany.window == mainWindow) {
         switch (event.type) {
           case Expose:
+            if (!event.xexpose.send_event) {
+                AddDamage(event.xexpose.x, event.xexpose.y,
+                          event.xexpose.x + event.xexpose.width,
+                          event.xexpose.y + event.xexpose.height);
+            }
             if (event.xexpose.count == 0) RedrawWindow();
             break;
           case ButtonPress:
@@ -333,12 +426,14 @@ bool XDProcessXEvent(void)
  * --------------------------
  * This function allows the client to specify that a quiescent point
  * has been achieved and that it would be a good time to redraw the
- * window.  A redraw occurs only if graphics updates have been made.
+ * window.  A redraw occurs only if graphics updates have been made
+ * and have changed some part of the window.
  */
 
 void XDCheckForRedraw(void)
 {
-    if (redraw) ForceRedraw();
+    if (redraw && nDamage > 0) ForceRedraw();
+    if (nDamage == 0) redraw = FALSE;
 }
 
 /*
@@ -346,9 +441,9 @@ void XDCheckForRedraw(void)
  * -------------------------
  * This function allows the client to indicate that the display has
  * changed and that a redraw operation should be performed when the
- * next call to XDCheckForRedraw occurs.  This mechanism currently
- * sets a single flag and should at some point be redesigned to
- * maintain the update region.
+ * next call to XDCheckForRedraw occurs.  The areas to be redrawn
+ * are recorded in the damage list by the drawing functions
+ * themselves, so this function needs only to set a flag.
  */
 
 void XDSetRedrawFlag(void)
@@ -360,7 +455,8 @@ void XDSetRedrawFlag(void)
  * Function: XDClearDisplay
  * ------------------------
  * This function erases the entire display by filling with the
- * erase color.
+ * erase color.  Any lines and arcs waiting in the batch would be
+ * erased at once, so they are simply discarded.
  */
 
 void XDClearDisplay(void)
@@ -371,14 +467,17 @@ void XDClearDisplay(void)
 
     if (XGetGeometry(disp, osWindow, &wtemp, &itemp, &itemp,
                      &width, &height, &utemp, &utemp) == 0) return;
+    nSegments = nArcs = 0;
     XFillRectangle(disp, osWindow, eraseGC, 0, 0, width, height);
+    AddDamage(0, 0, width, height);
 }
 
 /*
  * Function: XDDrawLine
  * --------------------
- * This function draws the requested line unless a region is in
- * progress, in which case it adds the line segment to the polygon.
+ * This function adds the requested line to the batch unless a
+ * region is in progress, in which case it adds the line segment
+ * to the polygon.
  */
 
 void XDDrawLine(double x, double y, double dx, double dy)
@@ -392,8 +491,9 @@ void XDDrawLine(double x, double y, double dx, double dy)
     if (regionStarted) {
         AddSegment(x0, y0, x1, y1);
     } else {
-        XDrawLine(disp, osWindow, (eraseMode) ? eraseGC : drawGC,
-                  x0, y0, x1, y1);
+        BatchLine((eraseMode) ? eraseGC : drawGC, x0, y0, x1, y1);
+        AddDamage(GLMin(x0, x1), GLMin(y0, y1),
+                  GLMax(x0, x1) + 1, GLMax(y0, y1) + 1);
     }
 }
 
@@ -401,7 +501,8 @@ void XDDrawLine(double x, double y, double dx, double dy)
  * Function: XDDrawArc
  * -------------------
  * This function ordinarily scales its arguments and uses them
- * to draw an arc using the standard XDrawArc call.  If, however,
+ * to add an arc to the batch, which is submitted with the standard
+ * XDrawArcs call.  If, however,
  * a region has been started, that arc must be rendered using
  * line segments, which is handled by RenderArc.
  */
@@ -428,9 +529,10 @@ void XDDrawArc(double x, double y, double rx, double ry,
             istart = 360 - (-istart % 360);
         }
         istart %= 360;
-        XDrawArc(disp, osWindow, (eraseMode) ? eraseGC : drawGC,
+        BatchArc((eraseMode) ? eraseGC : drawGC,
                  ixc - irx, iyc - iry, 2 * irx, 2 * iry,
                  64 * istart, 64 * isweep);
+        AddDamage(ixc - irx, iyc - iry, ixc + irx + 1, iyc + iry + 1);
     }
 }
 
@@ -438,17 +540,31 @@ void XDDrawArc(double x, double y, double rx, double ry,
  * Function: XDDrawText
  * --------------------
  * This function transforms the client arguments and makes the
- * appropriate X call to display text on the screen.
+ * appropriate X call to display text on the screen.  The extent
+ * of the text, which determines the damaged area, is computed
+ * from the font information without a request to the server.
  */
 
 void XDDrawText(double x, double y, string text)
 {
-    int ix, iy;
+    int ix, iy, len, direction, ascent, descent;
+    XCharStruct extent;
 
     ix = ScaleX(x);
     iy = ScaleY(y);
+    len = strlen(text);
+    FlushBatch();
     XDrawString(disp, osWindow, (eraseMode) ? eraseGC : drawGC,
-                ix, iy, text, strlen(text));
+                ix, iy, text, len);
+    if (fontInfo == NULL) {
+        AddDamage(0, 0, PixelsX(windowWidth), PixelsY(windowHeight));
+    } else {
+        XTextExtents(fontInfo, text, len, &direction, &ascent, &descent,
+                     &extent);
+        AddDamage(ix + GLMin(extent.lbearing, 0), iy - extent.ascent,
+                  ix + GLMax(extent.rbearing, extent.width),
+                  iy + extent.descent);
+    }
 }
 
 /*
@@ -649,6 +765,8 @@ void XDWaitForMouse(bool buttonState)
  * Function: XDSetColor
  * --------------------
  * This function sets the pen color as specified by the arguments.
+ * The lines and arcs in the batch must be drawn first, since they
+ * use the old color.
  */
 
 void XDSetColor(double red, double green, double blue)
@@ -659,6 +777,7 @@ void XDSetColor(double red, double green, double blue)
     color.green = green * 65535;
     color.blue = blue * 65535;
     if (XAllocColor(disp, colormap, &color) != 0) {
+        FlushBatch();
         drawColor = color.pixel;
         XSetForeground(disp, drawGC, drawColor);
     }
@@ -799,64 +918,231 @@ static void ForceRedraw(void)
  * Function: RedrawWindow
  * Usage: RedrawWindow();
  * ----------------------
- * This function redraws the active display window by copying bits
- * from the offscreen bitmap.
+ * This function redraws the active display window by copying the
+ * damaged rectangles from the offscreen bitmap, clipped to the
+ * size of the window, and then empties the damage list.  Any
+ * lines and arcs in the batch are submitted before the copy.
  */
 
 static void RedrawWindow(void)
 {
-    int itemp;
+    int i, itemp, x0, y0, x1, y1;
     unsigned int width, height, utemp;
     Window wtemp;
 
     if (XGetGeometry(disp, mainWindow, &wtemp, &itemp, &itemp,
                      &width, &height, &utemp, &utemp) == 0) return;
-    XCopyArea(disp, osWindow, mainWindow, mainGC, 0, 0, width, height,
-              0, 0);
+    FlushBatch();
+    for (i = 0; i < nDamage; i++) {
+        x0 = GLMax(damage[i].x0, 0);
+        y0 = GLMax(damage[i].y0, 0);
+        x1 = GLMin(damage[i].x1, width);
+        y1 = GLMin(damage[i].y1, height);
+        if (x0 < x1 && y0 < y1) {
+            XCopyArea(disp, osWindow, mainWindow, mainGC,
+                      x0, y0, x1 - x0, y1 - y0, x0, y0);
+        }
+    }
+    nDamage = 0;
     redraw = FALSE;
 }
 
 /*
- * Functions: StartPolygon, AddSegment, EndPolygon
+ * Function: AddDamage
+ * Usage: AddDamage(x0, y0, x1, y1);
+ * ---------------------------------
+ * This function adds the box from (x0, y0) up to but not including
+ * (x1, y1) to the damage list.  A box that lies inside a rectangle
+ * already in the list changes nothing.  Otherwise, the box becomes
+ * a new entry if there is room or is merged with the rectangle
+ * whose area grows the least.
+ */
+
+static void AddDamage(int x0, int y0, int x1, int y1)
+{
+    int i, best, growth, bestGrowth;
+    boxT *bp;
+
+    if (x0 >= x1 || y0 >= y1) return;
+    for (i = 0; i < nDamage; i++) {
+        bp = &damage[i];
+        if (x0 >= bp->x0 && y0 >= bp->y0 && x1 <= bp->x1 && y1 <= bp->y1) {
+            return;
+        }
+    }
+    if (nDamage < MaxDamage) {
+        bp = &damage[nDamage++];
+        bp->x0 = x0;
+        bp->y0 = y0;
+        bp->x1 = x1;
+        bp->y1 = y1;
+        MergeDamage(nDamage - 1);
+        return;
+    }
+    best = 0;
+    bestGrowth = 0;
+    for (i = 0; i < nDamage; i++) {
+        bp = &damage[i];
+        growth = BoxArea(GLMin(x0, bp->x0), GLMin(y0, bp->y0),
+                         GLMax(x1, bp->x1), GLMax(y1, bp->y1))
+                 - BoxArea(bp->x0, bp->y0, bp->x1, bp->y1);
+        if (i == 0 || growth < bestGrowth) {
+            best = i;
+            bestGrowth = growth;
+        }
+    }
+    bp = &damage[best];
+    bp->x0 = GLMin(x0, bp->x0);
+    bp->y0 = GLMin(y0, bp->y0);
+    bp->x1 = GLMax(x1, bp->x1);
+    bp->y1 = GLMax(y1, bp->y1);
+    MergeDamage(best);
+}
+
+/*
+ * Function: MergeDamage
+ * Usage: MergeDamage(k);
+ * ----------------------
+ * This function merges into damage[k] every other rectangle in
+ * the damage list that overlaps it, repeating the process until
+ * no rectangle in the list overlaps another.
+ */
+
+static void MergeDamage(int k)
+{
+    int i;
+    bool merged;
+    boxT *bp, *kp;
+
+    do {
+        merged = FALSE;
+        kp = &damage[k];
+        for (i = 0; i < nDamage; i++) {
+            bp = &damage[i];
+            if (i == k || bp->x0 >= kp->x1 || kp->x0 >= bp->x1
+                       || bp->y0 >= kp->y1 || kp->y0 >= bp->y1) continue;
+            kp->x0 = GLMin(kp->x0, bp->x0);
+            kp->y0 = GLMin(kp->y0, bp->y0);
+            kp->x1 = GLMax(kp->x1, bp->x1);
+            kp->y1 = GLMax(kp->y1, bp->y1);
+            damage[i] = damage[--nDamage];
+            if (k == nDamage) k = i;
+            merged = TRUE;
+            break;
+        }
+    } while (merged);
+}
+
+/*
+ * Function: BoxArea
+ * Usage: area = BoxArea(x0, y0, x1, y1);
+ * --------------------------------------
+ * This function returns the area of the box from (x0, y0) up to
+ * but not including (x1, y1).
+ */
+
+static int BoxArea(int x0, int y0, int x1, int y1)
+{
+    return ((x1 - x0) * (y1 - y0));
+}
+
+/*
+ * Functions: BatchLine, BatchArc
+ * Usage: BatchLine(gc, x0, y0, x1, y1);
+ *        BatchArc(gc, x, y, width, height, start, sweep);
+ * -------------------------------------------------------
+ * These functions add a line or an arc, whose arguments have the
+ * same meaning as those of XDrawLine and XDrawArc, to the batch.
+ * If the batch uses a different GC or has no room for another
+ * primitive, it is submitted first.
+ */
+
+static void BatchLine(GC gc, int x0, int y0, int x1, int y1)
+{
+    XSegment *sp;
+
+    if (gc != batchGC || nSegments == MaxBatch) FlushBatch();
+    batchGC = gc;
+    sp = &segments[nSegments++];
+    sp->x1 = x0;
+    sp->y1 = y0;
+    sp->x2 = x1;
+    sp->y2 = y1;
+}
+
+static void BatchArc(GC gc, int x, int y, int width, int height,
+                     int start, int sweep)
+{
+    XArc *ap;
+
+    if (gc != batchGC || nArcs == MaxBatch) FlushBatch();
+    batchGC = gc;
+    ap = &arcs[nArcs++];
+    ap->x = x;
+    ap->y = y;
+    ap->width = width;
+    ap->height = height;
+    ap->angle1 = start;
+    ap->angle2 = sweep;
+}
+
+/*
+ * Function: FlushBatch
+ * Usage: FlushBatch();
+ * --------------------
+ * This function submits the lines and arcs in the batch to the
+ * server and empties the batch.
+ */
+
+static void FlushBatch(void)
+{
+    if (nSegments > 0) {
+        XDrawSegments(disp, osWindow, batchGC, segments, nSegments);
+        nSegments = 0;
+    }
+    if (nArcs > 0) {
+        XDrawArcs(disp, osWindow, batchGC, arcs, nArcs);
+        nArcs = 0;
+    }
+}
+
+/*
+ * Functions: StartPolygon, AddSegment, DisplayPolygon
  * Usage: StartPolygon();
  *        AddSegment(x0, y0, x1, y1);
  *        AddSegment(x1, y1, x2, y2);
  *        . . .
  *        DisplayPolygon();
- * -----------------------------------------------
+ * ---------------------------------------------------
  * These functions implement the notion of a region in the X
  * world, where the easiest shape to fill is a polygon.  Calling
- * StartPolygon initializes the array polygonPoints so that
+ * StartPolygon empties the array polygonPoints so that
  * subsequent calls to AddSegment will add points to it.
  * The points in the polygon are assumed to be contiguous,
  * because the client interface checks for this property.
  * Because polygons involving arcs can be quite large, the
- * AddSegment code extends the polygonPoints list if needed
- * by doubling the size of the array.  All storage is freed
- * after calling DisplayPolygon, which uses the XFillPolygon
- * call to generate the display.
+ * AddSegment code extends the polygonPoints array if needed
+ * by calling ExpandPolygon.  The array is not freed after
+ * each region but is kept for the next one, so that a program
+ * that fills many small shapes allocates it only once.
+ * DisplayPolygon uses the XFillPolygon call to generate the
+ * display, telling the server when the polygon is convex so
+ * that it can use a faster algorithm to fill it.
  */
 
 static void StartPolygon(void)
 {
-    polygonPoints = NewArray(PStartSize, XPoint);
-    polygonSize = PStartSize;
+    if (polygonPoints == NULL) {
+        polygonPoints = NewArray(PStartSize, XPoint);
+        polygonSize = PStartSize;
+    }
     nPolygonPoints = 0;
 }
 
 static void AddSegment(int x0, int y0, int x1, int y1)
 {
-    XPoint *newPolygon;
-    int i;
-
-    if (nPolygonPoints >= polygonSize) {
-        polygonSize *= 2;
-        newPolygon = NewArray(polygonSize, XPoint);
-        for (i = 0; i < nPolygonPoints; i++) {
-            newPolygon[i] = polygonPoints[i];
-        }
-        FreeBlock(polygonPoints);
-        polygonPoints = newPolygon;
+    if (nPolygonPoints + 2 > polygonSize) {
+        ExpandPolygon(nPolygonPoints + 2);
     }
     if (nPolygonPoints == 0) {
         polygonPoints[nPolygonPoints].x = x0;
@@ -871,8 +1157,12 @@ static void AddSegment(int x0, int y0, int x1, int y1)
 static void DisplayPolygon(void)
 {
     GC fillGC;
-    int i, px;
+    boxT bbox;
+    bool convex;
+    int px;
 
+    if (nPolygonPoints == 0) return;
+    FlushBatch();
     if (eraseMode) {
         fillGC = eraseGC;
     } else {
@@ -882,12 +1172,117 @@ static void DisplayPolygon(void)
     }
     if (polygonPoints[0].x != polygonPoints[nPolygonPoints-1].x
         || polygonPoints[0].y != polygonPoints[nPolygonPoints-1].y) {
+        if (nPolygonPoints == polygonSize) {
+            ExpandPolygon(nPolygonPoints + 1);
+        }
         polygonPoints[nPolygonPoints++] = polygonPoints[0];
     }
+    convex = ExaminePolygon(polygonPoints, nPolygonPoints, &bbox);
     XFillPolygon(disp, osWindow, fillGC,
                  polygonPoints, nPolygonPoints,
-                 Complex, CoordModeOrigin);
+                 (convex) ? Convex : Complex,
+                 CoordModeOrigin);
+    AddDamage(bbox.x0, bbox.y0, bbox.x1, bbox.y1);
+}
+
+/*
+ * Function: ExpandPolygon
+ * Usage: ExpandPolygon(minSize);
+ * ------------------------------
+ * This function makes room in polygonPoints for at least minSize
+ * points by doubling the size of the array as many times as
+ * necessary and copying the existing points to the new array.
+ */
+
+static void ExpandPolygon(int minSize)
+{
+    XPoint *newPolygon;
+    int newSize;
+
+    newSize = polygonSize;
+    while (newSize < minSize) newSize *= 2;
+    newPolygon = NewArray(newSize, XPoint);
+    memcpy(newPolygon, polygonPoints, nPolygonPoints * sizeof (XPoint));
     FreeBlock(polygonPoints);
+    polygonPoints = newPolygon;
+    polygonSize = newSize;
+}
+
+/*
+ * Function: ExaminePolygon
+ * Usage: convex = ExaminePolygon(points, n, &bbox);
+ * -------------------------------------------------
+ * This function stores the bounding box of the closed polygon
+ * whose n points begin and end at the same place in bbox and
+ * returns TRUE if the polygon is convex, making a single pass over
+ * the points to find both.  Going around a convex polygon, every
+ * corner turns in the same direction, which is the sign of the
+ * cross product of the edges that meet there, and the edges change
+ * between moving left and moving right at most twice.  The second
+ * test rejects polygons, such as a five-pointed star, that turn the
+ * same way at every corner but wind around more than once.  Edges
+ * of zero length are ignored, and an edge that doubles back on the
+ * previous one makes the polygon Complex.  The first loop finds the
+ * last edge and the last horizontal direction, so that the main
+ * loop checks every corner, including the one at which the polygon
+ * closes.  The main loop records what it finds rather than
+ * returning early, which keeps it free of branches that are hard to
+ * predict.  Because the coordinates are 16 bits, the products are
+ * exact in 64-bit integers.  Polygons with more than MaxConvexTest
+ * points are reported as Complex without being tested.  Filling
+ * one takes the server long enough that the hint saves little, and
+ * the small shapes that are drawn in large numbers are well below
+ * that size.  The function errs only on the side of reporting
+ * Complex, which is always safe to pass to the server.
+ */
+
+static bool ExaminePolygon(XPoint points[], int n, boxT *bbox)
+{
+    int i, x, y, x0, y0, x1, y1, dx, dy, pdx, pdy, lastdx, xFlips;
+    int64_t cross, dot;
+    bool examine, left, right, reversed;
+
+    examine = (n <= MaxConvexTest);
+    pdx = pdy = lastdx = 0;
+    for (i = n - 1; examine && i > 0 && lastdx == 0; i--) {
+        dx = points[i].x - points[i - 1].x;
+        dy = points[i].y - points[i - 1].y;
+        if (pdx == 0 && pdy == 0) {
+            pdx = dx;
+            pdy = dy;
+        }
+        lastdx = dx;
+    }
+    left = right = reversed = FALSE;
+    xFlips = 0;
+    x0 = x1 = points[0].x;
+    y0 = y1 = points[0].y;
+    for (i = 1; i < n; i++) {
+        x = points[i].x;
+        y = points[i].y;
+        if (x < x0) x0 = x;
+        if (x > x1) x1 = x;
+        if (y < y0) y0 = y;
+        if (y > y1) y1 = y;
+        if (!examine) continue;
+        dx = x - points[i - 1].x;
+        dy = y - points[i - 1].y;
+        if (dx == 0 && dy == 0) continue;
+        cross = (int64_t) pdx * dy - (int64_t) pdy * dx;
+        dot = (int64_t) pdx * dx + (int64_t) pdy * dy;
+        left |= (cross > 0);
+        right |= (cross < 0);
+        reversed |= (cross == 0 && dot < 0);
+        xFlips += ((int64_t) lastdx * dx < 0);
+        lastdx = (dx != 0) ? dx : lastdx;
+        pdx = dx;
+        pdy = dy;
+    }
+    bbox->x0 = x0;
+    bbox->y0 = y0;
+    bbox->x1 = x1 + 1;
+    bbox->y1 = y1 + 1;
+    return (examine && !(left && right) && !reversed && xFlips <= 2);
 }
 
 /*
@@ -896,31 +1291,58 @@ static void DisplayPolygon(void)
  * ---------------------------------------------
  * This function is identical to the XDDrawArc function except
  * that the arc is rendered using line segments as part of a
- * polygonal region.
+ * polygonal region.  The arc is divided into n equal steps, where
+ * n is the smallest number for which no chord strays more than
+ * MaxArcError pixels from the arc.  Rather than calling cos and
+ * sin at every step, the function rotates the point (c, s) on the
+ * unit circle by the angle of one step, computing only the last
+ * point directly so that the arc ends exactly where it should.
+ * Points that round to the same pixel as the previous point are
+ * skipped, except that a region always receives at least one
+ * point.
  */
 
 static void RenderArc(double x, double y, double rx, double ry,
                       double start, double sweep)
 {
-    double t, mint, maxt, dt;
-    int ix0, iy0, ix1, iy1;
+    double r, mint, maxt, dt, c, s, cdt, sdt, temp;
+    int i, n, ix0, iy0, ix1, iy1;
 
     if (sweep < 0) {
         start += sweep;
         sweep = -sweep;
     }
-    dt = atan2(InchesY(1), GLMaxF(fabs(rx), fabs(ry)));
     mint = GLRadians(start);
     maxt = GLRadians(start + sweep);
-    ix0 = ScaleX(x + rx * cos(mint));
-    iy0 = ScaleY(y + ry * sin(mint));
-    for (t = mint + dt; t < maxt; t += dt) {
-        if (t > maxt - dt / 2) t = maxt;
-        ix1 = ScaleX(x + rx * cos(t));
-        iy1 = ScaleY(y + ry * sin(t));
-        AddSegment(ix0, iy0, ix1, iy1);
-        ix0 = ix1;
-        iy0 = iy1;
+    r = GLMaxF(fabs(rx) * xdpi, fabs(ry) * ydpi);
+    n = 1;
+    if (r > MaxArcError) {
+        n = (int) ceil((maxt - mint) / (2 * acos(1 - MaxArcError / r)));
+        n = GLMax(n, 1);
+    }
+    dt = (maxt - mint) / n;
+    c = cos(mint);
+    s = sin(mint);
+    cdt = cos(dt);
+    sdt = sin(dt);
+    ix0 = ScaleX(x + rx * c);
+    iy0 = ScaleY(y + ry * s);
+    for (i = 1; i <= n; i++) {
+        if (i == n) {
+            c = cos(maxt);
+            s = sin(maxt);
+        } else {
+            temp = c * cdt - s * sdt;
+            s = s * cdt + c * sdt;
+            c = temp;
+        }
+        ix1 = ScaleX(x + rx * c);
+        iy1 = ScaleY(y + ry * s);
+        if (ix1 != ix0 || iy1 != iy0 || (i == n && nPolygonPoints == 0)) {
+            AddSegment(ix0, iy0, ix1, iy1);
+            ix0 = ix1;
+            iy0 = iy1;
+        }
     }
 }
 
@@ -12,6 +12,12 @@
  * is that the graphics.h functions simply send commands down a
  * communication channel, while the xdisplay.h functions actually
  * perform the rendering operations for the X window manager.
+ *
+ * The interface has two implementations.  The xdisplay.c file
+ * draws into a window on an X server.  The fbdisplay.c file draws
+ * into a framebuffer in memory instead, so that programs can run
+ * on machines that have no display; it is used by linking with
+ * the headless version of the library.
  */
 
 #ifndef _xdisplay_h
@@ -45,11 +51,25 @@ void XDCloseDisplay(void);
  * Usage: fd = XDDisplayFD();
  * --------------------------
  * This function returns the Unix file descriptor of the X
- * connection to the graphics window display.
+ * connection to the graphics window display, or -1 if the
+ * display has no connection to a server.
  */
 
 int XDDisplayFD(void);
 
+/*
+ * Function: XDEventsQueued
+ * Usage: if (XDEventsQueued()) . . .
+ * ----------------------------------
+ * This function returns TRUE if X events have already been read
+ * from the connection and are waiting to be processed.  Such
+ * events do not make the file descriptor returned by XDDisplayFD
+ * readable, so a thread that sleeps in poll on that descriptor
+ * must be woken in some other way.
+ */
+
+bool XDEventsQueued(void);
+
 /*
  * Function: XDProcessXEvent
  * Usage: if (XDProcessXEvent()) . . .
@@ -40,383 +40,1172 @@
  *
  * The two processes communicate by means of pipes running in
  * each direction.  The client communicates with the X manager by
- * sending commands over its output pipe.  The command format
- * consists of ASCII text lines in the following format:
+ * sending commands over its output pipe.  Each command is a
+ * fixed-size binary record of type messageT, which contains the
+ * command number, the numeric arguments as doubles, and the
+ * length of an optional text argument, whose characters follow
+ * the record in the pipe.  Since both processes are forks of the
+ * same program, the record layout is identical on both sides,
+ * and neither side needs to format or parse numbers as text.
  *
- *       LLLCC XXXXXX
+ * Some client operations require a response from the X manager.
+ * These operations call XMGetResponse() to read the response,
+ * which has the same format as a command but no command number.
  *
- * where LLL is a three-digit length field giving the length of
- * the entire line (including the newline), CC is a two-digit
- * field specifying the command number and XXXXXX is an arbitrary
- * text string specifying arguments to the command.  The length
- * of the text string can be determined from the line length
- * indicator.
+ * Drawing commands do not require a response, so the client
+ * collects them in a buffer rather than writing each one to the
+ * pipe as it is issued.  A program that draws a fractal may
+ * issue a million commands, and writing them one at a time would
+ * require a million system calls.  The buffer is flushed when the
+ * client needs a response, when the client calls UpdateDisplay
+ * (which Pause also calls) or ExitGraphics, when the buffer is
+ * full, and when the program exits.  So that drawing does not
+ * stall when a program stops issuing commands for a while, a
+ * separate thread in the client also flushes any command that
+ * has been waiting for longer than FlushDelay.  The X manager
+ * reads the pipe in large blocks as well, and processes every
+ * command it has received before it returns to the event loop.
  *
- * Some client operations require a response from the X manager.
- * These operations call XMGetResponse() to read a line from the
- * client.  Because this operation is synchronous, there is no
- * need for the more cumbersome form used in the opposite
- * direction.
+ * If the environment variable GRAPHICS_TRANSPORT is set to shm,
+ * commands travel instead through a ring buffer in memory shared
+ * by the two forks, which XMInitialize maps before the fork.  The
+ * client copies each flush into the ring and the X manager copies
+ * commands out of it, so the commands never pass through the
+ * kernel.  The only system calls are the wake-ups: the client
+ * writes to an eventfd only when the X manager has announced that
+ * it is about to sleep, and the X manager does the same for a
+ * client that is waiting for space in a full ring.  The pipes
+ * remain in place to carry responses and so that the X manager
+ * still sees end of file when the client exits.  If the shared
+ * ring cannot be created, the pipes are used for everything.
+ *
+ * If GRAPHICS_TRANSPORT is set to thread, XMInitialize does not
+ * fork at all.  The X manager runs instead as a second thread in
+ * the same process and reads drawing commands from the same ring,
+ * which the two threads share simply because they share memory.
+ * Every call to the xdisplay module is made while holding
+ * displayLock.  The X manager holds the lock except while it
+ * sleeps, which allows the client to answer a query such as
+ * TextStringWidth without waking the X manager at all: the client
+ * takes the lock, executes the commands still waiting in the ring
+ * and in its own buffer, including the query itself, and finds
+ * the response in a reply record.  The X manager uses the same
+ * reply record for the responses it sends later, which release a
+ * client waiting for the mouse.  At exit, the client closes its
+ * end of the pipe and waits for the X manager thread to finish,
+ * so that the window behaves as it does in the other modes.
+ *
+ * The X manager sleeps in poll on a fixed set of descriptors: the
+ * X connection, the input pipe, and, with the shm and thread
+ * transports, the eventfd that the client signals.  Each time it
+ * wakes, it processes every pending X event and every command
+ * that has arrived, and it never wakes on a timer unless a redraw
+ * is pending.  Drawing commands schedule a redraw, which happens
+ * as soon as the commands have been processed, unless the window
+ * was redrawn less than RedrawInterval ago, in which case the
+ * redraw waits until that interval has passed.  Thus an isolated
+ * change appears on the screen immediately, while a program that
+ * draws continuously sees its window redrawn at a steady rate.
  *
  * This interface is used by both the client side (graphics.c)
  * and the X manager side (xmanager.c), but it is important to
  * remember that the two are running in different forks.  For
- * each fork, the inPipe and outPipe variables correspond to
- * the local perspective.  Thus, reading is always performed
- * on inPipe and writing is performed on outPipe.  The ends
- * of the pipe are crossed between the processes so that data
- * that is written to outPipe by one fork appears in inPipe
- * on the other side.
+ * each fork, the infd and outfd variables correspond to the
+ * local perspective.  Thus, reading is always performed on
+ * infd and writing is performed on outfd.  The ends of the
+ * pipe are crossed between the processes so that data that
+ * is written to outfd by one fork appears in infd on the
+ * other side.
  */
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <signal.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdatomic.h>
 #include <sys/time.h>
 #include <sys/types.h>
+#include <sys/mman.h>
+#ifdef __linux__
+#  include <sys/eventfd.h>
+#endif
 
 #include "genlib.h"
 #include "exception.h"
 #include "simpio.h"
 #include "xmanager.h"
 #include "xdisplay.h"
-#include "xcompat.h"
 #include "glibrary.h"
 
-/* Constants */
+/*
+ * Constants
+ * ---------
+ * RedrawInterval -- Shortest time in seconds between redraws
+ * PipeBufferSize -- Size of the input and output buffers for the pipes
+ * FlushDelay     -- Longest time in seconds a command waits in a buffer
+ * RingSize       -- Size of the shared ring used by the shm transport
+ * CacheLineSize  -- Padding that separates the two ends of the ring
+ * TransportVar   -- Environment variable that selects the transport
+ */
+
+#define RedrawInterval 0.02
+#define PipeBufferSize 65536
+#define FlushDelay 0.02
+#define RingSize (1 << 20)
+#define CacheLineSize 64
+#define TransportVar "GRAPHICS_TRANSPORT"
+
+/*
+ * Type: messageT
+ * --------------
+ * Every message in either direction begins with a record of this
+ * type.  The cmd field is the commandT value of a command and is
+ * unused in a response.  The args field holds the numeric
+ * arguments or results, and the length field gives the number of
+ * characters of text that follow the record.  The record always
+ * includes MaxCommandArgs arguments so that its size is fixed.
+ */
+
+typedef struct {
+    int cmd;
+    int length;
+    double args[MaxCommandArgs];
+} messageT;
+
+/*
+ * Type: ringT
+ * -----------
+ * This type is the shared ring buffer used by the shm transport.
+ * The head and tail fields count the bytes ever read and written,
+ * so the ring holds tail - head bytes starting at the index
+ * head % RingSize.  Only the X manager advances head, and only
+ * the client advances tail.  Each side sets its waiting flag
+ * before it sleeps on its eventfd, and the other side writes to
+ * that eventfd only if it finds the flag set.  The padding keeps
+ * the two ends of the ring in separate cache lines.
+ */
 
-#define ClientTimeout 0.05
+typedef struct {
+    atomic_ulong head;
+    atomic_int clientWaiting;
+    char pad1[CacheLineSize];
+    atomic_ulong tail;
+    atomic_int managerWaiting;
+    char pad2[CacheLineSize];
+    char data[RingSize];
+} ringT;
 
-/* Private state variables */
+/*
+ * Private state variables
+ * -----------------------
+ * infd, outfd  -- File descriptors for the pipes in each direction
+ * child        -- Process id of the client, used by the X manager
+ * inBuffer     -- Data read from infd but not yet used
+ * inStart      -- Index of the first unused byte in inBuffer
+ * inCount      -- Number of unused bytes in inBuffer
+ * outBuffer    -- Messages waiting to be written to outfd
+ * outCount     -- Number of bytes in outBuffer
+ * outStart     -- Time at which the oldest buffered message was added
+ * flushStarted -- TRUE once the client has started its flush thread
+ * flushIdle    -- TRUE while the flush thread waits for a command
+ * threadMode   -- TRUE if the X manager is a thread in this process
+ * manager      -- The X manager thread in thread mode
+ * reply        -- The response most recently posted in thread mode
+ * replyText    -- The text of that response
+ * replyReady   -- TRUE if the reply has not yet been read
+ * replyLock    -- Lock protecting the reply in thread mode
+ * replyPosted  -- Condition signaled when a reply is posted
+ * displayLock  -- Lock held by the thread calling the xdisplay module
+ * outRing      -- Shared ring to which the client writes, or NULL
+ * inRing       -- Shared ring from which the X manager reads, or NULL
+ * wakefd       -- Eventfd on which the X manager waits for commands
+ * spacefd      -- Eventfd on which the client waits for space
+ * redrawPending -- TRUE if the X manager has scheduled a redraw
+ * redrawTime   -- Time at which the scheduled redraw is due
+ * lastRedraw   -- Time of the most recent redraw
+ * outLock      -- Lock protecting the output buffer in the client
+ * outPending   -- Condition signaled when the output buffer is used
+ * message      -- The command most recently read by the X manager
+ * cmdBuffer    -- The text of that command
+ * exitGraphicsFlag -- TRUE if the client has called ExitGraphics
+ */
 
-static FILE *inPipe, *outPipe;
-static int infd;
+static int infd, outfd;
 static pid_t child;
 
+static char inBuffer[PipeBufferSize];
+static int inStart, inCount;
+
+static char outBuffer[PipeBufferSize];
+static int outCount;
+static double outStart;
+static bool flushStarted = FALSE;
+static bool flushIdle = FALSE;
+static pthread_mutex_t outLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t outPending;
+
+static bool threadMode = FALSE;
+static pthread_t manager;
+static messageT reply;
+static char replyText[CommandBufferSize];
+static bool replyReady = FALSE;
+static pthread_mutex_t replyLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t replyPosted = PTHREAD_COND_INITIALIZER;
+static pthread_mutex_t displayLock = PTHREAD_MUTEX_INITIALIZER;
+
+static ringT *outRing, *inRing;
+static int wakefd, spacefd;
+
+static bool redrawPending = FALSE;
+static double redrawTime, lastRedraw;
+
+static messageT message;
 static char cmdBuffer[CommandBufferSize];
 
 static bool exitGraphicsFlag;
 
 /* Private function prototypes */
 
+static void RunManager(void);
+static void *ManagerThread(void *arg);
 static void MainEventLoop(void);
+static bool ProcessInput(void);
+static void ScheduleRedraw(void);
+static void RunCommands(void);
+static bool StartWait(void);
+static void EndWait(bool signaled);
+static void SendResponse(double args[], int nargs, string text);
+static void PostReply(double args[], int nargs, string text);
+static void PutMessage(int cmd, double args[], int nargs, string text);
+static void FlushOutput(void);
+static void StartFlushThread(void);
+static void *FlushThread(void *arg);
+static void FlushAtExit(void);
+static double CurrentTime(void);
+static ringT *OpenRing(void);
+static void RingWrite(char *src, int nbytes);
+static int RingRead(char *dst, int max);
+static void SignalEvent(int fd);
+static void ClearEvent(int fd);
 static bool ReadMessage(void);
+static bool ReadBytes(void *dst, int nbytes);
 static void ProcessMessage(void);
-static void LineMessage(string args);
-static void ArcMessage(string args);
-static void TextMessage(string args);
-static void WidthMessage(string args);
-static void FontMetricsMessage(string args);
-static void SetEraseMessage(string args);
-static void StartRegionMessage(string args);
-static void EndRegionMessage(string args);
-static void ClearMessage(string args);
-static void UpdateMessage(string args);
-static void SetTitleMessage(string args);
-static void SetFontMessage(string args);
-static void GetMouseMessage(string args);
-static void WaitForMouseMessage(string args);
-static void SetColorMessage(string args);
+static void LineMessage(double args[], string text);
+static void ArcMessage(double args[], string text);
+static void TextMessage(double args[], string text);
+static void WidthMessage(double args[], string text);
+static void FontMetricsMessage(double args[], string text);
+static void SetEraseMessage(double args[], string text);
+static void StartRegionMessage(double args[], string text);
+static void EndRegionMessage(double args[], string text);
+static void ClearMessage(double args[], string text);
+static void UpdateMessage(double args[], string text);
+static void SetTitleMessage(double args[], string text);
+static void SetFontMessage(double args[], string text);
+static void GetMouseMessage(double args[], string text);
+static void WaitForMouseMessage(double args[], string text);
+static void SetColorMessage(double args[], string text);
 
 /* Exported entries */
 
 void XMInitialize(string title)
 {
     int p1[2], p2[2];
+    ringT *ring;
 
     XDOpenDisplay(title);
     pipe(p1);
+    ring = OpenRing();
+    if (threadMode) {
+        infd = p1[0];
+        outfd = p1[1];
+        inRing = outRing = ring;
+        if (pthread_create(&manager, NULL, ManagerThread, NULL) != 0) {
+            Error("Can't create X manager thread");
+        }
+        atexit(FlushAtExit);
+        return;
+    }
     pipe(p2);
     if ((child = fork()) == 0) {
         close(p1[0]);
         close(p2[1]);
-        inPipe = fdopen(p2[0], "r");
-        if (inPipe == NULL) Error("Can't open pipe from X client");
-        outPipe = fdopen(p1[1], "w");
-        if (outPipe == NULL) Error("Can't open pipe to X client");
+        infd = p2[0];
+        outfd = p1[1];
+        outRing = ring;
+        atexit(FlushAtExit);
     } else {
         close(p1[1]);
         close(p2[0]);
         infd = p1[0];
-        outPipe = fdopen(p2[1], "w");
-        if (outPipe == NULL) Error("Can't open output pipe in X client");
-        exitGraphicsFlag = FALSE;
-        try {
-            MainEventLoop();
-          except(ErrorException)
-            fprintf(stderr, "Error: %s\n", (string) GetExceptionValue());
-            XDCloseDisplay();
-            kill(child, SIGKILL);
-            exit(1);
-        } endtry
-        (void) waitpid(child, NULL, 0);
-        if (!exitGraphicsFlag) {
-            printf("Press return to exit.\n");
-            infd = 0;
-            MainEventLoop();
-        }
-        XDCloseDisplay();
+        outfd = p2[1];
+        inRing = ring;
+        RunManager();
         exit(0);
     }
 }
 
-void XMSendCommand(commandT cmd, string args)
-{
-    int len;
+/*
+ * Function: XMSendCommand
+ * -----------------------
+ * This function adds the command to the output buffer, which is
+ * flushed immediately only for the commands that mark the end of
+ * a stage of drawing.  If the buffer was empty and the flush
+ * thread is idle, the thread is signaled so that it can set the
+ * time of its next flush.  A thread that is already waiting for
+ * a deadline needs no signal, which matters for programs that
+ * make many round trips, since each signal would otherwise wake
+ * the thread only to find the buffer already flushed.
+ */
 
-    len = strlen(args) + 4;
-    fprintf(outPipe, "%3d%2d %s\n", len, (int) cmd, args);
-    fflush(outPipe);
+void XMSendCommand(commandT cmd, double args[], int nargs, string text)
+{
+    pthread_mutex_lock(&outLock);
+    if (!flushStarted) StartFlushThread();
+    if (outCount == 0) {
+        outStart = CurrentTime();
+        if (flushIdle) pthread_cond_signal(&outPending);
+    }
+    PutMessage((int) cmd, args, nargs, text);
+    if (cmd == UpdateCmd || cmd == ExitGraphicsCmd) FlushOutput();
+    pthread_mutex_unlock(&outLock);
 }
 
-void XMGetResponse(char buffer[])
+/*
+ * Function: XMGetResponse
+ * -----------------------
+ * This function flushes any buffered commands, which include the
+ * command that requires the response, and then reads the response.
+ * In thread mode, the client executes the buffered commands itself
+ * and then takes the response from the reply record.
+ */
+
+void XMGetResponse(double results[], char buffer[])
 {
-    fgets(buffer, CommandBufferSize - 1, inPipe);
+    messageT response;
+    char text[CommandBufferSize];
+
+    pthread_mutex_lock(&outLock);
+    if (threadMode) {
+        pthread_mutex_lock(&displayLock);
+        RunCommands();
+        pthread_mutex_unlock(&displayLock);
+    } else {
+        FlushOutput();
+    }
+    pthread_mutex_unlock(&outLock);
+    if (threadMode) {
+        pthread_mutex_lock(&replyLock);
+        while (!replyReady) pthread_cond_wait(&replyPosted, &replyLock);
+        response = reply;
+        strcpy(text, replyText);
+        replyReady = FALSE;
+        pthread_mutex_unlock(&replyLock);
+    } else {
+        if (!ReadBytes(&response, sizeof response)) {
+            Error("Unexpected end of file");
+        }
+        if (response.length < 0 || response.length >= CommandBufferSize) {
+            Error("Internal error: Illegal response length");
+        }
+        if (!ReadBytes(text, response.length)) {
+            Error("Unexpected end of file");
+        }
+        text[response.length] = '\0';
+    }
+    if (results != NULL) {
+        memcpy(results, response.args, sizeof response.args);
+    }
+    if (buffer != NULL) strcpy(buffer, text);
 }
 
 void XMReleaseClient(void)
 {
-    fprintf(outPipe, "\n");
-    fflush(outPipe);
+    SendResponse(NULL, 0, NULL);
 }
 
 /* Private functions */
 
+/*
+ * Function: RunManager
+ * Usage: RunManager();
+ * --------------------
+ * This function runs the X manager, either in the parent fork or
+ * in the X manager thread.  It processes events and commands until
+ * the client exits and then, unless the client called
+ * ExitGraphics, keeps the window on the screen until the user
+ * presses return.  A display without a connection to a server,
+ * such as the headless one in fbdisplay.c, has no window to keep,
+ * so the X manager closes it at once.
+ */
+
+static void RunManager(void)
+{
+    exitGraphicsFlag = FALSE;
+    try {
+        MainEventLoop();
+      except(ErrorException)
+        fprintf(stderr, "Error: %s\n", (string) GetExceptionValue());
+        XDCloseDisplay();
+        if (!threadMode) kill(child, SIGKILL);
+        exit(1);
+    } endtry
+    if (!threadMode) (void) waitpid(child, NULL, 0);
+    if (!exitGraphicsFlag && XDDisplayFD() >= 0) {
+        printf("Press return to exit.\n");
+        infd = 0;
+        inRing = NULL;
+        MainEventLoop();
+    }
+    XDCloseDisplay();
+}
+
+/*
+ * Function: ManagerThread
+ * Usage: pthread_create(&manager, NULL, ManagerThread, NULL);
+ * -----------------------------------------------------------
+ * This function is the body of the X manager thread.
+ */
+
+static void *ManagerThread(void *arg)
+{
+    RunManager();
+    return (NULL);
+}
+
+/*
+ * Function: MainEventLoop
+ * Usage: MainEventLoop();
+ * -----------------------
+ * This function is the event loop of the X manager, which is
+ * described in the implementation notes at the beginning of the
+ * file.  Each cycle processes the pending X events, performs a
+ * redraw if one is due, and then either processes the commands
+ * that have arrived or sleeps until something happens.  The loop
+ * returns at the end of the input.
+ */
+
 static void MainEventLoop(void)
 {
-    struct timeval tv, *tvp;
-    int xfd, width, sc;
-    fd_set readmask, readset;
-    string message;
-
-    xfd = XDDisplayFD();
-    tv.tv_sec = ClientTimeout;
-    tv.tv_usec = ((int) (ClientTimeout * 1000000)) % 1000000;
-    FD_ZERO(&readmask);
-    FD_SET(xfd, &readmask);
-    FD_SET(infd, &readmask);
-    width = GLMax(xfd, infd) + 1;
-    tvp = &tv;
+    struct pollfd fds[3];
+    int i, nfds, timeout;
+    double now;
+
+    fds[0].fd = XDDisplayFD();
+    fds[1].fd = infd;
+    fds[2].fd = wakefd;
+    nfds = (inRing == NULL) ? 2 : 3;
+    for (i = 0; i < nfds; i++) {
+        fds[i].events = POLLIN;
+    }
+    pthread_mutex_lock(&displayLock);
     while (TRUE) {
-        if (XDProcessXEvent()) {
-            tvp = &tv;
-        } else {
-            readset = readmask;
-            sc = select(width, &readset, NULL, NULL, tvp);
-            tvp = (sc == 0) ? NULL : &tv;
-            if (sc == 0) {
-                XDCheckForRedraw();
-            } else if (FD_ISSET(infd, &readset)) {
-                if (!ReadMessage()) {
-                    XDCheckForRedraw();
-                    return;
-                }
-                ProcessMessage();
-                XDSetRedrawFlag();
+        while (XDProcessXEvent());
+        now = CurrentTime();
+        if (redrawPending && now >= redrawTime) {
+            XDCheckForRedraw();
+            redrawPending = FALSE;
+            lastRedraw = now;
+        }
+        if (!StartWait()) {
+            if (!ProcessInput()) break;
+            continue;
+        }
+        timeout = -1;
+        if (redrawPending) timeout = (int) ((redrawTime - now) * 1000) + 1;
+        pthread_mutex_unlock(&displayLock);
+        if (poll(fds, nfds, timeout) < 0) {
+            for (i = 0; i < nfds; i++) {
+                fds[i].revents = 0;
             }
         }
+        pthread_mutex_lock(&displayLock);
+        EndWait(nfds > 2 && (fds[2].revents & POLLIN));
+        if ((fds[1].revents & (POLLIN | POLLHUP))
+              || (inRing != NULL
+                  && atomic_load(&inRing->tail)
+                     != atomic_load(&inRing->head))) {
+            if (!ProcessInput()) break;
+        }
     }
+    pthread_mutex_unlock(&displayLock);
 }
 
-static bool ReadMessage(void)
+/*
+ * Function: ProcessInput
+ * Usage: if (ProcessInput()) . . .
+ * --------------------------------
+ * This function processes the commands that have arrived from
+ * the client, continuing until it has used the block of input
+ * most recently read.  The function returns FALSE at the end of
+ * the input.
+ */
+
+static bool ProcessInput(void)
 {
-    int len;
-    char lbuf[4];
+    do {
+        if (!ReadMessage()) {
+            XDCheckForRedraw();
+            return (FALSE);
+        }
+        ProcessMessage();
+    } while (inCount > 0);
+    ScheduleRedraw();
+    return (TRUE);
+}
 
-    if (infd == 0) {
-        FreeBlock(GetLine());
-        return (FALSE);
+/*
+ * Function: ScheduleRedraw
+ * Usage: ScheduleRedraw();
+ * ------------------------
+ * This function records that the window has changed and, unless
+ * a redraw is already pending, schedules one for the current time
+ * or for RedrawInterval after the previous redraw, whichever is
+ * later.
+ */
+
+static void ScheduleRedraw(void)
+{
+    XDSetRedrawFlag();
+    if (!redrawPending) {
+        redrawPending = TRUE;
+        redrawTime = GLMaxF(CurrentTime(), lastRedraw + RedrawInterval);
     }
-    if (read(infd, lbuf, 3) == 0) return (FALSE);
-    lbuf[3] = '\0';
-    len = atoi(lbuf);
-    if (read(infd, cmdBuffer, len) != len) {
-        Error("Unexpected end of file");
+}
+
+/*
+ * Function: RunCommands
+ * Usage: RunCommands();
+ * ---------------------
+ * This function is called by the client in thread mode, holding
+ * both outLock and displayLock, to execute the commands that the
+ * X manager has not yet processed: first those in the ring and
+ * then those in the client's own buffer, which moves directly to
+ * the input buffer without passing through the ring.  If any of
+ * the commands draw, the function schedules a redraw and wakes
+ * the X manager, if it is asleep, so that it redraws the window.
+ * A query such as GetMouseCmd makes a round trip to the server,
+ * during which Xlib reads any events that have arrived, including
+ * the Expose event that ForceRedraw sends to itself.  Those events
+ * wait in the queue that Xlib keeps rather than on the connection,
+ * where the X manager's poll would see them, so the function also
+ * wakes the X manager if any events are queued.  A client that
+ * only asks questions otherwise never wakes the X manager.
+ */
+
+static void RunCommands(void)
+{
+    bool drawn;
+
+    drawn = FALSE;
+    while (TRUE) {
+        while (inCount > 0
+               || atomic_load(&inRing->tail) != atomic_load(&inRing->head)) {
+            (void) ReadMessage();
+            ProcessMessage();
+            switch ((commandT) message.cmd) {
+              case WidthCmd: case FontMetricsCmd: case GetMouseCmd: break;
+              default: drawn = TRUE; break;
+            }
+        }
+        if (outCount == 0) break;
+        memcpy(inBuffer, outBuffer, outCount);
+        inStart = 0;
+        inCount = outCount;
+        outCount = 0;
     }
-    if (cmdBuffer[len-1] != '\n') {
-        Error("Unexpected end of command");
+    if (drawn) ScheduleRedraw();
+    if (drawn || XDEventsQueued()) {
+        if (atomic_exchange(&inRing->managerWaiting, 0)) {
+            SignalEvent(wakefd);
+        }
     }
-    cmdBuffer[len-1] = '\0';
-    return (TRUE);
 }
 
-static void ProcessMessage(void)
+/*
+ * Function: StartWait
+ * Usage: if (StartWait()) . . .
+ * -----------------------------
+ * This function is called by the X manager before it sleeps in
+ * poll.  With the shm and thread transports, it announces that the X
+ * manager is about to sleep, so that the client will signal
+ * wakefd when it adds commands to the ring.  Because commands may
+ * have arrived before the announcement, the function then checks
+ * the ring and returns FALSE, withdrawing the announcement, if
+ * commands are waiting.  Otherwise, it returns TRUE.
+ */
+
+static bool StartWait(void)
 {
-    int id;
-    string args;
-
-    args = cmdBuffer + 3;
-    sscanf(cmdBuffer, "%d", &id);
-    switch ((commandT) id) {
-      case LineCmd: LineMessage(args); break;
-      case ArcCmd: ArcMessage(args); break;
-      case TextCmd: TextMessage(args); break;
-      case WidthCmd: WidthMessage(args); break;
-      case FontMetricsCmd: FontMetricsMessage(args); break;
-      case SetEraseCmd: SetEraseMessage(args); break;
-      case StartRegionCmd: StartRegionMessage(args); break;
-      case EndRegionCmd: EndRegionMessage(args); break;
-      case ClearCmd: ClearMessage(args); break;
-      case UpdateCmd: UpdateMessage(args); break;
-      case SetTitleCmd: SetTitleMessage(args); break;
-      case SetFontCmd: SetFontMessage(args); break;
-      case GetMouseCmd: GetMouseMessage(args); break;
-      case WaitForMouseCmd: WaitForMouseMessage(args); break;
-      case SetColorCmd: SetColorMessage(args); break;
-      case ExitGraphicsCmd: exitGraphicsFlag = TRUE; break;
-      default: Error("Internal error: Illegal command"); break;
+    if (inRing == NULL) return (TRUE);
+    atomic_store(&inRing->managerWaiting, 1);
+    if (atomic_load(&inRing->tail) == atomic_load(&inRing->head)) {
+        return (TRUE);
     }
+    atomic_store(&inRing->managerWaiting, 0);
+    return (FALSE);
 }
 
-static void LineMessage(string args)
+/*
+ * Function: EndWait
+ * Usage: EndWait(signaled);
+ * -------------------------
+ * This function is called by the X manager when poll returns.
+ * With the shm and thread transports, it withdraws the
+ * announcement made by StartWait and, if signaled is TRUE,
+ * clears wakefd, which the client has signaled.
+ */
+
+static void EndWait(bool signaled)
 {
-    int n;
-    double x, y, dx, dy;
+    if (inRing == NULL) return;
+    atomic_store(&inRing->managerWaiting, 0);
+    if (signaled) ClearEvent(wakefd);
+}
+
+/*
+ * Function: SendResponse
+ * Usage: SendResponse(args, nargs, text);
+ * ---------------------------------------
+ * This function is used by the X manager to send a response to
+ * the client, which is waiting for it, so the response is written
+ * to the pipe immediately.  In thread mode, the response is posted
+ * to the reply record instead.
+ */
 
-    n = sscanf(args, "%lg %lg %lg %lg", &x, &y, &dx, &dy);
-    if (n != 4) {
-        Error("Internal error: Bad arguments to LineCmd");
+static void SendResponse(double args[], int nargs, string text)
+{
+    if (threadMode) {
+        PostReply(args, nargs, text);
+    } else {
+        PutMessage(0, args, nargs, text);
+        FlushOutput();
     }
-    XDDrawLine(x, y, dx, dy);
 }
 
-static void ArcMessage(string args)
+/*
+ * Function: PostReply
+ * Usage: PostReply(args, nargs, text);
+ * ------------------------------------
+ * This function stores a response in the reply record and wakes
+ * the client thread, which is waiting for it in XMGetResponse.
+ */
+
+static void PostReply(double args[], int nargs, string text)
 {
-    int n;
-    double x, y, rx, ry, start, sweep;
+    int i;
 
-    n = sscanf(args, "%lg %lg %lg %lg %lg %lg",
-               &x, &y, &rx, &ry, &start, &sweep);
-    if (n != 6) {
-        Error("Internal error: Bad arguments to ArcCmd");
+    if (text != NULL && strlen(text) >= CommandBufferSize) {
+        Error("Internal error: Response text too long");
+    }
+    pthread_mutex_lock(&replyLock);
+    reply.cmd = 0;
+    reply.length = (text == NULL) ? 0 : strlen(text);
+    for (i = 0; i < MaxCommandArgs; i++) {
+        reply.args[i] = (i < nargs) ? args[i] : 0;
     }
-    XDDrawArc(x, y, rx, ry, start, sweep);
+    strcpy(replyText, (text == NULL) ? "" : text);
+    replyReady = TRUE;
+    pthread_cond_signal(&replyPosted);
+    pthread_mutex_unlock(&replyLock);
 }
 
-static void TextMessage(string args)
+/*
+ * Function: PutMessage
+ * Usage: PutMessage(cmd, args, nargs, text);
+ * ------------------------------------------
+ * This function adds a message record followed by the text, if
+ * any, to the output buffer, first flushing the buffer if the
+ * message does not fit.  The unused arguments are cleared so
+ * that the record never contains uninitialized data.  In the
+ * client, the caller must hold outLock.
+ */
+
+static void PutMessage(int cmd, double args[], int nargs, string text)
 {
-    int n;
-    char *space;
-    double x, y;
+    messageT msg;
+    int i;
 
-    n = sscanf(args, "%lg %lg", &x, &y);
-    if (n != 2) {
-        Error("Internal error: Bad arguments to TextCmd");
+    if (nargs > MaxCommandArgs) {
+        Error("Internal error: Too many command arguments");
     }
-    space = strchr(strchr(args, ' ') + 1, ' ');
-    if (space == NULL) {
-        Error("Internal error: Bad arguments to TextCmd");
+    msg.cmd = cmd;
+    msg.length = (text == NULL) ? 0 : strlen(text);
+    if (msg.length >= CommandBufferSize) {
+        Error("Internal error: Command text too long");
     }
-    XDDrawText(x, y, space + 1);
+    for (i = 0; i < MaxCommandArgs; i++) {
+        msg.args[i] = (i < nargs) ? args[i] : 0;
+    }
+    if (outCount + sizeof msg + msg.length > PipeBufferSize) FlushOutput();
+    memcpy(outBuffer + outCount, &msg, sizeof msg);
+    outCount += sizeof msg;
+    memcpy(outBuffer + outCount, text, msg.length);
+    outCount += msg.length;
 }
 
-static void WidthMessage(string args)
+/*
+ * Function: FlushOutput
+ * Usage: FlushOutput();
+ * ---------------------
+ * This function writes the contents of the output buffer to the
+ * pipe, or to the shared ring if the client is using the shm
+ * transport.  In the client, the caller must hold outLock.
+ */
+
+static void FlushOutput(void)
 {
-    double width;
+    int nwritten, total;
+
+    if (outRing != NULL) {
+        RingWrite(outBuffer, outCount);
+        outCount = 0;
+        return;
+    }
+    total = 0;
+    while (total < outCount) {
+        nwritten = write(outfd, outBuffer + total, outCount - total);
+        if (nwritten < 0 && errno == EINTR) continue;
+        if (nwritten <= 0) Error("Can't write to graphics pipe");
+        total += nwritten;
+    }
+    outCount = 0;
+}
+
+/*
+ * Function: StartFlushThread
+ * Usage: StartFlushThread();
+ * --------------------------
+ * This function starts the thread that flushes the client's
+ * output buffer after FlushDelay.  Its condition variable uses
+ * the monotonic clock, so that its timeouts can be compared with
+ * the values returned by CurrentTime.  The caller must hold
+ * outLock.
+ */
+
+static void StartFlushThread(void)
+{
+    pthread_condattr_t attr;
+    pthread_t thread;
 
-    width = XDTextWidth(args);
-    fprintf(outPipe, "%.12g\n", width);
-    fflush(outPipe);
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&outPending, &attr);
+    pthread_condattr_destroy(&attr);
+    if (pthread_create(&thread, NULL, FlushThread, NULL) != 0) {
+        Error("Can't create graphics flush thread");
+    }
+    pthread_detach(thread);
+    flushStarted = TRUE;
 }
 
-static void FontMetricsMessage(string args)
+/*
+ * Function: FlushThread
+ * Usage: pthread_create(&thread, NULL, FlushThread, NULL);
+ * --------------------------------------------------------
+ * This function is the body of the flush thread.  While the
+ * output buffer is empty, the thread sleeps until XMSendCommand
+ * signals it.  Otherwise, it sleeps until FlushDelay has passed
+ * since the oldest buffered command was added and then flushes
+ * the buffer if the client has not already done so.
+ */
+
+static void *FlushThread(void *arg)
 {
-    double ascent, descent, height;
+    struct timespec deadline;
+    double flushTime;
+
+    pthread_mutex_lock(&outLock);
+    while (TRUE) {
+        if (outCount == 0) {
+            flushIdle = TRUE;
+            pthread_cond_wait(&outPending, &outLock);
+            flushIdle = FALSE;
+        } else {
+            flushTime = outStart + FlushDelay;
+            if (CurrentTime() >= flushTime) {
+                FlushOutput();
+            } else {
+                deadline.tv_sec = (time_t) flushTime;
+                deadline.tv_nsec = (flushTime - deadline.tv_sec) * 1e9;
+                pthread_cond_timedwait(&outPending, &outLock, &deadline);
+            }
+        }
+    }
+    return (NULL);
+}
+
+/*
+ * Function: FlushAtExit
+ * Usage: atexit(FlushAtExit);
+ * ---------------------------
+ * This function is registered in the client so that commands
+ * still in the buffer reach the X manager when the program exits.
+ * In thread mode, the function then closes the client's end of
+ * the pipe, which the X manager sees as the end of the input, and
+ * waits for the X manager thread to finish.  If the X manager
+ * thread itself calls exit after an error, the function does
+ * nothing.
+ */
 
-    DisplayFontMetrics(&ascent, &descent, &height);
-    fprintf(outPipe, "%.12g %.12g %.12g\n", ascent, descent, height);
-    fflush(outPipe);
+static void FlushAtExit(void)
+{
+    if (threadMode && pthread_equal(pthread_self(), manager)) return;
+    pthread_mutex_lock(&outLock);
+    FlushOutput();
+    pthread_mutex_unlock(&outLock);
+    if (threadMode) {
+        close(outfd);
+        pthread_join(manager, NULL);
+    }
 }
 
-static void SetEraseMessage(string args)
+/*
+ * Function: CurrentTime
+ * Usage: t = CurrentTime();
+ * -------------------------
+ * This function returns the value of a monotonic clock in seconds.
+ */
+
+static double CurrentTime(void)
 {
-    int n, flag;
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec + ts.tv_nsec / 1e9);
+}
 
-    n = sscanf(args, "%d", &flag);
-    if (n != 1) {
-        Error("Internal error: Bad arguments to SetEraseCmd");
+/*
+ * Function: OpenRing
+ * Usage: ring = OpenRing();
+ * -------------------------
+ * This function creates the shared ring and the eventfds used by
+ * the shm and thread transports, if the environment selects one
+ * of them, and returns the ring, setting threadMode for the
+ * thread transport.  The mapping is anonymous and shared, so it
+ * remains shared by the two forks and is initially filled with
+ * zeros.  The function returns NULL if the pipes are to be used
+ * instead, either because the environment does not select
+ * another transport or because the system cannot provide it.
+ */
+
+static ringT *OpenRing(void)
+{
+    string transport;
+    ringT *ring;
+
+    transport = getenv(TransportVar);
+    if (transport == NULL) return (NULL);
+    if (strcmp(transport, "shm") != 0 && strcmp(transport, "thread") != 0) {
+        return (NULL);
+    }
+#ifdef __linux__
+    ring = mmap(NULL, sizeof (ringT), PROT_READ | PROT_WRITE,
+                MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (ring == MAP_FAILED) return (NULL);
+    wakefd = eventfd(0, 0);
+    spacefd = eventfd(0, 0);
+    if (wakefd >= 0 && spacefd >= 0) {
+        threadMode = (strcmp(transport, "thread") == 0);
+        return (ring);
+    }
+    if (wakefd >= 0) close(wakefd);
+    if (spacefd >= 0) close(spacefd);
+    munmap(ring, sizeof (ringT));
+#endif
+    return (NULL);
+}
+
+/*
+ * Function: RingWrite
+ * Usage: RingWrite(src, nbytes);
+ * ------------------------------
+ * This function copies nbytes bytes from src into the shared
+ * ring, publishing each piece by advancing tail and waking the X
+ * manager if it has announced that it is asleep.  If the ring is
+ * full, the client announces that it is waiting for space and
+ * sleeps on spacefd.  The caller must hold outLock.
+ */
+
+static void RingWrite(char *src, int nbytes)
+{
+    unsigned long head, tail;
+    int n;
+
+    tail = atomic_load(&outRing->tail);
+    while (nbytes > 0) {
+        head = atomic_load(&outRing->head);
+        if (tail - head == RingSize) {
+            atomic_store(&outRing->clientWaiting, 1);
+            if (atomic_load(&outRing->head) == head) ClearEvent(spacefd);
+            atomic_store(&outRing->clientWaiting, 0);
+            continue;
+        }
+        n = GLMin(nbytes, RingSize - (tail - head));
+        n = GLMin(n, RingSize - tail % RingSize);
+        memcpy(outRing->data + tail % RingSize, src, n);
+        src += n;
+        nbytes -= n;
+        tail += n;
+        atomic_store(&outRing->tail, tail);
+        if (atomic_exchange(&outRing->managerWaiting, 0)) {
+            SignalEvent(wakefd);
+        }
     }
-    XDSetEraseMode((bool) flag);
 }
 
-static void StartRegionMessage(string args)
+/*
+ * Function: RingRead
+ * Usage: nread = RingRead(dst, max);
+ * ----------------------------------
+ * This function copies up to max bytes from the shared ring into
+ * dst and returns the number of bytes copied, waking the client
+ * if it is waiting for space.  If the ring is empty, the X
+ * manager sleeps until the client either signals wakefd or
+ * closes its end of the pipe, in which case the function returns
+ * the result of reading the pipe, which is 0 at the end of file.
+ */
+
+static int RingRead(char *dst, int max)
 {
+    struct pollfd fds[2];
+    unsigned long head, tail;
     int n;
-    double grayScale;
 
-    n = sscanf(args, "%lg", &grayScale);
-    if (n != 1) {
-        Error("Internal error: Bad arguments to SetEraseCmd");
+    fds[0].fd = wakefd;
+    fds[0].events = POLLIN;
+    fds[1].fd = infd;
+    fds[1].events = POLLIN;
+    head = atomic_load(&inRing->head);
+    while ((tail = atomic_load(&inRing->tail)) == head) {
+        fds[0].revents = fds[1].revents = 0;
+        atomic_store(&inRing->managerWaiting, 1);
+        if (atomic_load(&inRing->tail) == head) (void) poll(fds, 2, -1);
+        atomic_store(&inRing->managerWaiting, 0);
+        if (fds[0].revents & POLLIN) ClearEvent(wakefd);
+        if ((fds[1].revents & (POLLIN | POLLHUP))
+              && atomic_load(&inRing->tail) == head) {
+            return (read(infd, dst, max));
+        }
+    }
+    n = GLMin(max, tail - head);
+    n = GLMin(n, RingSize - head % RingSize);
+    memcpy(dst, inRing->data + head % RingSize, n);
+    atomic_store(&inRing->head, head + n);
+    if (atomic_exchange(&inRing->clientWaiting, 0)) SignalEvent(spacefd);
+    return (n);
+}
+
+/*
+ * Functions: SignalEvent, ClearEvent
+ * Usage: SignalEvent(fd);
+ *        ClearEvent(fd);
+ * -----------------------
+ * These functions signal an eventfd and wait for a signal on an
+ * eventfd, which also resets it.
+ */
+
+static void SignalEvent(int fd)
+{
+    uint64_t one;
+
+    one = 1;
+    while (write(fd, &one, sizeof one) < 0 && errno == EINTR);
+}
+
+static void ClearEvent(int fd)
+{
+    uint64_t count;
+
+    while (read(fd, &count, sizeof count) < 0 && errno == EINTR);
+}
+
+/*
+ * Function: ReadMessage
+ * Usage: if (ReadMessage()) . . .
+ * -------------------------------
+ * This function reads the next command from the client into the
+ * message record and its text into cmdBuffer, where the text is
+ * terminated by a null character.  The function returns FALSE
+ * at the end of the input.
+ */
+
+static bool ReadMessage(void)
+{
+    if (infd == 0) {
+        FreeBlock(GetLine());
+        return (FALSE);
+    }
+    if (!ReadBytes(&message, sizeof message)) return (FALSE);
+    if (message.length < 0 || message.length >= CommandBufferSize) {
+        Error("Internal error: Illegal command length");
+    }
+    if (!ReadBytes(cmdBuffer, message.length)) {
+        Error("Unexpected end of file");
+    }
+    cmdBuffer[message.length] = '\0';
+    return (TRUE);
+}
+
+/*
+ * Function: ReadBytes
+ * Usage: if (ReadBytes(dst, nbytes)) . . .
+ * ----------------------------------------
+ * This function copies exactly nbytes bytes from the input
+ * buffer into dst, refilling the buffer from infd or the shared
+ * ring as necessary.  The function returns FALSE if the input
+ * ends before any bytes are read and calls Error if it ends in
+ * the middle.
+ */
+
+static bool ReadBytes(void *dst, int nbytes)
+{
+    char *cp;
+    int n, nread, total;
+
+    cp = dst;
+    total = 0;
+    while (total < nbytes) {
+        if (inCount == 0) {
+            if (inRing != NULL) {
+                nread = RingRead(inBuffer, PipeBufferSize);
+            } else {
+                nread = read(infd, inBuffer, PipeBufferSize);
+            }
+            if (nread < 0 && errno == EINTR) continue;
+            if (nread <= 0) {
+                if (total == 0) return (FALSE);
+                Error("Unexpected end of file");
+            }
+            inStart = 0;
+            inCount = nread;
+        }
+        n = GLMin(inCount, nbytes - total);
+        memcpy(cp + total, inBuffer + inStart, n);
+        inStart += n;
+        inCount -= n;
+        total += n;
+    }
+    return (TRUE);
+}
+
+static void ProcessMessage(void)
+{
+    double *args;
+    string text;
+
+    args = message.args;
+    text = cmdBuffer;
+    switch ((commandT) message.cmd) {
+      case LineCmd: LineMessage(args, text); break;
+      case ArcCmd: ArcMessage(args, text); break;
+      case TextCmd: TextMessage(args, text); break;
+      case WidthCmd: WidthMessage(args, text); break;
+      case FontMetricsCmd: FontMetricsMessage(args, text); break;
+      case SetEraseCmd: SetEraseMessage(args, text); break;
+      case StartRegionCmd: StartRegionMessage(args, text); break;
+      case EndRegionCmd: EndRegionMessage(args, text); break;
+      case ClearCmd: ClearMessage(args, text); break;
+      case UpdateCmd: UpdateMessage(args, text); break;
+      case SetTitleCmd: SetTitleMessage(args, text); break;
+      case SetFontCmd: SetFontMessage(args, text); break;
+      case GetMouseCmd: GetMouseMessage(args, text); break;
+      case WaitForMouseCmd: WaitForMouseMessage(args, text); break;
+      case SetColorCmd: SetColorMessage(args, text); break;
+      case ExitGraphicsCmd: exitGraphicsFlag = TRUE; break;
+      default: Error("Internal error: Illegal command"); break;
     }
-    XDStartRegion(grayScale);
 }
 
-static void EndRegionMessage(string args)
+static void LineMessage(double args[], string text)
+{
+    XDDrawLine(args[0], args[1], args[2], args[3]);
+}
+
+static void ArcMessage(double args[], string text)
+{
+    XDDrawArc(args[0], args[1], args[2], args[3], args[4], args[5]);
+}
+
+static void TextMessage(double args[], string text)
+{
+    XDDrawText(args[0], args[1], text);
+}
+
+static void WidthMessage(double args[], string text)
+{
+    double width;
+
+    width = XDTextWidth(text);
+    SendResponse(&width, 1, NULL);
+}
+
+static void FontMetricsMessage(double args[], string text)
+{
+    double metrics[3];
+
+    DisplayFontMetrics(&metrics[0], &metrics[1], &metrics[2]);
+    SendResponse(metrics, 3, NULL);
+}
+
+static void SetEraseMessage(double args[], string text)
+{
+    XDSetEraseMode(args[0] != 0);
+}
+
+static void StartRegionMessage(double args[], string text)
+{
+    XDStartRegion(args[0]);
+}
+
+static void EndRegionMessage(double args[], string text)
 {
     XDEndRegion();
 }
 
-static void ClearMessage(string args)
+static void ClearMessage(double args[], string text)
 {
     XDClearDisplay();
 }
 
-static void UpdateMessage(string args)
+static void UpdateMessage(double args[], string text)
 {
     XDSetRedrawFlag();
     XDCheckForRedraw();
 }
 
-static void SetTitleMessage(string args)
+static void SetTitleMessage(double args[], string text)
 {
-    XDSetTitle(args);
+    XDSetTitle(text);
 }
 
-static void SetFontMessage(string args)
+static void SetFontMessage(double args[], string text)
 {
-    int n, size, style;
-    char *space;
-
-    n = sscanf(args, "%d %d", &size, &style);
-    if (n != 2) {
-        Error("Internal error: Bad arguments to SetFontCmd");
-    }
-    space = strchr(args, ' ');
-    if (space == NULL) {
-        Error("Internal error: Bad arguments to TextCmd");
-    }
-    space = strchr(space + 1, ' ');
-    if (space == NULL) {
-        Error("Internal error: Bad arguments to TextCmd");
-    }
-    fprintf(outPipe, "%s\n", XDSetFont(space + 1, size, style));
-    fflush(outPipe);
+    SendResponse(NULL, 0, XDSetFont(text, (int) args[0], (int) args[1]));
 }
 
-static void GetMouseMessage(string args)
+static void GetMouseMessage(double args[], string text)
 {
     bool down;
-    double x, y;
+    double mouse[3];
 
-    XDGetMouse(&down, &x, &y);
-    fprintf(outPipe, "%d, %.12g, %.12g\n", down, x, y);
-    fflush(outPipe);
+    XDGetMouse(&down, &mouse[1], &mouse[2]);
+    mouse[0] = down;
+    SendResponse(mouse, 3, NULL);
 }
 
-static void WaitForMouseMessage(string args)
+static void WaitForMouseMessage(double args[], string text)
 {
-    XDWaitForMouse(StringEqual(args, "D"));
+    XDWaitForMouse(args[0] != 0);
 }
 
-static void SetColorMessage(string args)
+static void SetColorMessage(double args[], string text)
 {
-    double red, green, blue;
-    int n;
-
-    n = sscanf(args, "%lg %lg %lg", &red, &green, &blue);
-    if (n != 3) {
-        Error("Internal error: Bad arguments to SetColorCmd");
-    }
-    XDSetColor(red, green, blue);
+    XDSetColor(args[0], args[1], args[2]);
 }
@@ -19,11 +19,13 @@
  * CommandBufferSize  -- Size of internal command buffer
  * MaxFontName        -- Maximum length of font name
  * MaxTextString      -- Length limit for DrawTextString
+ * MaxCommandArgs     -- Maximum number of numeric arguments
  */
 
 #define CommandBufferSize   200
 #define MaxFontName          25
 #define MaxTextString       120
+#define MaxCommandArgs        6
 
 /*
  * Type: commandT
@@ -67,24 +69,30 @@ void XMInitialize(string title);
 
 /*
  * Function: XMSendCommand
- * Usage: XMSendCommand(cmd, args);
- * --------------------------------
+ * Usage: XMSendCommand(cmd, args, nargs, text);
+ * ---------------------------------------------
  * This function sends the specified command to the X manager
- * process along with an argument string.
+ * process.  The first nargs elements of the args array, which may
+ * not exceed MaxCommandArgs, are the numeric arguments.  The text
+ * argument is a string argument, which is NULL for commands that
+ * do not require one.
  */
 
-void XMSendCommand(commandT cmd, string args);
+void XMSendCommand(commandT cmd, double args[], int nargs, string text);
 
 /*
  * Function: XMGetResponse
- * Usage: XMGetResponse(buffer);
- * -----------------------------
- * This function reads a line from the X manager in response to
- * a command message.  The string is stored in the buffer provided
- * by the client, which must be at least CommandBufferSize bytes.
+ * Usage: XMGetResponse(results, buffer);
+ * --------------------------------------
+ * This function reads the response of the X manager to a command
+ * message.  Any numeric results are stored in the results array,
+ * which must have room for MaxCommandArgs values, and any text is
+ * stored in the buffer provided by the client, which must be at
+ * least CommandBufferSize bytes.  Either argument may be NULL if
+ * the client does not need that part of the response.
  */
 
-void XMGetResponse(char buffer[]);
+void XMGetResponse(double results[], char buffer[]);
 
 /*
  * Function: XMReleaseClient